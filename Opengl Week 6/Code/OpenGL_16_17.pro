@@ -23,6 +23,7 @@ SOURCES += main.cpp\
 HEADERS  += mainwindow.h \
     mainview.h \
     model.h \
+    meshfile.h \
     vertex.h
 
 FORMS    += mainwindow.ui
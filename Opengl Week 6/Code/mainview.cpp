@@ -31,6 +31,7 @@ MainView::~MainView() {
 
     // Free Buffer Objects before Vertex Arrays
     glDeleteBuffers(1, &cubeBO);
+    glDeleteBuffers(1, &cubeIndexBO);
     glDeleteVertexArrays(1, &vao);
 
     // Free the main shader
@@ -107,6 +108,10 @@ void MainView::createBuffers() {
     glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, offsetNormal);
     glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, offsetTexture);
 
+    // the vao keeps the index buffer, compiled models are drawn with glDrawElements()
+    glGenBuffers(1, &cubeIndexBO);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, cubeIndexBO);
+
     glBindVertexArray(0);
     glBindBuffer(GL_ARRAY_BUFFER, 0);
 
@@ -192,9 +197,18 @@ void MainView::loadModel(QString filename, GLuint bufferObject) {
     numTris = cubeModel->getNumTriangles();
     srand(time(NULL));
 
-    QVector<float> data = cubeModel->getVNTInterleaved();
-
     glBindBuffer(GL_ARRAY_BUFFER, bufferObject);
+    if (cubeModel->isCompiled()) {
+        // the mapped vertices are interleaved as the attributes expect them, they are uploaded as they are
+        glBufferData(GL_ARRAY_BUFFER, cubeModel->getNumVertices_compiled() * sizeof(MeshFileVertex),
+                     cubeModel->getVertices_compiled(), GL_STATIC_DRAW);
+        glBindVertexArray(vao);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, numTris * 3 * sizeof(GLuint), cubeModel->getIndices_compiled(), GL_STATIC_DRAW);
+        glBindVertexArray(0);
+        return;
+    }
+
+    QVector<float> data = cubeModel->getVNTInterleaved();
     glBufferData(GL_ARRAY_BUFFER, data.size() * sizeof(GLfloat), (GLfloat*)data.data(), GL_STATIC_DRAW);
 }
 
@@ -359,8 +373,9 @@ void MainView::paintGL() {
     mainShaderProg->bind();
 
     view = QMatrix4x4();
-    QVector3D eye(0.5, 0.7, 4.0);
-    QVector3D center(0.5, 0.7, 0.0);
+    // models are unitized, centered at the origin
+    QVector3D eye(0.0, 0.0, 4.0);
+    QVector3D center(0.0, 0.0, 0.0);
 
     //QVector3D eye(0.0, 0.0, 2.0);
     //QVector3D center(0.0, 0.0, 0.0);
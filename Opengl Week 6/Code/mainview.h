@@ -133,6 +133,7 @@ private:
 
     Model *cubeModel;
     GLuint cubeBO;
+    GLuint cubeIndexBO; // the triangles of a compiled model
 
     unsigned numTris;
 
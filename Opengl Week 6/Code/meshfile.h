@@ -0,0 +1,47 @@
+#ifndef MESHFILE_H
+#define MESHFILE_H
+
+#include <QtGlobal>
+
+/**
+ * Layout of the compiled mesh files written by the raytracer's
+ * tools/meshc (see MeshFile.hpp there, the two must stay the same).
+ *
+ * A header, then the interleaved vertices, the vertex indices of the
+ * triangles, a material per triangle, the materials and the triangle
+ * clusters, every section at a multiple of 16 bytes. Positions are
+ * unitized and the normals smooth, so the vertices can be uploaded
+ * to a buffer as they are.
+ */
+
+#define MESHFILE_MAGIC "RTMESH\r\n"
+#define MESHFILE_VERSION 1
+#define MESHFILE_TEXCOORDS 2
+
+struct MeshFileHeader {
+    char magic[8];
+    quint32 version;
+    quint32 flags;
+    quint32 numVertices;
+    quint32 numTriangles;
+    quint32 numMaterials;
+    quint32 numClusters;
+    quint32 clusterSize;
+    quint32 reserved;
+    float min[3];
+    float max[3];
+    quint64 vertexOffset;
+    quint64 indexOffset;
+    quint64 triangleMaterialOffset;
+    quint64 materialOffset;
+    quint64 clusterOffset;
+};
+
+// position, normal, texture coordinate: 8 floats as in getVNTInterleaved()
+struct MeshFileVertex {
+    float position[3];
+    float normal[3];
+    float texcoord[2];
+};
+
+#endif // MESHFILE_H
@@ -1,7 +1,9 @@
 #include "model.h"
 #include "vertex.h"
+#include "meshfile.h"
 
 #include <cmath>
+#include <cstring>
 #include <limits>
 
 #include <QDebug>
@@ -11,10 +13,19 @@
 Model::Model(QString filename) {
     hNorms = false;
     hTexs = false;
+    mapped = NULL;
+    compiled = NULL;
 
     qDebug() << ":: Loading model:" << filename;
     QFile file(filename);
     if(file.open(QIODevice::ReadOnly)) {
+        if (file.peek(8) == QByteArray(MESHFILE_MAGIC, 8)) {
+            file.close();
+            if (!loadCompiled(filename))
+                qDebug() << ":: Invalid compiled mesh:" << filename;
+            return;
+        }
+
         QTextStream in(&file);
 
         QString line;
@@ -51,41 +62,134 @@ Model::Model(QString filename) {
 
         // Allign all vertex indices with the right normal/texturecoord indices
         alignData();
+
+        // the size of a compiled mesh
+        unitize();
+    }
+}
+
+Model::~Model() {
+    if (mapped)
+        compiledFile.unmap(mapped);
+}
+
+/**
+ * @brief Model::loadCompiled
+ *
+ * Maps a compiled mesh, it stays mapped while the model exists. The
+ * compiled positions are unitized already
+ *
+ * @return false if the file is not a valid compiled mesh, the model is left empty
+ */
+bool Model::loadCompiled(QString filename) {
+    compiledFile.setFileName(filename);
+    if (!compiledFile.open(QIODevice::ReadOnly))
+        return false;
+
+    // resources that cannot be mapped are read instead
+    qint64 size = compiledFile.size();
+    mapped = compiledFile.map(0, size);
+    if (mapped) {
+        if (readCompiled(mapped, size))
+            return true;
+        compiledFile.unmap(mapped);
+        mapped = NULL;
+    } else {
+        contents = compiledFile.readAll();
+        if (readCompiled((const uchar*)contents.constData(), contents.size()))
+            return true;
+        contents.clear();
     }
+    compiledFile.close();
+    return false;
+}
+
+/**
+ * @brief Model::readCompiled
+ *
+ * Checks the compiled mesh in data, see loadCompiled
+ *
+ * @return false if data is not a valid compiled mesh
+ */
+bool Model::readCompiled(const uchar *data, qint64 size) {
+    if (size < (qint64)sizeof(MeshFileHeader))
+        return false;
+
+    // the counts have to fit the file and the int sizes of the buffers
+    const MeshFileHeader *header = (const MeshFileHeader*)data;
+    if (memcmp(header->magic, MESHFILE_MAGIC, 8) != 0
+        || header->version != MESHFILE_VERSION
+        || header->numVertices > (quint64)std::numeric_limits<int>::max() / sizeof(MeshFileVertex)
+        || header->numTriangles > (quint64)std::numeric_limits<int>::max() / (3 * sizeof(quint32))
+        || header->vertexOffset > (quint64)size
+        || header->numVertices > ((quint64)size - header->vertexOffset) / sizeof(MeshFileVertex)
+        || header->indexOffset > (quint64)size
+        || 3 * (quint64)header->numTriangles > ((quint64)size - header->indexOffset) / sizeof(quint32))
+        return false;
+
+    const quint32 *ind = (const quint32*)(data + header->indexOffset);
+    for (quint64 i = 0; i != 3 * (quint64)header->numTriangles; ++i)
+        if (ind[i] >= header->numVertices)
+            return false;
+
+    hNorms = true;
+    hTexs = header->flags & MESHFILE_TEXCOORDS;
+    compiled = header;
+    return true;
+}
+
+bool Model::isCompiled() {
+    return compiled != NULL;
+}
+
+int Model::getNumVertices_compiled() {
+    return compiled ? compiled->numVertices : 0;
+}
+
+const MeshFileVertex *Model::getVertices_compiled() {
+    return compiled ? (const MeshFileVertex*)((const uchar*)compiled + compiled->vertexOffset) : NULL;
+}
+
+const quint32 *Model::getIndices_compiled() {
+    return compiled ? (const quint32*)((const uchar*)compiled + compiled->indexOffset) : NULL;
 }
 
 /**
- * @brief Model::unitze Not Implemented yet!
+ * @brief Model::unitze
  *
- * Unitize the model by scaling so that it fits a box with sides 1
- * and origin at 0,0,0
+ * Unitize the model by scaling so that it fits a box with sides 2
+ * and origin at 0,0,0, as glmUnitize does for the raytracer and meshc
+ * for compiled meshes, which are unitized already
  * Usefull for models with different scales
  *
  */
 float Model::unitize()
 {
+    if (compiled || vertices_indexed.isEmpty())
+        return 1;
+
     float xmin = std::numeric_limits<float>::max();
-    float xmax = std::numeric_limits<float>::min();
+    float xmax = std::numeric_limits<float>::lowest();
     float ymin = std::numeric_limits<float>::max();
-    float ymax = std::numeric_limits<float>::min();
+    float ymax = std::numeric_limits<float>::lowest();
     float zmin = std::numeric_limits<float>::max();
-    float zmax = std::numeric_limits<float>::min();
+    float zmax = std::numeric_limits<float>::lowest();
 
     //get model x,y,z min and max
-    for(int i = 0; i < vertices.length(); ++i)
+    for(int i = 0; i < vertices_indexed.length(); ++i)
     {
-        xmin = std::min(xmin, vertices[i].x());
-        xmax = std::max(xmax, vertices[i].x());
-        ymin = std::min(ymin, vertices[i].y());
-        ymax = std::max(ymax, vertices[i].y());
-        zmin = std::min(zmin, vertices[i].z());
-        zmax = std::max(zmax, vertices[i].z());
+        xmin = std::min(xmin, vertices_indexed[i].x());
+        xmax = std::max(xmax, vertices_indexed[i].x());
+        ymin = std::min(ymin, vertices_indexed[i].y());
+        ymax = std::max(ymax, vertices_indexed[i].y());
+        zmin = std::min(zmin, vertices_indexed[i].z());
+        zmax = std::max(zmax, vertices_indexed[i].z());
     }
 
-    //model width height and depth
-    float w = xmax - xmin;
-    float h = ymax - ymin;
-    float d = zmax - zmin;
+    //model width height and depth, measured as glmUnitize does
+    float w = std::fabs(xmax) + std::fabs(xmin);
+    float h = std::fabs(ymax) + std::fabs(ymin);
+    float d = std::fabs(zmax) + std::fabs(zmin);
     float scale = 2.0 / std::max(w, std::max(h, d));
     //calculate center of model
     float cx = (xmax + xmin) / 2;
@@ -94,6 +198,10 @@ float Model::unitize()
     QVector3D center(cx, cy, cz);
 
     //for all vertices: translate towards center, then scale between [-1,1].
+    for(int i = 0; i < vertices_indexed.length(); ++i)
+    {
+        vertices_indexed[i] = (vertices_indexed[i] - center) * scale;
+    }
     for(int i = 0; i < vertices.length(); ++i)
     {
         vertices[i] = (vertices[i] - center) * scale;
@@ -214,7 +322,7 @@ QVector<float> Model::getVNTInterleaved_indexed() {
  * @return number of triangles
  */
 int Model::getNumTriangles() {
-    return vertices.size()/3;
+    return compiled ? compiled->numTriangles : vertices.size()/3;
 }
 
 void Model::parseVertex(QStringList tokens) {
@@ -1,18 +1,28 @@
 #ifndef MODEL_H
 #define MODEL_H
 
+#include <QByteArray>
+#include <QFile>
 #include <QString>
 #include <QStringList>
 #include <QVector>
 #include <QVector2D>
 #include <QVector3D>
 
+#include "meshfile.h"
+
 /**
  * @brief The Model class
  *
  * Loads all data from a Wavefront .obj file
  * IMPORTANT! Current only supports TRIANGLE meshes!
  *
+ * Meshes compiled by the raytracer's meshc tool (see meshfile.h) are
+ * mapped into memory and used as they are: their interleaved vertices
+ * go to a buffer for glDrawElements() without being copied or parsed.
+ * OBJ models are unitized like the compiled ones, so a model shows at
+ * the same size whichever way it was loaded
+ *
  * Support for other meshes can be implemented by students
  *
  */
@@ -20,6 +30,7 @@ class Model
 {
 public:
     Model(QString filename);
+    ~Model();
 
     // Used for glDrawArrays()
     QVector<QVector3D> getVertices();
@@ -40,6 +51,14 @@ public:
     QVector<float> getVNInterleaved_indexed();
     QVector<float> getVNTInterleaved_indexed();
 
+    // Used for compiled meshes, the vectors above are empty for them:
+    // the mapped vertices (8 floats each, as getVNTInterleaved()) and
+    // 3 indices per triangle for glDrawElements()
+    bool isCompiled();
+    int getNumVertices_compiled();
+    const MeshFileVertex *getVertices_compiled();
+    const quint32 *getIndices_compiled();
+
     bool hasNormals();
     bool hasTextureCoords();
     int getNumTriangles();
@@ -47,6 +66,17 @@ public:
     float unitize();
 
 private:
+    Q_DISABLE_COPY(Model)
+
+    // Compiled meshes
+    bool loadCompiled(QString filename);
+    bool readCompiled(const uchar *data, qint64 size);
+
+    // The compiled mesh, mapped or read if it cannot be mapped
+    QFile compiledFile;
+    uchar *mapped;
+    QByteArray contents;
+    const MeshFileHeader *compiled;
 
     // OBJ parsing
     void parseVertex(QStringList tokens);
@@ -18,7 +18,8 @@ void MainView::renderSphere(GLint type, GLint theta, QVector3D pos, QVector3D co
     glUniformMatrix4fv(glNormal, 1, GL_FALSE, normal.data());
 
     //draw sphere
-    glDrawArrays(GL_TRIANGLES, 0, numTris * 3);
+    if (cubeModel->isCompiled()) glDrawElements(GL_TRIANGLES, numTris * 3, GL_UNSIGNED_INT, 0);
+    else glDrawArrays(GL_TRIANGLES, 0, numTris * 3);
     glBindTexture(GL_TEXTURE_2D, 0);
 }
 
@@ -0,0 +1,70 @@
+#include "AssetLoader.hpp"
+#include "TextureCache.hpp"
+#include "Trace.hpp"
+#include "PerfCounters.hpp"
+#include <iostream>
+#include <sstream>
+
+AssetLoader::AssetLoader(size_t threads) : pool(threads) { }
+
+AssetLoader::~AssetLoader()
+{
+    pool.wait();
+}
+
+void AssetLoader::texture(Material *material, const std::string &file, int line)
+{
+    Load &load = *loads.insert(loads.end(), Load());
+    load.line = load.warningLine = line;
+    pool.add([material, file, &load]()
+    {
+        Trace::Scope trace("loadTexture", file);
+        PerfCounters::Scope counters(PerfCounters::PARSE);
+        std::ostringstream log;
+        material->texture = TextureCache::acquire(file, log, load.warning);
+        load.report = log.str();
+    });
+}
+
+void AssetLoader::mesh(Mesh *mesh, const std::string &file, const Vector &pos, float scale, int line,
+                       const std::string &texture, int textureLine)
+{
+    Load &load = *loads.insert(loads.end(), Load());
+    load.line = line;
+    load.warningLine = textureLine;
+    pool.add([mesh, file, pos, scale, texture, &load]()
+    {
+        Trace::Scope trace("loadMesh", file);
+        PerfCounters::Scope counters(PerfCounters::PARSE);
+        std::ostringstream log;
+        if(!texture.empty())
+            mesh->material->texture = TextureCache::acquire(texture, log, load.warning);
+
+        std::string error;
+        if(!mesh->load(file, pos, scale, log, error))
+            load.error = "reading mesh " + file + " failed (" + error + ")";
+        load.report = log.str();
+    });
+}
+
+bool AssetLoader::wait()
+{
+    {
+        Trace::Scope trace("waitForAssets");
+        pool.wait();
+    }
+    bool loaded = true;
+    for(size_t i = 0; i < loads.size(); ++i)
+    {
+        std::cout << loads[i].report;
+        if(!loads[i].warning.empty())
+            std::cerr << "Warning at line " << loads[i].warningLine << ": " << loads[i].warning << "." << std::endl;
+        if(!loads[i].error.empty())
+        {
+            std::cerr << "Error at line " << loads[i].line << ": " << loads[i].error << "." << std::endl;
+            loaded = false;
+        }
+    }
+    loads.clear();
+    return loaded;
+}
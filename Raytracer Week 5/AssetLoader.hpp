@@ -0,0 +1,53 @@
+#ifndef ASSETLOADER_HPP
+#define ASSETLOADER_HPP
+
+#include <deque>
+#include <string>
+#include "Mesh.hpp"
+#include "ThreadPool.hpp"
+#include "material.h"
+
+/*
+    Class created for the course Computer graphics (2016 - 2017).
+    Loads the meshes and textures of a scene on a thread pool while the
+    scene file is still being parsed. Every load remembers the line of
+    the scene it came from; what the loads report, errors included, is
+    printed in scene order once they have all finished, so the output
+    reads as if they were loaded one after the other.
+*/
+
+class AssetLoader
+{
+public:
+    explicit AssetLoader(size_t threads = ThreadPool::defaultThreads());
+    ~AssetLoader(); //waits for the loads, without reporting them
+
+    //sets the texture of material to the one in file
+    void texture(Material *material, const std::string &file, int line);
+    //loads file into mesh, after the texture of its material (at textureLine)
+    //if it has one, the groups of the mesh share that texture
+    void mesh(Mesh *mesh, const std::string &file, const Vector &pos, float scale, int line,
+              const std::string &texture = "", int textureLine = 0);
+
+    //blocks until everything is loaded and prints the reports. false if
+    //a load failed, a texture that could not be read is only a warning.
+    bool wait();
+
+private:
+    struct Load
+    {
+        int line;
+        int warningLine;
+        std::string report;   //messages of the load
+        std::string error;    //or empty
+        std::string warning;  //or empty
+    };
+
+    std::deque<Load> loads; //a deque, the loads do not move while they run
+    ThreadPool pool;        //after loads, so it is stopped before they are gone
+
+    AssetLoader(const AssetLoader&);
+    AssetLoader &operator=(const AssetLoader&);
+};
+
+#endif
@@ -0,0 +1,204 @@
+#include "Autotuner.hpp"
+#include "Mesh.hpp"
+#include "Trace.hpp"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+static double seconds(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void report(const Autotuner::Settings &settings, double pixels)
+{
+    cout << "    threads " << settings.threads << ", tile width " << settings.tileWidth;
+    if(settings.clusterSize) cout << ", cluster size " << settings.clusterSize;
+    cout << ": " << int(pixels) << " pixels/s." << endl;
+}
+
+static std::vector<Mesh*> meshes(const std::vector<Object*> &objects)
+{
+    std::vector<Mesh*> meshes;
+    for(size_t i = 0; i < objects.size(); ++i)
+        if(Mesh *mesh = dynamic_cast<Mesh*>(objects[i])) meshes.push_back(mesh);
+    return meshes;
+}
+
+void Autotuner::set(Raytracer &raytracer, const Settings &settings)
+{
+    Scene &scene = *raytracer.scene;
+    scene.setThreads(settings.threads);
+    scene.setTileWidth(settings.tileWidth);
+    if(settings.clusterSize == 0) return;
+    std::vector<Mesh*> found = meshes(scene.objects);
+    for(size_t i = 0; i < found.size(); ++i) found[i]->setClusterSize(settings.clusterSize);
+}
+
+double Autotuner::throughput(Raytracer &raytracer, int scale, std::chrono::steady_clock::time_point deadline)
+{
+    //the trial covers the whole view with fewer, larger pixels, and its tiles shrink with it
+    Scene &scene = *raytracer.scene;
+    int w = std::max(1, raytracer.width / scale);
+    int h = std::max(1, raytracer.height / scale);
+    Image img(w, h, Image::FLOAT32, false);
+    size_t tileWidth = scene.tileWidth;
+    scene.tileWidth = std::max<size_t>(1, tileWidth / scale);
+    scene.viewScale = scale;
+    scene.deadline = deadline;
+
+    auto start = std::chrono::steady_clock::now();
+    bool finished = scene.render(img);
+    double time = seconds(start);
+
+    scene.deadline = std::chrono::steady_clock::time_point::max();
+    scene.viewScale = 1;
+    scene.tileWidth = tileWidth;
+    return finished ? double(w) * h / std::max(time, 1e-9) : 0;
+}
+
+bool Autotuner::tune(Raytracer &raytracer, double limit, const std::string &filename)
+{
+    Trace::Scope trace("autotune");
+    auto started = std::chrono::steady_clock::now();
+    auto end = started + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(limit));
+    Scene &scene = *raytracer.scene;
+    bool hasMeshes = !meshes(scene.objects).empty();
+
+    Settings best = {scene.threads, scene.tileWidth, hasMeshes ? Mesh::CLUSTER_SIZE : 0};
+    set(raytracer, best);
+
+    //trials of about 16K pixels, a quarter of the size while a trial takes more than
+    //a twentieth of the time. A trial gets at most a quarter of the time, the ones
+    //that run out of it are tried smaller; the earlier trials warm the caches.
+    int scale = std::max(1, int(sqrt(double(raytracer.width) * raytracer.height / 16384)));
+    double bestThroughput = 0, trialTime = 0;
+    for(;;)
+    {
+        auto trial = std::chrono::steady_clock::now();
+        bestThroughput = throughput(raytracer, scale, std::min(end, trial + (end - started) / 4));
+        trialTime = seconds(trial);
+        bool smaller = raytracer.width / (2 * scale) >= 16 && raytracer.height / (2 * scale) >= 16;
+        if((bestThroughput > 0 && trialTime <= limit / 20) || !smaller || std::chrono::steady_clock::now() >= end) break;
+        scale *= 2;
+    }
+    if(bestThroughput == 0)
+    {
+        cerr << "Error: a trial render at 1/" << scale << " of the size takes more than " << limit / 4
+             << " s, tune for longer. No settings written." << endl;
+        return false;
+    }
+    cout << "Tuning with trial renders at 1/" << scale << " of the size, for at most " << limit << " s." << endl;
+    report(best, bestThroughput);
+
+    //one setting at a time, the others at their best so far
+    std::vector<size_t> threads, tileWidths, clusterSizes;
+    size_t cores = ThreadPool::defaultThreads();
+    for(size_t t = 1; t <= 2 * cores; t *= 2) threads.push_back(t);
+    if(std::find(threads.begin(), threads.end(), cores) == threads.end()) threads.push_back(cores);
+    for(size_t w = Image::TILE_SIZE / 2; w <= 8 * Image::TILE_SIZE; w *= 2) tileWidths.push_back(w);
+    if(hasMeshes)
+        for(size_t c = 8; c <= 128; c *= 2) clusterSizes.push_back(c);
+    std::vector<size_t> *candidates[3] = {&threads, &tileWidths, &clusterSizes};
+    std::vector<Settings> tried(1, best);
+
+    bool timeUp = false;
+    int trials = 1;
+    for(int s = 0; s < 3 && !timeUp; ++s)
+    {
+        for(size_t c = 0; c < candidates[s]->size(); ++c)
+        {
+            Settings settings = best;
+            size_t *setting = s == 0 ? &settings.threads : s == 1 ? &settings.tileWidth : &settings.clusterSize;
+            *setting = (*candidates[s])[c];
+            bool seen = false;
+            for(size_t t = 0; t < tried.size() && !seen; ++t)
+                seen = tried[t].threads == settings.threads && tried[t].tileWidth == settings.tileWidth
+                    && tried[t].clusterSize == settings.clusterSize;
+            if(seen) continue;
+            if(seconds(started) + trialTime > limit)
+            {
+                timeUp = true;
+                break;
+            }
+            tried.push_back(settings);
+            set(raytracer, settings);
+            auto trial = std::chrono::steady_clock::now();
+            double pixels = throughput(raytracer, scale, end);
+            if(pixels == 0) //stopped at the end of the time, not comparable
+            {
+                timeUp = true;
+                break;
+            }
+            trialTime = seconds(trial);
+            ++trials;
+            report(settings, pixels);
+            //a setting has to be clearly faster to win, not by noise
+            if(pixels > 1.02 * bestThroughput)
+            {
+                bestThroughput = pixels;
+                best = settings;
+            }
+        }
+    }
+    set(raytracer, best);
+    cout << (timeUp ? "Time is up after " : "Tried all settings in ") << trials << " trials, "
+         << seconds(started) << " s. Best: threads " << best.threads << ", tile width " << best.tileWidth;
+    if(hasMeshes) cout << ", cluster size " << best.clusterSize;
+    cout << ", " << int(bestThroughput) << " pixels/s." << endl;
+    if(trials == 1)
+    {
+        cerr << "Error: no other settings were tried in " << limit << " s, tune for longer. No settings written." << endl;
+        return false;
+    }
+
+    std::ofstream out(filename.c_str());
+    out << "# written by ray --tune, " << int(bestThroughput) << " pixels/s in trial renders at 1/" << scale << " of the size\n";
+    out << "Threads: " << best.threads << "\n";
+    out << "TileWidth: " << best.tileWidth << "\n";
+    if(hasMeshes) out << "ClusterSize: " << best.clusterSize << "\n";
+    out.close();
+    if(!out)
+    {
+        cerr << "Error: writing " << filename << " failed." << endl;
+        return false;
+    }
+    cout << "Settings written to " << filename << ", renders of the scene use them from now on." << endl;
+    return true;
+}
+
+bool Autotuner::apply(Raytracer &raytracer, const std::string &filename)
+{
+    std::ifstream in(filename.c_str());
+    if(!in) return false;
+
+    Scene &scene = *raytracer.scene;
+    Settings settings = {scene.threads, scene.tileWidth, 0};
+    std::string line;
+    int number = 0;
+    while(std::getline(in, line))
+    {
+        ++number;
+        if(line.empty() || line[0] == '#') continue;
+        std::istringstream fields(line);
+        std::string key;
+        long value = 0;
+        if(!(fields >> key >> value) || value < 1)
+        {
+            cerr << "Warning: line " << number << " of " << filename << " is not a setting, the settings are not used." << endl;
+            return false;
+        }
+        if(key == "Threads:") settings.threads = value;
+        else if(key == "TileWidth:") settings.tileWidth = value;
+        else if(key == "ClusterSize:") settings.clusterSize = value;
+        else cerr << "Warning: unknown setting " << key << " in " << filename << ", ignored." << endl;
+    }
+    set(raytracer, settings);
+    cout << "Tuned settings from " << filename << ": threads " << settings.threads << ", tile width " << settings.tileWidth;
+    if(settings.clusterSize) cout << ", cluster size " << settings.clusterSize;
+    cout << "." << endl;
+    return true;
+}
@@ -0,0 +1,45 @@
+#ifndef AUTOTUNER_HPP
+#define AUTOTUNER_HPP
+
+#include <chrono>
+#include <string>
+#include "raytracer.h"
+
+/*
+    Class created for the course Computer graphics (2016 - 2017).
+    Finds the render settings that are fastest for a scene on this
+    machine: the number of threads, the width of the tiles and the
+    number of triangles in a mesh cluster. Small trial renders of the
+    whole view are timed under candidate settings, one setting at a
+    time, until all have been tried or the time is up. The best
+    settings go to a file next to the scene (scene.yaml.tune), which
+    readScene applies to later renders. The image does not change.
+*/
+
+class Autotuner
+{
+public:
+    struct Settings
+    {
+        size_t threads;
+        size_t tileWidth;   //pixels
+        size_t clusterSize; //triangles, 0 if the scene has no meshes
+    };
+
+    //the settings file of a scene file
+    static std::string sidecar(const std::string &sceneFile) { return sceneFile + ".tune"; }
+
+    //tunes the scene read by raytracer for at most seconds, applies the best
+    //settings and writes them to filename. false if no other settings could
+    //be tried in the time, nothing is written then, or if writing failed.
+    static bool tune(Raytracer &raytracer, double seconds, const std::string &filename);
+    //applies the settings in filename. false if there is no such file or it is not valid.
+    static bool apply(Raytracer &raytracer, const std::string &filename);
+
+private:
+    static void set(Raytracer &raytracer, const Settings &settings);
+    //pixels per second of a render at 1/scale of the size, 0 if it did not finish before deadline
+    static double throughput(Raytracer &raytracer, int scale, std::chrono::steady_clock::time_point deadline);
+};
+
+#endif
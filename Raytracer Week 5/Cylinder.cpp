@@ -1,8 +1,8 @@
 #include "Cylinder.h"
 #include <cmath>
 
-Cylinder::Cylinder(Point p, Vector v, double r, double l)
-    : start(p), V(v.normalized()), radius(r), length(l) {}
+Cylinder::Cylinder(Point p, Vector v, double r, double l, bool normalize)
+    : start(p), V(normalize ? v.normalized() : v), radius(r), length(l) {}
 
 Hit Cylinder::intersect(const Ray &ray)
 {
@@ -34,7 +34,7 @@ Hit Cylinder::intersect(const Ray &ray)
     return Hit(t, N, this);
 }
 
-Color Cylinder::colorAt(const Point &point)
+Color Cylinder::colorAt(const Point &point, double footprint)
 {
     return material->color;
 }
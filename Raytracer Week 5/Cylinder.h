@@ -12,10 +12,11 @@
 class Cylinder : public Object
 {
 public:
-    Cylinder(Point start, Vector V, double radius, double length);
+    //normalize false keeps an axis that already has unit length as it is
+    Cylinder(Point start, Vector V, double radius, double length, bool normalize = true);
 
     virtual Hit intersect(const Ray &ray);
-    virtual Color colorAt(const Point &point);
+    virtual Color colorAt(const Point &point, double footprint);
 
     const Point start; //starting point of the cylinder
     const Vector V; //cylinders axis.
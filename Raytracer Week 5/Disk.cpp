@@ -22,7 +22,7 @@ Hit Disk::intersect(const Ray &ray)
     return Hit(t, ray.D.dot(N) > 0 ? -N : N, this);
 }
 
-Color Disk::colorAt(const Point &point)
+Color Disk::colorAt(const Point &point, double footprint)
 {
     return material->color;
 }
\ No newline at end of file
@@ -13,11 +13,12 @@ class Disk : public Object
 {
 
 public:
-    Disk(Point pos, Vector normal, double radius = 0)
-        : position(pos), N(normal.normalized()), radius(radius) {};
+    //normalize false keeps a normal that already has unit length as it is
+    Disk(Point pos, Vector normal, double radius = 0, bool normalize = true)
+        : position(pos), N(normalize ? normal.normalized() : normal), radius(radius) {};
 
     virtual Hit intersect(const Ray &ray);
-    virtual Color colorAt(const Point &point);
+    virtual Color colorAt(const Point &point, double footprint);
 
     const Point position;
     const Vector N;
@@ -0,0 +1,345 @@
+#include "ImageWriter.hpp"
+#include "Trace.hpp"
+#include "PerfCounters.hpp"
+#include <algorithm>
+#include <string.h>
+
+static void put32(unsigned char *out, unsigned value)
+{
+    out[0] = (value >> 24) & 0xff;
+    out[1] = (value >> 16) & 0xff;
+    out[2] = (value >> 8) & 0xff;
+    out[3] = value & 0xff;
+}
+
+ImageWriter::ImageWriter(const std::string &filename)
+    : filename(filename), file(NULL), width(0), height(0), nextRow(0)
+{}
+
+ImageWriter::~ImageWriter()
+{
+    if(file && file != stdout) fclose(file);
+}
+
+bool ImageWriter::toStandardOutput(const std::string &target)
+{
+    return target == "-" || (target.size() > 2 && target.substr(target.size() - 2) == ":-");
+}
+
+ImageWriter *ImageWriter::create(const std::string &target, int pngLevel, const ToneMapper &toneMapper)
+{
+    std::string format, name = target;
+    size_t colon = target.find(':');
+    if(colon != std::string::npos && colon > 1) //not a drive letter
+    {
+        format = target.substr(0, colon);
+        name = target.substr(colon + 1);
+    }
+    else if(target.rfind('.') != std::string::npos)
+        format = target.substr(target.rfind('.') + 1);
+
+    ImageWriter *writer;
+    if(format == "ppm") writer = new PpmWriter(name);
+    else if(format == "pfm") writer = new PfmWriter(name);
+    else if(format == "raw") writer = new RawWriter(name);
+    else if(format == "exr") return NULL;
+    else writer = new PngWriter(name, PngWriter::Level(pngLevel));
+    writer->setToneMapper(toneMapper);
+    return writer;
+}
+
+bool ImageWriter::open(int w, int h)
+{
+    file = filename == "-" ? stdout : fopen(filename.c_str(), "wb");
+    if(!file)
+    {
+        std::cerr << "Error: unable to open " << filename << " for writing." << std::endl;
+        return false;
+    }
+    width = w;
+    height = h;
+    nextRow = bottomUp() ? height : 0;
+    return true;
+}
+
+bool ImageWriter::write(const void *data, size_t size)
+{
+    return fwrite(data, 1, size, file) == size;
+}
+
+bool ImageWriter::expect(int y0, int y1)
+{
+    if(!file || y0 < 0 || y1 > height || y0 > y1) return false;
+    if(bottomUp() ? y1 != nextRow : y0 != nextRow) return false;
+    nextRow = bottomUp() ? y0 : y1;
+    return true;
+}
+
+bool ImageWriter::finish()
+{
+    if(!file) return false;
+    bool ok = nextRow == (bottomUp() ? 0 : height);
+    if(file == stdout) ok = fflush(file) == 0 && ok;
+    else ok = fclose(file) == 0 && ok;
+    file = NULL;
+    if(!ok) std::cerr << "Error: writing " << filename << " failed." << std::endl;
+    return ok;
+}
+
+bool PpmWriter::begin(int w, int h)
+{
+    if(!open(w, h)) return false;
+    return fprintf(file, "P6\n%d %d\n%d\n", width, height, toneMapper.maxValue()) > 0;
+}
+
+bool PpmWriter::write_rows(const Image &img, int y0, int y1)
+{
+    if(!expect(y0, y1)) return false;
+
+    std::vector<float> rgb(3 * size_t(width));
+    std::vector<unsigned char> row(rgb.size() * toneMapper.bytesPerChannel());
+    for(int y = y0; y < y1; ++y)
+    {
+        img.get_row(y, &rgb[0]);
+        toneMapper.map_row(&rgb[0], width, y, &row[0]);
+        if(!write(&row[0], row.size())) return false;
+    }
+    return fflush(file) == 0;
+}
+
+bool PfmWriter::begin(int w, int h)
+{
+    if(!open(w, h)) return false;
+    return fprintf(file, "PF\n%d %d\n-1.0\n", width, height) > 0; //negative scale: little endian
+}
+
+bool PfmWriter::write_rows(const Image &img, int y0, int y1)
+{
+    if(!expect(y0, y1)) return false;
+
+    //PFM is little endian, as are the machines this runs on
+    std::vector<float> row(3 * size_t(width));
+    for(int y = y1 - 1; y >= y0; --y)
+    {
+        img.get_row(y, &row[0]);
+        if(!write(&row[0], row.size() * sizeof(float))) return false;
+    }
+    return fflush(file) == 0;
+}
+
+bool RawWriter::begin(int w, int h)
+{
+    return open(w, h);
+}
+
+bool RawWriter::write_rows(const Image &img, int y0, int y1)
+{
+    if(!expect(y0, y1)) return false;
+
+    std::vector<float> row(3 * size_t(width));
+    for(int y = y0; y < y1; ++y)
+    {
+        img.get_row(y, &row[0]);
+        if(!write(&row[0], row.size() * sizeof(float))) return false;
+    }
+    return fflush(file) == 0;
+}
+
+//rows are compressed in chunks of at least this many bytes, smaller chunks compress badly
+static const size_t MIN_CHUNK_BYTES = 1 << 18;
+
+PngWriter::PngWriter(const std::string &filename, Level level, size_t threads)
+    : ImageWriter(filename), adler(1), level(level), threads(threads), pool(NULL)
+{
+    LodeZlib_DeflateSettings_init(&settings);
+    switch(level)
+    {
+        case STORE:
+            settings.btype = 0;
+            settings.useLZ77 = 0;
+            break;
+        case FAST:
+            settings.btype = 1;
+            settings.windowSize = 32768;
+            settings.maxChainLength = 8;
+            break;
+        case DEFAULT:
+            break;
+        case BEST:
+            settings.windowSize = 32768;
+            break;
+    }
+}
+
+PngWriter::~PngWriter()
+{
+    delete pool;
+}
+
+bool PngWriter::parseLevel(const std::string &name, Level &level)
+{
+    for(int l = STORE; l <= BEST; ++l)
+    {
+        if(name == levelName(Level(l)))
+        {
+            level = Level(l);
+            return true;
+        }
+    }
+    return false;
+}
+
+const char *PngWriter::levelName(Level level)
+{
+    switch(level)
+    {
+        case STORE: return "store";
+        case FAST: return "fast";
+        case DEFAULT: return "default";
+        case BEST: return "best";
+    }
+    return "unknown";
+}
+
+bool PngWriter::write_chunk(const char *type, const unsigned char *data, size_t size)
+{
+    std::vector<unsigned char> chunk(size + 12);
+    put32(&chunk[0], size);
+    memcpy(&chunk[4], type, 4);
+    if(size) memcpy(&chunk[8], data, size);
+    LodePNG_chunk_generate_crc(&chunk[0]);
+    return write(&chunk[0], chunk.size());
+}
+
+bool PngWriter::begin(int w, int h)
+{
+    if(!open(w, h)) return false;
+    if(!pool) pool = new ThreadPool(threads > 1 ? threads : 0);
+    adler = 1;
+    previous.clear();
+
+    static const unsigned char signature[8] = {137, 80, 78, 71, 13, 10, 26, 10};
+    unsigned char header[13];
+    put32(header, width);
+    put32(header + 4, height);
+    header[8] = 8 * toneMapper.bytesPerChannel(); //bit depth
+    header[9] = 2;  //RGB
+    header[10] = 0; //deflate
+    header[11] = 0; //adaptive filtering
+    header[12] = 0; //no interlacing
+    return write(signature, 8) && write_chunk("IHDR", header, 13);
+}
+
+void PngWriter::convert_rows(const Image &img, unsigned char *out, int y0, int y1) const
+{
+    PerfCounters::Scope counters(PerfCounters::ENCODE);
+    std::vector<float> rgb(3 * size_t(width));
+    for(int y = y0; y < y1; ++y)
+    {
+        img.get_row(y, &rgb[0]);
+        toneMapper.map_row(&rgb[0], width, y, out + size_t(y - y0) * lineBytes());
+    }
+}
+
+void PngWriter::compress_chunk(Chunk &chunk, const unsigned char *raw, const unsigned char *above, bool final) const
+{
+    Trace::Scope trace("compressRows", 0, chunk.y0);
+    PerfCounters::Scope counters(PerfCounters::ENCODE);
+    size_t linebytes = lineBytes();
+    unsigned rows = chunk.y1 - chunk.y0;
+    Bytes filtered((linebytes + 1) * rows);
+
+    if(level == STORE)
+    {
+        //filtering does not pay off without compression, every row gets filter type 0
+        for(unsigned y = 0; y < rows; ++y)
+        {
+            filtered[y * (linebytes + 1)] = 0;
+            memcpy(&filtered[y * (linebytes + 1) + 1], raw + y * linebytes, linebytes);
+        }
+    }
+    else LodePNG_filterScanlines(&filtered[0], raw, above, linebytes, 3 * toneMapper.bytesPerChannel(), rows);
+
+    chunk.adler = LodeZlib_adler32(1, &filtered[0], filtered.size());
+    chunk.error = LodeZlib_compressPart(&chunk.data, &chunk.size, &filtered[0], filtered.size(), &settings, final);
+    if(chunk.data) Memory::add(Memory::PNG_ENCODE, chunk.size);
+}
+
+bool PngWriter::write_rows(const Image &img, int y0, int y1)
+{
+    if(!expect(y0, y1)) return false;
+    if(y1 <= y0) return true;
+
+    size_t linebytes = lineBytes();
+    int rows = y1 - y0;
+    int parts = std::max<int>(pool->size(), 1);
+    int chunkRows = std::max<int>((rows + parts - 1) / parts, (MIN_CHUNK_BYTES + linebytes - 1) / linebytes);
+    chunkRows = std::max(1, std::min(chunkRows, rows));
+
+    std::vector<Chunk> chunks;
+    for(int y = y0; y < y1; y += chunkRows)
+    {
+        Chunk chunk = {y, std::min(y + chunkRows, y1), NULL, 0, 1, 0};
+        chunks.push_back(chunk);
+    }
+
+    Bytes raw(linebytes * rows);
+    for(size_t i = 0; i < chunks.size(); ++i)
+    {
+        Chunk &chunk = chunks[i];
+        unsigned char *out = &raw[(chunk.y0 - y0) * linebytes];
+        pool->add([this, &img, out, &chunk]() { convert_rows(img, out, chunk.y0, chunk.y1); });
+    }
+    pool->wait();
+
+    //every chunk is filtered against the row above it, which is in the previous band for the first one
+    bool last = y1 == height;
+    for(size_t i = 0; i < chunks.size(); ++i)
+    {
+        Chunk &chunk = chunks[i];
+        const unsigned char *in = &raw[(chunk.y0 - y0) * linebytes];
+        const unsigned char *above = i > 0 ? in - linebytes : (previous.empty() ? NULL : &previous[0]);
+        bool final = last && i + 1 == chunks.size();
+        pool->add([this, &chunk, in, above, final]() { compress_chunk(chunk, in, above, final); });
+    }
+    pool->wait();
+
+    previous.assign(raw.end() - linebytes, raw.end());
+
+    //the zlib stream is split over the IDAT chunks, it starts with its header and ends with the checksum
+    bool ok = true;
+    for(size_t i = 0; i < chunks.size(); ++i)
+    {
+        Chunk &chunk = chunks[i];
+        size_t filteredSize = (linebytes + 1) * (chunk.y1 - chunk.y0);
+        adler = LodeZlib_adler32Combine(adler, chunk.adler, filteredSize);
+
+        if(chunk.error)
+        {
+            if(ok) std::cerr << "Error: PNG compression failed (LodePNG error " << chunk.error << ")." << std::endl;
+            ok = false;
+        }
+        if(ok && chunk.y0 == 0)
+        {
+            static const unsigned char header[2] = {0x78, 0x01}; //deflate with 32K window, no dictionary
+            ok = write_chunk("IDAT", header, 2);
+        }
+        if(ok) ok = write_chunk("IDAT", chunk.data, chunk.size);
+        if(ok && last && i + 1 == chunks.size())
+        {
+            unsigned char checksum[4];
+            put32(checksum, adler);
+            ok = write_chunk("IDAT", checksum, 4);
+        }
+        if(chunk.data) Memory::remove(Memory::PNG_ENCODE, chunk.size);
+        free(chunk.data);
+    }
+    return ok && fflush(file) == 0;
+}
+
+bool PngWriter::finish()
+{
+    if(!file) return false;
+    bool ok = nextRow == height && write_chunk("IEND", NULL, 0);
+    return ImageWriter::finish() && ok;
+}
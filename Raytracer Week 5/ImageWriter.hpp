@@ -0,0 +1,151 @@
+#ifndef IMAGEWRITER_HPP
+#define IMAGEWRITER_HPP
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include "image.h"
+#include "lodepng.h"
+#include "ThreadPool.hpp"
+#include "ToneMapper.hpp"
+#include "Memory.hpp"
+
+/*
+    Class created for the course Computer graphics (2016 - 2017).
+    Writes an image to a file a band of rows at a time, so rows can be
+    written (and discarded) as soon as they are rendered. The file name
+    "-" writes to standard output, which is flushed after every band so
+    a consumer on the other end of a pipe gets the rows right away.
+    8 and 16 bit formats convert the rows with the writer's ToneMapper,
+    float formats store the rendered values as they are.
+*/
+
+class ImageWriter
+{
+public:
+    ImageWriter(const std::string &filename);
+    virtual ~ImageWriter();
+
+    virtual bool begin(int width, int height) = 0;
+    //the next rows: top to bottom, or bottom to top for writers that are bottomUp
+    virtual bool write_rows(const Image &img, int y0, int y1) = 0;
+    virtual bool finish();
+    virtual bool bottomUp() const { return false; }
+
+    void setToneMapper(const ToneMapper &mapper) { toneMapper = mapper; } //before begin
+
+    //a writer for "name.ext" or "format:name" (png, ppm, pfm or raw), the name "-"
+    //is standard output. NULL for formats that need the whole image (exr).
+    static ImageWriter *create(const std::string &target, int pngLevel,
+                               const ToneMapper &toneMapper = ToneMapper());
+    static bool toStandardOutput(const std::string &target);
+
+protected:
+    std::string filename;
+    FILE *file;
+    int width;
+    int height;
+    int nextRow; //first row of the next band (one past it for bottomUp writers)
+    ToneMapper toneMapper;
+
+    bool open(int width, int height);
+    bool write(const void *data, size_t size);
+    bool expect(int y0, int y1); //checks the band is the next one and advances
+};
+
+/*
+    Binary PPM (P6), 8 or 16 bits per channel, top to bottom.
+*/
+
+class PpmWriter : public ImageWriter
+{
+public:
+    PpmWriter(const std::string &filename) : ImageWriter(filename) { }
+
+    virtual bool begin(int width, int height);
+    virtual bool write_rows(const Image &img, int y0, int y1);
+};
+
+/*
+    Portable float map, 32 bit little endian floats. The format stores
+    the rows bottom to top, so the image is rendered bottom band first.
+*/
+
+class PfmWriter : public ImageWriter
+{
+public:
+    PfmWriter(const std::string &filename) : ImageWriter(filename) { }
+
+    virtual bool begin(int width, int height);
+    virtual bool write_rows(const Image &img, int y0, int y1);
+    virtual bool bottomUp() const { return true; }
+};
+
+/*
+    Headerless 32 bit float RGB rows in native byte order, top to bottom.
+*/
+
+class RawWriter : public ImageWriter
+{
+public:
+    RawWriter(const std::string &filename) : ImageWriter(filename) { }
+
+    virtual bool begin(int width, int height);
+    virtual bool write_rows(const Image &img, int y0, int y1);
+};
+
+/*
+    8 or 16 bit RGB PNG writer. Every band of rows is filtered and deflated on
+    its own and stored in its own IDAT chunks, so memory use is bounded by
+    the band size instead of the image size. Large bands are split into
+    chunks of rows that are filtered and deflated on a thread pool, the
+    chunks end on a byte boundary so their deflate streams can be joined.
+*/
+
+class PngWriter : public ImageWriter
+{
+public:
+    enum Level
+    {
+        STORE,   //no compression at all
+        FAST,    //fixed huffman codes, short LZ77 window
+        DEFAULT, //dynamic huffman codes, 2K window
+        BEST     //dynamic huffman codes, full 32K window
+    };
+
+    PngWriter(const std::string &filename, Level level = DEFAULT, size_t threads = ThreadPool::defaultThreads());
+    ~PngWriter();
+
+    virtual bool begin(int width, int height);
+    virtual bool write_rows(const Image &img, int y0, int y1);
+    virtual bool finish();
+
+    static bool parseLevel(const std::string &name, Level &level);
+    static const char *levelName(Level level);
+
+protected:
+    struct Chunk
+    {
+        int y0, y1;
+        unsigned char *data; //deflated rows
+        size_t size;
+        unsigned adler;      //of the filtered rows
+        unsigned error;
+    };
+
+    unsigned adler;
+    Level level;
+    size_t threads;
+    ThreadPool *pool;
+    typedef std::vector<unsigned char, Memory::Allocator<unsigned char, Memory::PNG_ENCODE> > Bytes;
+
+    Bytes previous; //last unfiltered row, the filters need it
+    LodeZlib_DeflateSettings settings;
+
+    size_t lineBytes() const { return 3 * size_t(width) * toneMapper.bytesPerChannel(); }
+    void convert_rows(const Image &img, unsigned char *out, int y0, int y1) const;
+    void compress_chunk(Chunk &chunk, const unsigned char *raw, const unsigned char *above, bool final) const;
+    bool write_chunk(const char *type, const unsigned char *data, size_t size);
+};
+
+#endif
@@ -0,0 +1,75 @@
+#include "Memory.hpp"
+#include <iostream>
+#include <stdio.h>
+
+std::atomic<size_t> Memory::currentBytes[CATEGORIES + 1];
+std::atomic<size_t> Memory::peakBytes[CATEGORIES + 1];
+
+void Memory::raisePeak(int index, size_t bytes)
+{
+    size_t peak = peakBytes[index].load(std::memory_order_relaxed);
+    while(bytes > peak && !peakBytes[index].compare_exchange_weak(peak, bytes, std::memory_order_relaxed)) { }
+}
+
+void Memory::add(Category category, size_t bytes)
+{
+    raisePeak(category, currentBytes[category].fetch_add(bytes, std::memory_order_relaxed) + bytes);
+    raisePeak(CATEGORIES, currentBytes[CATEGORIES].fetch_add(bytes, std::memory_order_relaxed) + bytes);
+}
+
+void Memory::remove(Category category, size_t bytes)
+{
+    currentBytes[category].fetch_sub(bytes, std::memory_order_relaxed);
+    currentBytes[CATEGORIES].fetch_sub(bytes, std::memory_order_relaxed);
+}
+
+size_t Memory::current(Category category)
+{
+    return currentBytes[category].load();
+}
+
+size_t Memory::peak(Category category)
+{
+    return peakBytes[category].load();
+}
+
+size_t Memory::currentTotal()
+{
+    return currentBytes[CATEGORIES].load();
+}
+
+size_t Memory::peakTotal()
+{
+    return peakBytes[CATEGORIES].load();
+}
+
+const char *Memory::name(Category category)
+{
+    static const char *names[CATEGORIES] = {"objects", "triangles", "textures", "yaml", "framebuffer", "png encode"};
+    return names[category];
+}
+
+void Memory::printReport(std::ostream &out)
+{
+    out << "Memory (current / peak bytes):\n";
+    for(int c = 0; c < CATEGORIES; ++c)
+        out << "    " << name(Category(c)) << ": " << current(Category(c)) << " / " << peak(Category(c)) << ".\n";
+    out << "    total: " << currentTotal() << " / " << peakTotal() << "." << std::endl;
+}
+
+bool Memory::writeJson(const std::string &filename)
+{
+    FILE *file = fopen(filename.c_str(), "w");
+    if(!file)
+    {
+        std::cerr << "Error: unable to open " << filename << " for writing." << std::endl;
+        return false;
+    }
+    fprintf(file, "{\n  \"memory\": {\n");
+    for(int c = 0; c < CATEGORIES; ++c)
+        fprintf(file, "    \"%s\": {\"current\": %zu, \"peak\": %zu},\n", name(Category(c)), current(Category(c)), peak(Category(c)));
+    fprintf(file, "    \"total\": {\"current\": %zu, \"peak\": %zu}\n  }\n}\n", currentTotal(), peakTotal());
+    bool written = fclose(file) == 0;
+    if(!written) std::cerr << "Error: writing " << filename << " failed." << std::endl;
+    return written;
+}
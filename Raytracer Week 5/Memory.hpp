@@ -0,0 +1,99 @@
+#ifndef MEMORY_HPP
+#define MEMORY_HPP
+
+#include <atomic>
+#include <memory>
+#include <ostream>
+#include <string>
+
+/*
+    Class created for the course Computer graphics (2016 - 2017).
+    Counts the bytes the raytracer holds, per category, with the current
+    and the highest (peak) number of every category and of all together.
+    Containers count through an Allocator, classes allocated with new by
+    deriving from Counted, and other buffers by calling add and remove.
+    Out-of-core framebuffers live in a mapped file and are not counted.
+*/
+
+class Memory
+{
+public:
+    enum Category
+    {
+        OBJECTS,        //scene objects, materials and lights
+        TRIANGLES,      //mesh triangles and clusters
+        TEXTURES,       //texels of decoded textures
+        YAML,           //nodes of the YAML parse tree
+        FRAMEBUFFER,    //render target, depth and cost buffers
+        PNG_ENCODE,     //rows being filtered and compressed
+        CATEGORIES
+    };
+
+    static void add(Category category, size_t bytes);
+    static void remove(Category category, size_t bytes);
+
+    static size_t current(Category category);
+    static size_t peak(Category category);
+    static size_t currentTotal();
+    static size_t peakTotal(); //the most held at once, not the sum of the peaks
+    static const char *name(Category category);
+
+    static void printReport(std::ostream &out);
+    static bool writeJson(const std::string &filename); //false if failed
+
+    //a std::allocator that counts what it holds
+    template <typename T, Category C>
+    class Allocator
+    {
+    public:
+        typedef T value_type;
+        template <typename U> struct rebind { typedef Allocator<U, C> other; };
+
+        Allocator() { }
+        template <typename U> Allocator(const Allocator<U, C>&) { }
+
+        T *allocate(size_t n)
+        {
+            T *p = std::allocator<T>().allocate(n);
+            Memory::add(C, n * sizeof(T));
+            return p;
+        }
+
+        void deallocate(T *p, size_t n)
+        {
+            Memory::remove(C, n * sizeof(T));
+            std::allocator<T>().deallocate(p, n);
+        }
+
+        template <typename U> bool operator==(const Allocator<U, C>&) const { return true; }
+        template <typename U> bool operator!=(const Allocator<U, C>&) const { return false; }
+    };
+
+    //counts the objects of a derived class created with new, at their real size
+    //when they are deleted through a base with a virtual destructor
+    template <Category C>
+    class Counted
+    {
+    public:
+        static void *operator new(size_t size)
+        {
+            void *p = ::operator new(size);
+            Memory::add(C, size);
+            return p;
+        }
+
+        static void operator delete(void *p, size_t size)
+        {
+            Memory::remove(C, size);
+            ::operator delete(p);
+        }
+    };
+
+private:
+    static std::atomic<size_t> currentBytes[CATEGORIES + 1]; //the last one is the total
+    static std::atomic<size_t> peakBytes[CATEGORIES + 1];
+
+    static void raisePeak(int index, size_t bytes);
+};
+
+#endif
@@ -1,39 +1,114 @@
 #include "Mesh.hpp"
+#include "TextureCache.hpp"
+#include "ObjReader.hpp"
+#include "TraceCounters.hpp"
+#include "Trace.hpp"
+#include <algorithm>
 
-Mesh::Mesh(const std::string &str, const Vector &pos, float scale, Material *defaultmat)
+const size_t Mesh::CLUSTER_SIZE;
+
+Mesh::Mesh(Material *defaultmat)
 {
     this->material = defaultmat;
+    bounding_sphere = new Sphere(Point(), 0);
+}
 
-    GLMmodel *model = glmReadOBJ(str.c_str());
-    //glmWeld(model, 0.00001);
-    glmUnitize(model);
-    glmFacetNormals(model);
-    glmVertexNormals(model, 90);
+bool Mesh::load(const std::string &str, const Vector &pos, float scale, std::ostream &log, std::string &error)
+{
+    delete bounding_sphere;
+    bounding_sphere = new Sphere(pos, 0);
+
+    if(MeshFile::isMeshFile(str))
+    {
+        MeshFile file;
+        if(!file.open(str))
+        {
+            error = file.error();
+            return false;
+        }
+        compiledModel(file, pos, scale);
+        delete bounding_sphere;
+        bounding_sphere = new Sphere(pos, scale * 1.74);
+        log << "Mesh read: " << triangles.size() << " triangles!" << std::endl;
+        return true;
+    }
+
+    ObjReader reader;
+    GLMmodel *model = reader.read(str);
+    if(!model)
+    {
+        error = reader.error();
+        return false;
+    }
+    prepare(model);
     if(scale != 1.0f) glmScale(model, scale);
 
-    std::cout << "Reading mesh: \n";
-    std::cout << "numvertices: " << model->numvertices << "\n";
-    std::cout << "numnormals: " << model->numnormals << "\n";
-    std::cout << "numtexcoords: " << model->numtexcoords << "\n";
-    std::cout << "nummaterials: " << model->nummaterials << "\n";
-    std::cout << "numgroups: " << model->numgroups << "\n";
+    log << "Reading mesh: \n";
+    log << "numvertices: " << model->numvertices << "\n";
+    log << "numnormals: " << model->numnormals << "\n";
+    log << "numtexcoords: " << model->numtexcoords << "\n";
+    log << "nummaterials: " << model->nummaterials << "\n";
+    log << "numgroups: " << model->numgroups << "\n";
     triangles.reserve(model->numtriangles);
     
+    Trace::Scope trace("buildTriangles");
     if(model->numgroups > 1) 
         complexModel(model, pos);
     else simpleModel(model, pos);
     //simpleModel(model, pos);
+    buildClusters();
     
     //1.74(sqrt(3)) because this is the max distance from the centre.
+    delete bounding_sphere;
     bounding_sphere = new Sphere(pos, scale * 1.74);
 
-    std::cout << "Mesh read: " << triangles.size() << " triangles!" << std::endl;
+    log << "Mesh read: " << triangles.size() << " triangles!" << std::endl;
     glmDelete(model);
+    return true;
+}
+
+Mesh::Mesh(const Point &center, double radius, Material *defaultmat)
+{
+    this->material = defaultmat;
+    bounding_sphere = new Sphere(center, radius);
 }
 
 Mesh::~Mesh()
 {
     delete bounding_sphere;
+    for(size_t i = 0; i < materials.size(); ++i)
+        delete materials[i];
+}
+
+void Mesh::prepare(GLMmodel *model)
+{
+    Trace::Scope trace("prepareMesh");
+    glmWeld(model, 0.00001);
+    glmUnitize(model);
+    glmFacetNormals(model);
+    glmVertexNormals(model, 90);
+}
+
+//whether the whole line of the ray, also behind its origin, passes through the box.
+//Triangle::intersect returns hits behind the origin too, and the closest of those
+//is what the mesh has always returned.
+static bool crosses(const Ray &ray, const Point &min, const Point &max)
+{
+    double near = -std::numeric_limits<double>::infinity();
+    double far = std::numeric_limits<double>::infinity();
+    for(int a = 0; a < 3; ++a)
+    {
+        if(ray.D.data[a] == 0.0)
+        {
+            if(ray.O.data[a] < min.data[a] || ray.O.data[a] > max.data[a]) return false;
+            continue;
+        }
+        double t0 = (min.data[a] - ray.O.data[a]) / ray.D.data[a];
+        double t1 = (max.data[a] - ray.O.data[a]) / ray.D.data[a];
+        near = std::max(near, std::min(t0, t1));
+        far = std::min(far, std::max(t0, t1));
+    }
+    return near <= far;
 }
 
 Hit Mesh::intersect(const Ray &ray)
@@ -47,20 +122,29 @@ Hit Mesh::intersect(const Ray &ray)
 
     min_hit = Hit(std::numeric_limits<double>::infinity(), Vector(), NULL);
 
-    for(size_t i = 0; i < triangles.size(); ++i)
+    size_t tests = 0;
+    for(size_t c = 0; c < clusters.size(); ++c)
     {
-        Hit hit = triangles[i].intersect(ray);
-        if(hit.t < min_hit.t)
+        if(!crosses(ray, clusters[c].min, clusters[c].max)) continue;
+
+        tests += clusters[c].count;
+        for(size_t i = clusters[c].first; i < clusters[c].first + clusters[c].count; ++i)
         {
-            min_hit = hit;
+            Hit hit = triangles[i].intersect(ray);
+            if(hit.t < min_hit.t)
+            {
+                min_hit = hit;
+            }
         }
     }
+    TraceCounters::current.steps += clusters.size();
+    TraceCounters::current.tests += tests;
 
     //min_hit.object = this;
     return min_hit;
 }
 
-Color Mesh::colorAt(const Point &point)
+Color Mesh::colorAt(const Point &point, double footprint)
 {
     return material->color;
 }
@@ -90,6 +174,10 @@ void Mesh::getMaterials(GLMmodel *model)
 
         material->n = toparse->shininess;
 
+        //groups share the texture of the mesh material.
+        material->texture = this->material->texture;
+        TextureCache::retain(material->texture);
+
         materials.push_back(material);
     }
 }
@@ -104,8 +192,8 @@ void Mesh::complexModel(GLMmodel *model, const Vector &pos)
         for(size_t i = 0; i < group->numtriangles; ++i)
         {
             Point v0(
-                model->vertices[3 * model->triangles[group->triangles[i]].vindices[0]+0] + pos.y,
-                model->vertices[3 * model->triangles[group->triangles[i]].vindices[0]+1] + pos.x,
+                model->vertices[3 * model->triangles[group->triangles[i]].vindices[0]+0] + pos.x,
+                model->vertices[3 * model->triangles[group->triangles[i]].vindices[0]+1] + pos.y,
                 model->vertices[3 * model->triangles[group->triangles[i]].vindices[0]+2] + pos.z);
 
             Point v1(
@@ -134,11 +222,10 @@ void Mesh::complexModel(GLMmodel *model, const Vector &pos)
                 model->normals[3 * model->triangles[group->triangles[i]].nindices[2]+2]);
             
             Triangle tri(v0, v1, v2, n0, n1, n2);
-            tri.material = materials[group->material];
+            tri.material = group->material < materials.size() ? materials[group->material] : material;
 
             if(material->texture != NULL)
             {
-                tri.material->texture = material->texture;
                 tri.t0 = Vector(
                     model->texcoords[2 * model->triangles[group->triangles[i]].tindices[0]+0],
                     model->texcoords[2 * model->triangles[group->triangles[i]].tindices[0]+1],
@@ -198,4 +285,111 @@ void Mesh::simpleModel(GLMmodel *model, const Vector &pos)
         tri.material = material;
         triangles.push_back(tri);
     }
-}
\ No newline at end of file
+}
+
+void Mesh::compiledModel(const MeshFile &file, const Vector &pos, float scale)
+{
+    const MeshFile::Header &header = file.header();
+    const MeshFile::Vertex *vertices = file.vertices();
+    const uint32_t *indices = file.indices();
+    const uint32_t *triangleMaterials = file.triangleMaterials();
+    bool grouped = header.flags & MeshFile::MATERIALS;
+
+    if(grouped)
+    {
+        materials.reserve(header.numMaterials);
+        for(size_t i = 0; i < header.numMaterials; ++i)
+        {
+            const MeshFile::Material &toparse = file.materials()[i];
+            Material *material = new Material();
+            material->color = Color(toparse.diffuse[0], toparse.diffuse[1], toparse.diffuse[2]);
+            material->kd = (toparse.diffuse[0] + toparse.diffuse[1] + toparse.diffuse[2]) / 3;
+            material->ka = (toparse.ambient[0] + toparse.ambient[1] + toparse.ambient[2]) / 3;
+            material->ks = (toparse.specular[0] + toparse.specular[1] + toparse.specular[2]) / 3;
+            material->n = toparse.shininess;
+            material->texture = this->material->texture;
+            TextureCache::retain(material->texture);
+            materials.push_back(material);
+        }
+    }
+
+    //the positions are unitized, scaled here as glmScale does it
+    triangles.reserve(header.numTriangles);
+    for(size_t i = 0; i < header.numTriangles; ++i)
+    {
+        const MeshFile::Vertex &a = vertices[indices[3 * i + 0]];
+        const MeshFile::Vertex &b = vertices[indices[3 * i + 1]];
+        const MeshFile::Vertex &c = vertices[indices[3 * i + 2]];
+
+        Triangle tri(
+            Point(GLfloat(a.position[0] * scale) + pos.x, GLfloat(a.position[1] * scale) + pos.y, GLfloat(a.position[2] * scale) + pos.z),
+            Point(GLfloat(b.position[0] * scale) + pos.x, GLfloat(b.position[1] * scale) + pos.y, GLfloat(b.position[2] * scale) + pos.z),
+            Point(GLfloat(c.position[0] * scale) + pos.x, GLfloat(c.position[1] * scale) + pos.y, GLfloat(c.position[2] * scale) + pos.z),
+            Vector(a.normal[0], a.normal[1], a.normal[2]),
+            Vector(b.normal[0], b.normal[1], b.normal[2]),
+            Vector(c.normal[0], c.normal[1], c.normal[2]));
+        tri.material = material;
+
+        if(grouped)
+        {
+            if(triangleMaterials[i] != MeshFile::NO_MATERIAL) tri.material = materials[triangleMaterials[i]];
+            if(material->texture != NULL)
+            {
+                tri.t0 = Vector(a.texcoord[0], a.texcoord[1], 0);
+                tri.t1 = Vector(b.texcoord[0], b.texcoord[1], 0);
+                tri.t2 = Vector(c.texcoord[0], c.texcoord[1], 0);
+            }
+        }
+        triangles.push_back(tri);
+    }
+
+    for(size_t i = 0; i < header.numClusters; ++i)
+    {
+        const MeshFile::Cluster &cluster = file.clusters()[i];
+        Point min, max;
+        for(int a = 0; a < 3; ++a)
+        {
+            double low = cluster.min[a] * scale + pos.data[a];
+            double high = cluster.max[a] * scale + pos.data[a];
+            min.data[a] = std::min(low, high);
+            max.data[a] = std::max(low, high);
+        }
+        addCluster(min, max, cluster.first, cluster.count);
+    }
+}
+
+void Mesh::setClusterSize(size_t size)
+{
+    clusters.clear();
+    buildClusters(std::max<size_t>(size, 1));
+}
+
+void Mesh::buildClusters(size_t size)
+{
+    for(size_t first = 0; first < triangles.size(); first += size)
+    {
+        size_t count = std::min(size, triangles.size() - first);
+        Point min = triangles[first].v0;
+        Point max = min;
+        for(size_t i = first; i < first + count; ++i)
+        {
+            const Point *corners[3] = {&triangles[i].v0, &triangles[i].v1, &triangles[i].v2};
+            for(int j = 0; j < 3; ++j)
+                for(int a = 0; a < 3; ++a)
+                {
+                    min.data[a] = std::min(min.data[a], corners[j]->data[a]);
+                    max.data[a] = std::max(max.data[a], corners[j]->data[a]);
+                }
+        }
+        addCluster(min, max, first, count);
+    }
+}
+
+void Mesh::addCluster(Point min, Point max, size_t first, size_t count)
+{
+    //Triangle::intersect accepts hits a rounding error outside the triangle,
+    //so the boxes are made a little larger than the triangles
+    double pad = 1e-3 * (max - min).length() + 1e-6;
+    Cluster cluster = {min - pad, max + pad, first, count};
+    clusters.push_back(cluster);
+}
@@ -4,11 +4,14 @@
 #include <string>
 #include <vector>
 #include <limits>
+#include <ostream>
 
 #include "glm.h"
 #include "object.h"
 #include "sphere.h"
 #include "Triangle.hpp"
+#include "MeshFile.hpp"
+#include "Memory.hpp"
 
 class Mesh : public Object
 {
@@ -16,18 +19,44 @@ class Mesh : public Object
 public:
     Sphere *bounding_sphere;
     std::vector<Material*> materials;
-    std::vector<Triangle> triangles;
-
-    Mesh(const std::string &str, const Vector &pos, float scale, Material* defmat);
+    std::vector<Triangle, Memory::Allocator<Triangle, Memory::TRIANGLES> > triangles;
+
+    //bounds of runs of consecutive triangles, only the runs whose box the
+    //ray's line passes through are tested
+    struct Cluster
+    {
+        Point min, max;
+        size_t first, count;
+    };
+    std::vector<Cluster, Memory::Allocator<Cluster, Memory::TRIANGLES> > clusters;
+    static const size_t CLUSTER_SIZE = 32; //triangles per cluster, unless set with setClusterSize
+
+    //an empty mesh, to be loaded later (on another thread when a scene is read)
+    Mesh(Material *defmat);
+    //an empty mesh within the bounding sphere, its creator (a scene package) fills it
+    Mesh(const Point &center, double radius, Material *defmat);
     ~Mesh();
     
     virtual Hit intersect(const Ray &ray);
-    virtual Color colorAt(const Point &hit);
+    virtual Color colorAt(const Point &hit, double footprint);
+
+    //reads str, an OBJ file or a mesh compiled by tools/meshc. messages go
+    //to log. false if failed, error tells why and the mesh stays empty.
+    bool load(const std::string &str, const Vector &pos, float scale, std::ostream &log, std::string &error);
+
+    //rebuilds the clusters with size triangles each, the autotuner tries a few
+    void setClusterSize(size_t size);
+
+    //welds, unitizes and generates normals, as for rendering
+    static void prepare(GLMmodel *model);
 
 protected:
     void getMaterials(GLMmodel *model);
     void complexModel(GLMmodel *model, const Vector &pos);
     void simpleModel(GLMmodel *model, const Vector &pos);
+    void compiledModel(const MeshFile &file, const Vector &pos, float scale);
+    void buildClusters(size_t size = CLUSTER_SIZE);
+    void addCluster(Point min, Point max, size_t first, size_t count);
 
 };
 
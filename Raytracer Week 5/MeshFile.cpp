@@ -0,0 +1,254 @@
+#include "MeshFile.hpp"
+#include <algorithm>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <unordered_map>
+#include <vector>
+
+const uint32_t MeshFile::VERSION;
+const uint32_t MeshFile::NO_MATERIAL;
+
+static const char MAGIC[8] = {'R', 'T', 'M', 'E', 'S', 'H', '\r', '\n'};
+
+static uint64_t align16(uint64_t offset)
+{
+    return (offset + 15) & ~uint64_t(15);
+}
+
+MeshFile::MeshFile() : data(NULL), size(0) { }
+
+MeshFile::~MeshFile()
+{
+    if(data) munmap((void*)data, size);
+}
+
+bool MeshFile::isMeshFile(const std::string &filename)
+{
+    char magic[sizeof(MAGIC)];
+    FILE *file = fopen(filename.c_str(), "rb");
+    if(!file) return false;
+    bool mesh = fread(magic, 1, sizeof(magic), file) == sizeof(magic) && memcmp(magic, MAGIC, sizeof(MAGIC)) == 0;
+    fclose(file);
+    return mesh;
+}
+
+//whether count elements of elementSize bytes at offset lie within the file
+static bool inside(uint64_t offset, uint64_t count, uint64_t elementSize, uint64_t size)
+{
+    return offset % 16 == 0 && offset <= size && count <= (size - offset) / elementSize;
+}
+
+bool MeshFile::open(const std::string &filename)
+{
+    message.clear();
+    if(data) munmap((void*)data, size);
+    data = NULL;
+    size = 0;
+
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if(fd < 0)
+    {
+        message = "unable to open the file";
+        return false;
+    }
+    struct stat info;
+    if(fstat(fd, &info) != 0 || size_t(info.st_size) < sizeof(Header))
+    {
+        close(fd);
+        message = "not a compiled mesh";
+        return false;
+    }
+    void *mapped = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(mapped == MAP_FAILED)
+    {
+        message = "unable to map the file";
+        return false;
+    }
+    data = (const char*)mapped;
+    size = info.st_size;
+
+    //nothing is parsed, but nothing may point outside the file either
+    const Header &h = header();
+    if(memcmp(h.magic, MAGIC, sizeof(MAGIC)) != 0) message = "not a compiled mesh";
+    else if(h.version != VERSION) message = "compiled for another version, compile it again";
+    else if(!inside(h.vertexOffset, h.numVertices, sizeof(Vertex), size)
+        || !inside(h.indexOffset, 3 * uint64_t(h.numTriangles), sizeof(uint32_t), size)
+        || !inside(h.triangleMaterialOffset, h.numTriangles, sizeof(uint32_t), size)
+        || !inside(h.materialOffset, h.numMaterials, sizeof(Material), size)
+        || !inside(h.clusterOffset, h.numClusters, sizeof(Cluster), size))
+        message = "the file is truncated";
+    else
+    {
+        const uint32_t *index = indices();
+        const uint32_t *material = triangleMaterials();
+        for(size_t i = 0; i < 3 * size_t(h.numTriangles) && message.empty(); ++i)
+            if(index[i] >= h.numVertices) message = "a triangle has an invalid vertex";
+        for(size_t i = 0; i < h.numTriangles && message.empty(); ++i)
+            if(material[i] >= h.numMaterials && material[i] != NO_MATERIAL) message = "a triangle has an invalid material";
+        const Cluster *cluster = clusters();
+        for(size_t i = 0; i < h.numClusters && message.empty(); ++i)
+            if(cluster[i].first > h.numTriangles || cluster[i].count > h.numTriangles - cluster[i].first)
+                message = "a cluster has invalid triangles";
+    }
+
+    if(message.empty()) return true;
+    munmap((void*)data, size);
+    data = NULL;
+    size = 0;
+    return false;
+}
+
+//a corner of a triangle, corners with the same indices share a vertex
+struct Corner
+{
+    GLuint v, n, t;
+
+    bool operator==(const Corner &other) const
+    {
+        return v == other.v && n == other.n && t == other.t;
+    }
+};
+
+struct CornerHash
+{
+    size_t operator()(const Corner &c) const
+    {
+        return (size_t(c.v) * 0x9e3779b97f4a7c15ULL) ^ (size_t(c.n) * 0xc2b2ae3d27d4eb4fULL) ^ (size_t(c.t) * 0x165667b19e3779f9ULL);
+    }
+};
+
+static bool writeSection(FILE *file, uint64_t &offset, const void *section, size_t bytes)
+{
+    static const char zeros[16] = {0};
+    size_t padding = align16(offset) - offset;
+    if(fwrite(zeros, 1, padding, file) != padding) return false;
+    if(bytes && fwrite(section, 1, bytes, file) != bytes) return false;
+    offset += padding + bytes;
+    return true;
+}
+
+bool MeshFile::write(const std::string &filename, GLMmodel *model, size_t clusterSize, std::string &error)
+{
+    //the triangles in the order Mesh builds them: by group if there are groups
+    std::vector<GLuint> order;
+    std::vector<uint32_t> triangleMaterials;
+    order.reserve(model->numtriangles);
+    triangleMaterials.reserve(model->numtriangles);
+    bool groups = model->numgroups > 1;
+    if(groups)
+    {
+        for(GLMgroup *group = model->groups; group != NULL; group = group->next)
+            for(size_t i = 0; i < group->numtriangles; ++i)
+            {
+                order.push_back(group->triangles[i]);
+                triangleMaterials.push_back(group->material < model->nummaterials ? group->material : NO_MATERIAL);
+            }
+    }
+    else
+    {
+        for(size_t i = 0; i < model->numtriangles; ++i)
+        {
+            order.push_back(i);
+            triangleMaterials.push_back(NO_MATERIAL);
+        }
+    }
+
+    std::vector<Vertex> vertices;
+    std::vector<uint32_t> indices;
+    std::unordered_map<Corner, uint32_t, CornerHash> shared;
+    indices.reserve(3 * order.size());
+    for(size_t i = 0; i < order.size(); ++i)
+    {
+        const GLMtriangle &triangle = model->triangles[order[i]];
+        for(int j = 0; j < 3; ++j)
+        {
+            Corner corner = {triangle.vindices[j], triangle.nindices[j], model->texcoords ? triangle.tindices[j] : 0};
+            std::pair<std::unordered_map<Corner, uint32_t, CornerHash>::iterator, bool> found =
+                shared.insert(std::make_pair(corner, uint32_t(vertices.size())));
+            if(found.second)
+            {
+                Vertex vertex;
+                memcpy(vertex.position, &model->vertices[3 * corner.v], sizeof(vertex.position));
+                memcpy(vertex.normal, &model->normals[3 * corner.n], sizeof(vertex.normal));
+                vertex.texcoord[0] = corner.t ? model->texcoords[2 * corner.t + 0] : 0.0f;
+                vertex.texcoord[1] = corner.t ? model->texcoords[2 * corner.t + 1] : 0.0f;
+                vertices.push_back(vertex);
+            }
+            indices.push_back(found.first->second);
+        }
+    }
+
+    std::vector<Material> materials(model->nummaterials);
+    for(size_t i = 0; i < materials.size(); ++i)
+    {
+        memset(&materials[i], 0, sizeof(Material));
+        memcpy(materials[i].diffuse, model->materials[i].diffuse, sizeof(materials[i].diffuse));
+        memcpy(materials[i].ambient, model->materials[i].ambient, sizeof(materials[i].ambient));
+        memcpy(materials[i].specular, model->materials[i].specular, sizeof(materials[i].specular));
+        materials[i].shininess = model->materials[i].shininess;
+    }
+
+    Header header;
+    memset(&header, 0, sizeof(header));
+    clusterSize = std::max<size_t>(1, clusterSize);
+    std::vector<Cluster> clusters;
+    for(size_t first = 0; first < order.size(); first += clusterSize)
+    {
+        Cluster cluster;
+        cluster.first = first;
+        cluster.count = std::min(clusterSize, order.size() - first);
+        for(int a = 0; a < 3; ++a)
+        {
+            cluster.min[a] = vertices[indices[3 * first]].position[a];
+            cluster.max[a] = cluster.min[a];
+        }
+        for(size_t i = 3 * first; i < 3 * (first + cluster.count); ++i)
+            for(int a = 0; a < 3; ++a)
+            {
+                cluster.min[a] = std::min(cluster.min[a], vertices[indices[i]].position[a]);
+                cluster.max[a] = std::max(cluster.max[a], vertices[indices[i]].position[a]);
+            }
+        for(int a = 0; a < 3; ++a)
+        {
+            header.min[a] = clusters.empty() ? cluster.min[a] : std::min(header.min[a], cluster.min[a]);
+            header.max[a] = clusters.empty() ? cluster.max[a] : std::max(header.max[a], cluster.max[a]);
+        }
+        clusters.push_back(cluster);
+    }
+
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.flags = (groups ? MATERIALS : 0) | (model->texcoords ? TEXCOORDS : 0);
+    header.numVertices = vertices.size();
+    header.numTriangles = order.size();
+    header.numMaterials = materials.size();
+    header.numClusters = clusters.size();
+    header.clusterSize = clusterSize;
+    header.vertexOffset = align16(sizeof(Header));
+    header.indexOffset = align16(header.vertexOffset + vertices.size() * sizeof(Vertex));
+    header.triangleMaterialOffset = align16(header.indexOffset + indices.size() * sizeof(uint32_t));
+    header.materialOffset = align16(header.triangleMaterialOffset + triangleMaterials.size() * sizeof(uint32_t));
+    header.clusterOffset = align16(header.materialOffset + materials.size() * sizeof(Material));
+
+    FILE *file = fopen(filename.c_str(), "wb");
+    if(!file)
+    {
+        error = "unable to create the file";
+        return false;
+    }
+    uint64_t offset = 0;
+    bool written = writeSection(file, offset, &header, sizeof(header))
+        && writeSection(file, offset, vertices.data(), vertices.size() * sizeof(Vertex))
+        && writeSection(file, offset, indices.data(), indices.size() * sizeof(uint32_t))
+        && writeSection(file, offset, triangleMaterials.data(), triangleMaterials.size() * sizeof(uint32_t))
+        && writeSection(file, offset, materials.data(), materials.size() * sizeof(Material))
+        && writeSection(file, offset, clusters.data(), clusters.size() * sizeof(Cluster));
+    written = fclose(file) == 0 && written;
+    if(!written) error = "unable to write the file";
+    return written;
+}
@@ -0,0 +1,112 @@
+#ifndef MESHFILE_HPP
+#define MESHFILE_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include "glm.h"
+
+/*
+    Class created for the course Computer graphics (2016 - 2017).
+    Compiled meshes: a binary file with the geometry of an OBJ model after
+    welding and normal generation, as Mesh prepares it, that is mapped
+    into memory and used as it is. The file holds
+
+        Header
+        Vertex[numVertices]             interleaved position, normal, texcoord
+        uint32_t[3 * numTriangles]      vertex indices of the triangles
+        uint32_t[numTriangles]          material of every triangle or NO_MATERIAL
+        Material[numMaterials]
+        Cluster[numClusters]            bounds of runs of clusterSize triangles
+
+    every section starting at a multiple of 16 bytes, in the byte order
+    of the machine that wrote it (little endian on the machines we use).
+    The version changes whenever the layout does. The OpenGL viewer has
+    its own copy of these structures in meshfile.h.
+*/
+
+class MeshFile
+{
+public:
+    static const uint32_t VERSION = 1;
+    static const uint32_t NO_MATERIAL = 0xffffffff;
+
+    enum Flags
+    {
+        MATERIALS = 1,  //the triangles have materials and texture coordinates (the model had groups)
+        TEXCOORDS = 2   //the OBJ file had texture coordinates
+    };
+
+    struct Header
+    {
+        char magic[8];  //"RTMESH\r\n"
+        uint32_t version;
+        uint32_t flags;
+        uint32_t numVertices;
+        uint32_t numTriangles;
+        uint32_t numMaterials;
+        uint32_t numClusters;
+        uint32_t clusterSize;
+        uint32_t reserved;
+        float min[3];   //bounds of all vertices
+        float max[3];
+        uint64_t vertexOffset;
+        uint64_t indexOffset;
+        uint64_t triangleMaterialOffset;
+        uint64_t materialOffset;
+        uint64_t clusterOffset;
+    };
+
+    struct Vertex
+    {
+        float position[3];
+        float normal[3];
+        float texcoord[2];
+    };
+
+    struct Material
+    {
+        float diffuse[4];
+        float ambient[4];
+        float specular[4];
+        float shininess;
+        uint32_t reserved[3];
+    };
+
+    struct Cluster
+    {
+        float min[3];
+        float max[3];
+        uint32_t first;
+        uint32_t count;
+    };
+
+    MeshFile();
+    ~MeshFile();
+
+    bool open(const std::string &filename); //false if failed, error() tells why
+    const std::string &error() const { return message; }
+
+    const Header &header() const { return *(const Header*)data; }
+    const Vertex *vertices() const { return (const Vertex*)(data + header().vertexOffset); }
+    const uint32_t *indices() const { return (const uint32_t*)(data + header().indexOffset); }
+    const uint32_t *triangleMaterials() const { return (const uint32_t*)(data + header().triangleMaterialOffset); }
+    const Material *materials() const { return (const Material*)(data + header().materialOffset); }
+    const Cluster *clusters() const { return (const Cluster*)(data + header().clusterOffset); }
+
+    //whether the file starts like a compiled mesh, without reading more of it
+    static bool isMeshFile(const std::string &filename);
+
+    //writes a model prepared by Mesh::prepare, the triangles in the order Mesh uses them
+    static bool write(const std::string &filename, GLMmodel *model, size_t clusterSize, std::string &error);
+
+private:
+    const char *data;
+    size_t size;
+    std::string message;
+
+    MeshFile(const MeshFile&);
+    MeshFile &operator=(const MeshFile&);
+};
+
+#endif
@@ -0,0 +1,513 @@
+#include "ObjReader.hpp"
+#include "Trace.hpp"
+#include <algorithm>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <iostream>
+#include <unordered_map>
+
+//files are cut into chunks of at least this size, smaller ones are not worth a task
+static const size_t MIN_CHUNK_BYTES = 1 << 22;
+
+/*
+    Number parsing
+*/
+
+static inline bool isBlank(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+static inline bool isDigit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+//the powers of ten that are exact as a float
+static const float POWERS_OF_TEN[11] = {1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f};
+
+//parses a float after optional blanks, false (and p unchanged) if there is none.
+//a mantissa of at most 2^24 and a power of ten of at most 10 are both exact as a
+//float, so one float multiplication or division rounds the number once, as strtof
+//does. anything else (long numbers, big exponents, inf, nan) goes to strtof.
+static bool parseFloat(const char *&p, const char *end, GLfloat &value)
+{
+    const char *s = p;
+    while(s < end && isBlank(*s)) ++s;
+    const char *start = s;
+
+    bool negative = false;
+    if(s < end && (*s == '-' || *s == '+')) negative = *s++ == '-';
+
+    uint64_t mantissa = 0;
+    int digits = 0;
+    int exponent = 0;
+    bool any = false;
+    bool exact = true;
+    for(; s < end && isDigit(*s); ++s, any = true)
+    {
+        if(digits < 19)
+        {
+            mantissa = 10 * mantissa + (*s - '0');
+            if(mantissa) ++digits;
+        }
+        else
+        {
+            ++exponent;
+            exact = exact && *s == '0';
+        }
+    }
+    if(s < end && *s == '.')
+    {
+        for(++s; s < end && isDigit(*s); ++s, any = true)
+        {
+            if(digits < 19)
+            {
+                mantissa = 10 * mantissa + (*s - '0');
+                if(mantissa) ++digits;
+                --exponent;
+            }
+            else exact = exact && *s == '0';
+        }
+    }
+
+    if(any && s < end && (*s == 'e' || *s == 'E'))
+    {
+        const char *e = s + 1;
+        bool negativeExponent = false;
+        if(e < end && (*e == '-' || *e == '+')) negativeExponent = *e++ == '-';
+        if(e < end && isDigit(*e))
+        {
+            int power = 0;
+            for(; e < end && isDigit(*e); ++e)
+                if(power < 100000) power = 10 * power + (*e - '0');
+            exponent += negativeExponent ? -power : power;
+            s = e;
+        }
+    }
+
+    if(any && exact && mantissa <= (uint64_t(1) << 24) && exponent >= -10 && exponent <= 10)
+    {
+        float result = float(mantissa);
+        result = exponent < 0 ? result / POWERS_OF_TEN[-exponent] : result * POWERS_OF_TEN[exponent];
+        value = GLfloat(negative ? -result : result);
+        p = s;
+        return true;
+    }
+
+    //the slow way, also for inf and nan
+    const char *token = start;
+    while(s < end && !isBlank(*s) && *s != '\n') ++s;
+    char buffer[64];
+    size_t length = std::min<size_t>(s - token, sizeof(buffer) - 1);
+    memcpy(buffer, token, length);
+    buffer[length] = 0;
+    char *after;
+    float result = strtof(buffer, &after);
+    if(after == buffer) return false;
+    value = result;
+    p = token + (after - buffer);
+    return true;
+}
+
+//parses an unsigned index, 0 if there is none
+static GLuint parseIndex(const char *&p, const char *end)
+{
+    GLuint value = 0;
+    for(; p < end && isDigit(*p); ++p) value = 10 * value + (*p - '0');
+    return value;
+}
+
+static void parseFloats(const char *p, const char *end, int count, std::vector<GLfloat> &out)
+{
+    for(int i = 0; i < count; ++i)
+    {
+        GLfloat value = 0.0f;
+        parseFloat(p, end, value);
+        out.push_back(value);
+    }
+}
+
+static std::string firstWord(const char *p, const char *end)
+{
+    while(p < end && isBlank(*p)) ++p;
+    const char *word = p;
+    while(p < end && !isBlank(*p)) ++p;
+    return std::string(word, p);
+}
+
+/*
+    OBJ
+*/
+
+ObjReader::ObjReader(size_t threads)
+    : threads(threads)
+{}
+
+//one chunk of whole lines. Like glmReadOBJ, statements are told apart by their
+//first letter and faces are split into a fan of triangles. Faces can be v, v/t,
+//v//n or v/t/n; indices are 1 based, negative (relative) ones are not supported.
+void ObjReader::parse(Chunk &chunk)
+{
+    const char *p = chunk.begin;
+    const char *end = chunk.end;
+    while(p < end)
+    {
+        const char *eol = (const char*)memchr(p, '\n', end - p);
+        if(!eol) eol = end;
+
+        while(p < eol && isBlank(*p)) ++p;
+        const char *token = p;
+        while(p < eol && !isBlank(*p)) ++p;
+        size_t length = p - token;
+
+        if(length > 0) switch(token[0])
+        {
+            case 'v':
+                if(length == 1) parseFloats(p, eol, 3, chunk.vertices);
+                else if(token[1] == 'n') parseFloats(p, eol, 3, chunk.normals);
+                else if(token[1] == 't') parseFloats(p, eol, 2, chunk.texcoords);
+                break;
+            case 'f':
+            {
+                GLMtriangle triangle;
+                memset(&triangle, 0, sizeof(triangle));
+                int corners = 0;
+                for(;;)
+                {
+                    while(p < eol && isBlank(*p)) ++p;
+                    if(p == eol || !isDigit(*p)) break;
+
+                    GLuint v = parseIndex(p, eol), t = 0, n = 0;
+                    if(p < eol && *p == '/')
+                    {
+                        t = parseIndex(++p, eol);
+                        if(p < eol && *p == '/') n = parseIndex(++p, eol);
+                    }
+                    while(p < eol && !isBlank(*p)) ++p; //whatever else the token holds
+
+                    int corner = corners < 3 ? corners : 2;
+                    if(corners >= 3)
+                    {
+                        //the next triangle of the fan shares the first and the last corner
+                        chunk.triangles.push_back(triangle);
+                        triangle.vindices[1] = triangle.vindices[2];
+                        triangle.tindices[1] = triangle.tindices[2];
+                        triangle.nindices[1] = triangle.nindices[2];
+                    }
+                    triangle.vindices[corner] = v;
+                    triangle.tindices[corner] = t;
+                    triangle.nindices[corner] = n;
+                    ++corners;
+                }
+                if(corners >= 3) chunk.triangles.push_back(triangle);
+                break;
+            }
+            case 'g':
+            {
+                //glm names groups by the rest of the line, blanks included
+                Statement statement = {'g', std::string(p, eol), chunk.triangles.size()};
+                chunk.statements.push_back(statement);
+                break;
+            }
+            case 'u':
+            {
+                Statement statement = {'u', firstWord(p, eol), chunk.triangles.size()};
+                chunk.statements.push_back(statement);
+                break;
+            }
+            case 'm':
+            {
+                Statement statement = {'m', firstWord(p, eol), chunk.triangles.size()};
+                chunk.statements.push_back(statement);
+                break;
+            }
+        }
+        p = eol + 1;
+    }
+}
+
+GLMmodel *ObjReader::read(const std::string &filename)
+{
+    Trace::Scope trace("readOBJ", filename);
+    message.clear();
+    int fd = open(filename.c_str(), O_RDONLY);
+    if(fd < 0)
+    {
+        message = "unable to open the file";
+        return NULL;
+    }
+    struct stat info;
+    if(fstat(fd, &info) != 0)
+    {
+        close(fd);
+        message = "unable to read the file";
+        return NULL;
+    }
+
+    //the file stays on disk, the page cache only keeps what is being parsed
+    size_t size = info.st_size;
+    const char *data = NULL;
+    if(size > 0)
+    {
+        void *mapped = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(mapped == MAP_FAILED)
+        {
+            close(fd);
+            message = "unable to map the file";
+            return NULL;
+        }
+        madvise(mapped, size, MADV_SEQUENTIAL);
+        data = (const char*)mapped;
+    }
+    close(fd);
+
+    ThreadPool pool(threads > 1 ? threads : 0);
+    size_t parts = std::max<size_t>(1, 4 * pool.size());
+    size_t chunkSize = std::max(MIN_CHUNK_BYTES, size / parts + 1);
+
+    //chunks end after a line end, so no line is split
+    std::vector<Chunk> chunks;
+    for(size_t begin = 0; begin < size; )
+    {
+        size_t end = std::min(size, begin + chunkSize);
+        const char *eol = end < size ? (const char*)memchr(data + end, '\n', size - end) : NULL;
+        end = eol ? eol - data + 1 : size;
+        chunks.push_back(Chunk());
+        chunks.back().begin = data + begin;
+        chunks.back().end = data + end;
+        begin = end;
+    }
+    for(size_t i = 0; i < chunks.size(); ++i)
+    {
+        Chunk *chunk = &chunks[i];
+        pool.add([chunk]()
+        {
+            parse(*chunk);
+            //the parsed pages are not needed again, only the chunk ends are shared
+            uintptr_t page = sysconf(_SC_PAGESIZE);
+            uintptr_t begin = ((uintptr_t)chunk->begin + page - 1) / page * page;
+            uintptr_t end = (uintptr_t)chunk->end / page * page;
+            if(end > begin) madvise((void*)begin, end - begin, MADV_DONTNEED);
+        });
+    }
+    pool.wait();
+
+    GLMmodel *model = build(filename, chunks, pool);
+    if(data) munmap((void*)data, size);
+    return model;
+}
+
+struct ObjGroup
+{
+    std::string name;
+    GLuint material;
+    std::vector<std::pair<size_t, size_t> > runs; //ranges of triangle indices
+};
+
+GLMmodel *ObjReader::build(const std::string &filename, std::vector<Chunk> &chunks, ThreadPool &pool)
+{
+    size_t numvertices = 0, numnormals = 0, numtexcoords = 0, numtriangles = 0;
+    std::vector<size_t> firstTriangle;
+    for(size_t i = 0; i < chunks.size(); ++i)
+    {
+        numvertices += chunks[i].vertices.size() / 3;
+        numnormals += chunks[i].normals.size() / 3;
+        numtexcoords += chunks[i].texcoords.size() / 2;
+        firstTriangle.push_back(numtriangles);
+        numtriangles += chunks[i].triangles.size();
+    }
+    firstTriangle.push_back(numtriangles);
+    if(std::max(std::max(numvertices, numnormals), std::max(numtexcoords, numtriangles)) >= 0xffffffffu)
+    {
+        message = "too many elements for a GLMmodel";
+        return NULL;
+    }
+
+    //allocated the way glmReadOBJ does it, element 0 of the arrays is unused
+    GLMmodel *model = (GLMmodel*)calloc(1, sizeof(GLMmodel));
+    model->pathname = strdup(filename.c_str());
+    model->numvertices = numvertices;
+    model->numnormals = numnormals;
+    model->numtexcoords = numtexcoords;
+    model->numtriangles = numtriangles;
+    model->vertices = (GLfloat*)malloc(sizeof(GLfloat) * 3 * (numvertices + 1));
+    model->triangles = (GLMtriangle*)malloc(sizeof(GLMtriangle) * numtriangles);
+    if(numnormals) model->normals = (GLfloat*)malloc(sizeof(GLfloat) * 3 * (numnormals + 1));
+    if(numtexcoords) model->texcoords = (GLfloat*)malloc(sizeof(GLfloat) * 2 * (numtexcoords + 1));
+
+    GLfloat *vertices = model->vertices + 3;
+    GLfloat *normals = model->normals + 3;
+    GLfloat *texcoords = model->texcoords + 2;
+    for(size_t i = 0; i < chunks.size(); ++i)
+    {
+        Chunk *chunk = &chunks[i];
+        GLMtriangle *triangles = model->triangles + firstTriangle[i];
+        GLfloat *nextVertices = vertices + chunk->vertices.size();
+        GLfloat *nextNormals = normals + chunk->normals.size();
+        GLfloat *nextTexcoords = texcoords + chunk->texcoords.size();
+        pool.add([chunk, vertices, normals, texcoords, triangles]()
+        {
+            if(!chunk->vertices.empty()) memcpy(vertices, &chunk->vertices[0], chunk->vertices.size() * sizeof(GLfloat));
+            if(!chunk->normals.empty()) memcpy(normals, &chunk->normals[0], chunk->normals.size() * sizeof(GLfloat));
+            if(!chunk->texcoords.empty()) memcpy(texcoords, &chunk->texcoords[0], chunk->texcoords.size() * sizeof(GLfloat));
+            if(!chunk->triangles.empty()) memcpy(triangles, &chunk->triangles[0], chunk->triangles.size() * sizeof(GLMtriangle));
+            std::vector<GLfloat>().swap(chunk->vertices);
+            std::vector<GLfloat>().swap(chunk->normals);
+            std::vector<GLfloat>().swap(chunk->texcoords);
+            std::vector<GLMtriangle>().swap(chunk->triangles);
+        });
+        vertices = nextVertices;
+        normals = nextNormals;
+        texcoords = nextTexcoords;
+    }
+    pool.wait();
+
+    //glm reads the material libraries before any usemtl
+    for(size_t i = 0; i < chunks.size(); ++i)
+        for(size_t s = 0; s < chunks[i].statements.size(); ++s)
+            if(chunks[i].statements[s].type == 'm') readMTL(model, chunks[i].statements[s].name);
+
+    std::unordered_map<std::string, GLuint> materialIndex;
+    for(GLuint i = model->nummaterials; i-- > 0; ) materialIndex[model->materials[i].name] = i;
+
+    //faces go to the current group, which gets the current material
+    std::vector<ObjGroup> groups(1);
+    groups[0].name = "default";
+    groups[0].material = 0;
+    std::unordered_map<std::string, size_t> groupIndex;
+    groupIndex["default"] = 0;
+    size_t current = 0;
+    GLuint material = 0;
+    for(size_t i = 0; i < chunks.size(); ++i)
+    {
+        size_t next = firstTriangle[i];
+        const std::vector<Statement> &statements = chunks[i].statements;
+        for(size_t s = 0; s < statements.size(); ++s)
+        {
+            const Statement &statement = statements[s];
+            size_t at = firstTriangle[i] + statement.triangle;
+            if(at > next) groups[current].runs.push_back(std::make_pair(next, at));
+            next = at;
+
+            if(statement.type == 'g')
+            {
+                std::unordered_map<std::string, size_t>::iterator found = groupIndex.find(statement.name);
+                if(found == groupIndex.end())
+                {
+                    found = groupIndex.insert(std::make_pair(statement.name, groups.size())).first;
+                    groups.push_back(ObjGroup());
+                    groups.back().name = statement.name;
+                }
+                current = found->second;
+                groups[current].material = material;
+            }
+            else if(statement.type == 'u')
+            {
+                std::unordered_map<std::string, GLuint>::iterator found = materialIndex.find(statement.name);
+                if(found == materialIndex.end())
+                    std::cerr << "Warning: material \"" << statement.name << "\" not found for " << filename << ", using the default." << std::endl;
+                groups[current].material = material = found == materialIndex.end() ? 0 : found->second;
+            }
+        }
+        if(firstTriangle[i + 1] > next) groups[current].runs.push_back(std::make_pair(next, firstTriangle[i + 1]));
+    }
+
+    //like glmAddGroup, every new group goes to the front of the list
+    for(size_t i = 0; i < groups.size(); ++i)
+    {
+        GLMgroup *group = (GLMgroup*)malloc(sizeof(GLMgroup));
+        group->name = strdup(groups[i].name.c_str());
+        group->material = groups[i].material;
+        group->numtriangles = 0;
+        for(size_t r = 0; r < groups[i].runs.size(); ++r)
+            group->numtriangles += groups[i].runs[r].second - groups[i].runs[r].first;
+        group->triangles = (GLuint*)malloc(sizeof(GLuint) * group->numtriangles);
+        GLuint *out = group->triangles;
+        for(size_t r = 0; r < groups[i].runs.size(); ++r)
+            for(size_t t = groups[i].runs[r].first; t < groups[i].runs[r].second; ++t)
+                *out++ = t;
+        group->next = model->groups;
+        model->groups = group;
+        model->numgroups++;
+    }
+    return model;
+}
+
+/*
+    MTL
+*/
+
+//adds the materials of a library next to the OBJ file, after glm's default material
+bool ObjReader::readMTL(GLMmodel *model, const std::string &name)
+{
+    if(!model->mtllibname) model->mtllibname = strdup(name.c_str());
+
+    std::vector<GLMmaterial> materials(model->materials, model->materials + model->nummaterials);
+    if(materials.empty())
+    {
+        GLMmaterial standard = {strdup("default"), {0.8f, 0.8f, 0.8f, 1.0f}, {0.2f, 0.2f, 0.2f, 1.0f},
+                                {0.0f, 0.0f, 0.0f, 1.0f}, {0.0f, 0.0f, 0.0f, 0.0f}, 65.0f};
+        materials.push_back(standard);
+    }
+    GLMmaterial standard = {NULL, {0.8f, 0.8f, 0.8f, 1.0f}, {0.2f, 0.2f, 0.2f, 1.0f},
+                            {0.0f, 0.0f, 0.0f, 1.0f}, {0.0f, 0.0f, 0.0f, 0.0f}, 65.0f};
+
+    std::string path = model->pathname;
+    path = path.substr(0, path.rfind('/') + 1) + name;
+    FILE *file = fopen(path.c_str(), "rb");
+    std::string text;
+    if(file)
+    {
+        char buffer[1 << 16];
+        size_t count;
+        while((count = fread(buffer, 1, sizeof(buffer), file)) > 0) text.append(buffer, count);
+        fclose(file);
+    }
+    else std::cerr << "Warning: unable to open material library " << path << "." << std::endl;
+
+    //statements are told apart by their first letters, as in glmReadMTL,
+    //so Ni sets the shininess just like Ns does
+    size_t current = 0;
+    const char *p = text.data();
+    const char *end = p + text.size();
+    while(p < end)
+    {
+        const char *eol = (const char*)memchr(p, '\n', end - p);
+        if(!eol) eol = end;
+        while(p < eol && isBlank(*p)) ++p;
+        const char *token = p;
+        while(p < eol && !isBlank(*p)) ++p;
+
+        if(p > token)
+        {
+            GLMmaterial &m = materials[current];
+            if(token[0] == 'n')
+            {
+                standard.name = strdup(firstWord(p, eol).c_str());
+                materials.push_back(standard);
+                current = materials.size() - 1;
+            }
+            else if(token[0] == 'N' && parseFloat(p, eol, m.shininess))
+                m.shininess = GLfloat(m.shininess / 1000.0) * 128.0f; //[0, 1000] to OpenGL's [0, 128]
+            else if(token[0] == 'K' && p - token > 1)
+            {
+                GLfloat *color = token[1] == 'd' ? m.diffuse : token[1] == 's' ? m.specular : token[1] == 'a' ? m.ambient : NULL;
+                for(int i = 0; color && i < 3; ++i) parseFloat(p, eol, color[i]);
+            }
+        }
+        p = eol + 1;
+    }
+
+    free(model->materials);
+    model->materials = (GLMmaterial*)malloc(sizeof(GLMmaterial) * materials.size());
+    memcpy(model->materials, &materials[0], sizeof(GLMmaterial) * materials.size());
+    model->nummaterials = materials.size();
+    return file != NULL;
+}
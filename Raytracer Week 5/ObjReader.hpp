@@ -0,0 +1,56 @@
+#ifndef OBJREADER_HPP
+#define OBJREADER_HPP
+
+#include <string>
+#include <vector>
+#include "glm.h"
+#include "ThreadPool.hpp"
+
+/*
+    Class created for the course Computer graphics (2016 - 2017).
+    Wavefront OBJ and MTL reader that builds the same GLMmodel as
+    glmReadOBJ, so the glm functions and Mesh work on it unchanged.
+    The file is memory mapped and read once: it is cut into chunks at
+    line ends which are parsed in parallel, with a hand written number
+    parser instead of fscanf. Vertex indices in faces are absolute, so the
+    chunks only have to be joined, which is done in file order for the
+    groups and materials. Free the model with glmDelete.
+*/
+
+class ObjReader
+{
+public:
+    explicit ObjReader(size_t threads = ThreadPool::defaultThreads());
+
+    GLMmodel *read(const std::string &filename); //NULL if failed, error() tells why
+    const std::string &error() const { return message; }
+
+private:
+    //a g, usemtl or mtllib line, in file order
+    struct Statement
+    {
+        char type;
+        std::string name;
+        size_t triangle; //triangles of the chunk before this statement
+    };
+
+    struct Chunk
+    {
+        const char *begin;
+        const char *end;
+        std::vector<GLfloat> vertices;
+        std::vector<GLfloat> normals;
+        std::vector<GLfloat> texcoords;
+        std::vector<GLMtriangle> triangles;
+        std::vector<Statement> statements;
+    };
+
+    size_t threads;
+    std::string message;
+
+    static void parse(Chunk &chunk);
+    bool readMTL(GLMmodel *model, const std::string &name);
+    GLMmodel *build(const std::string &filename, std::vector<Chunk> &chunks, ThreadPool &pool);
+};
+
+#endif
@@ -0,0 +1,120 @@
+#include "PartialImage.hpp"
+#include <cstdlib>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <vector>
+
+const uint32_t PartialImage::VERSION;
+
+static const char MAGIC[8] = {'R', 'T', 'P', 'A', 'R', 'T', '\n', 0};
+
+//the rows of part of parts, every part gets as many rows as the others give or take one
+static void partRows(uint32_t height, uint32_t part, uint32_t parts, uint32_t &y0, uint32_t &y1)
+{
+    y0 = uint32_t(uint64_t(height) * (part - 1) / parts);
+    y1 = uint32_t(uint64_t(height) * part / parts);
+}
+
+PartialImage::Header PartialImage::header(int width, int height, int part, int parts, const std::string &scene)
+{
+    Header h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, MAGIC, sizeof(MAGIC));
+    h.version = VERSION;
+    h.width = width;
+    h.height = height;
+    h.part = part;
+    h.parts = parts;
+    partRows(h.height, h.part, h.parts, h.y0, h.y1);
+    strncpy(h.scene, scene.c_str(), sizeof(h.scene) - 1);
+    return h;
+}
+
+bool PartialImage::parsePart(const std::string &text, int &part, int &parts)
+{
+    char *end;
+    long k = strtol(text.c_str(), &end, 10);
+    if(end == text.c_str() || *end != '/') return false;
+    const char *rest = end + 1;
+    long n = strtol(rest, &end, 10);
+    if(end == rest || *end || n < 1 || n > 1 << 20 || k < 1 || k > n) return false;
+    part = k;
+    parts = n;
+    return true;
+}
+
+bool PartialImage::sameImage(const Header &a, const Header &b)
+{
+    return a.width == b.width && a.height == b.height && a.format == b.format
+        && a.outOfCore == b.outOfCore && a.pngLevel == b.pngLevel
+        && a.toneOperator == b.toneOperator && a.toneTransfer == b.toneTransfer
+        && a.dither == b.dither && a.bits == b.bits && a.exposure == b.exposure
+        && a.parts == b.parts && strcmp(a.scene, b.scene) == 0;
+}
+
+bool PartialImage::write(const std::string &filename, const Header &header, const Image &img, std::string &error)
+{
+    FILE *file = fopen(filename.c_str(), "wb");
+    if(!file) return error = "unable to open the file", false;
+
+    bool written = fwrite(&header, sizeof(header), 1, file) == 1;
+    std::vector<float> row(3 * size_t(header.width));
+    for(uint32_t y = 0; y < header.y1 - header.y0 && written; ++y)
+    {
+        img.get_row(y, &row[0]);
+        written = fwrite(&row[0], sizeof(float), row.size(), file) == row.size();
+    }
+    if(fclose(file) != 0) written = false;
+    if(!written)
+    {
+        remove(filename.c_str());
+        error = "the disk is full or the file went away";
+    }
+    return written;
+}
+
+bool PartialImage::readHeader(const std::string &filename, Header &header, std::string &error)
+{
+    struct stat st;
+    FILE *file = fopen(filename.c_str(), "rb");
+    if(!file || fstat(fileno(file), &st) != 0)
+    {
+        if(file) fclose(file);
+        return error = "unable to open the file", false;
+    }
+    bool read = fread(&header, sizeof(header), 1, file) == 1;
+    fclose(file);
+
+    uint32_t y0 = 0, y1 = 0;
+    if(read && header.parts >= 1 && header.part >= 1 && header.part <= header.parts)
+        partRows(header.height, header.part, header.parts, y0, y1);
+    if(!read || memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0) error = "not a partial image";
+    else if(header.version != VERSION) error = "written by another version, render the part again";
+    else if(header.width < 1 || header.height < 1 || header.format > Image::FLOAT16
+        || header.parts < 1 || header.part < 1 || header.part > header.parts
+        || header.y0 != y0 || header.y1 != y1 || memchr(header.scene, 0, sizeof(header.scene)) == NULL)
+        error = "the header is invalid";
+    else if(uint64_t(st.st_size) != sizeof(header) + uint64_t(header.y1 - header.y0) * header.width * 3 * sizeof(float))
+        error = "the file is truncated";
+    else return true;
+    return false;
+}
+
+bool PartialImage::readRows(const std::string &filename, const Header &header, Image &img, std::string &error)
+{
+    FILE *file = fopen(filename.c_str(), "rb");
+    if(!file) return error = "unable to open the file", false;
+
+    bool read = fseek(file, sizeof(header), SEEK_SET) == 0;
+    std::vector<float> row(3 * size_t(header.width));
+    for(uint32_t y = header.y0; y < header.y1 && read; ++y)
+    {
+        read = fread(&row[0], sizeof(float), row.size(), file) == row.size();
+        for(uint32_t x = 0; x < header.width && read; ++x)
+            img.put_pixel(x, y, Color(row[3 * x], row[3 * x + 1], row[3 * x + 2]));
+    }
+    fclose(file);
+    if(!read) error = "the file is truncated";
+    return read;
+}
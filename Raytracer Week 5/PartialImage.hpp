@@ -0,0 +1,57 @@
+#ifndef PARTIALIMAGE_HPP
+#define PARTIALIMAGE_HPP
+
+#include <stdint.h>
+#include <string>
+#include "image.h"
+
+/*
+    Class created for the course Computer graphics (2016 - 2017).
+    Partial images: one of N bands of rows of an image, rendered by its
+    own process (ray --tiles k/N) and put together with the other parts
+    by ray --merge. The file holds
+
+        Header                      the whole image, its output settings and the rows
+        rows y0 to y1               3 * width 32 bit floats each, top to bottom
+
+    in the byte order of the machine that wrote it. The values are the
+    ones the render target held, so the merged image is written exactly
+    as a render in one process would have written it.
+*/
+
+class PartialImage
+{
+public:
+    static const uint32_t VERSION = 1;
+
+    struct Header
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t width, height;     //of the whole image
+        uint32_t format;            //Image::Format of the render target
+        int32_t outOfCore;
+        int32_t pngLevel;
+        uint32_t toneOperator, toneTransfer, dither, bits;
+        float exposure;
+        uint32_t part, parts;       //part is 1 to parts
+        uint32_t y0, y1;            //the rows in this file
+        uint32_t reserved;
+        char scene[256];            //the scene file, the parts of an image all come from the same
+    };
+
+    //a header for part of parts of an image, the rows are filled in
+    static Header header(int width, int height, int part, int parts, const std::string &scene);
+    //"k/N", 1 <= k <= N
+    static bool parsePart(const std::string &text, int &part, int &parts);
+    //whether a and b are parts of the same image
+    static bool sameImage(const Header &a, const Header &b);
+
+    //img holds rows header.y0 to header.y1 as its rows 0 to y1 - y0
+    static bool write(const std::string &filename, const Header &header, const Image &img, std::string &error);
+    static bool readHeader(const std::string &filename, Header &header, std::string &error);
+    //the rows of the file go to rows y0 to y1 of img, which has the size of the whole image
+    static bool readRows(const std::string &filename, const Header &header, Image &img, std::string &error);
+};
+
+#endif
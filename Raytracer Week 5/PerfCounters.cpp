@@ -0,0 +1,254 @@
+#include "PerfCounters.hpp"
+#include <iostream>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#endif
+
+struct PerfCounters::Thread
+{
+    size_t index;
+    int fd[EVENTS];    //-1 if the event is unavailable
+    int depth;         //of the scopes the thread is in
+    unsigned long long totals[PHASES][EVENTS][3];
+};
+
+std::atomic<bool> PerfCounters::on(false);
+thread_local PerfCounters::Thread *PerfCounters::current = NULL;
+
+std::vector<PerfCounters::Thread*> &PerfCounters::threads()
+{
+    static std::vector<Thread*> threads;
+    return threads;
+}
+
+std::mutex &PerfCounters::mutex()
+{
+    static std::mutex mutex;
+    return mutex;
+}
+
+std::string &PerfCounters::filename()
+{
+    static std::string filename;
+    return filename;
+}
+
+std::string *PerfCounters::unavailable()
+{
+    static std::string unavailable[EVENTS];
+    return unavailable;
+}
+
+const char *PerfCounters::name(Event event)
+{
+    static const char *names[EVENTS] = {"cycles", "instructions", "l1d_misses", "llc_misses",
+                                        "branch_misses", "task_clock_ns", "page_faults"};
+    return names[event];
+}
+
+const char *PerfCounters::phaseName(Phase phase)
+{
+    static const char *names[PHASES] = {"parse", "render", "encode"};
+    return names[phase];
+}
+
+void PerfCounters::start(const std::string &name)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex());
+        filename() = name;
+    }
+    on.store(true);
+    thread(); //the thread that starts counting is thread 0
+}
+
+//opens an event counting the calling thread in user space, -1 and the reason in error if it cannot
+static int openEvent(PerfCounters::Event event, std::string &error)
+{
+#ifdef __linux__
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    switch(event)
+    {
+        case PerfCounters::CYCLES: attr.config = PERF_COUNT_HW_CPU_CYCLES; break;
+        case PerfCounters::INSTRUCTIONS: attr.config = PERF_COUNT_HW_INSTRUCTIONS; break;
+        case PerfCounters::L1D_MISSES:
+            attr.type = PERF_TYPE_HW_CACHE;
+            attr.config = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+            break;
+        case PerfCounters::LLC_MISSES: attr.config = PERF_COUNT_HW_CACHE_MISSES; break;
+        case PerfCounters::BRANCH_MISSES: attr.config = PERF_COUNT_HW_BRANCH_MISSES; break;
+        case PerfCounters::TASK_CLOCK: attr.type = PERF_TYPE_SOFTWARE; attr.config = PERF_COUNT_SW_TASK_CLOCK; break;
+        case PerfCounters::PAGE_FAULTS: attr.type = PERF_TYPE_SOFTWARE; attr.config = PERF_COUNT_SW_PAGE_FAULTS; break;
+        default: error = "unknown event"; return -1;
+    }
+    int fd = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    if(fd < 0) error = strerror(errno);
+    return fd;
+#else
+    error = "perf_event_open is only available on Linux";
+    return -1;
+#endif
+}
+
+PerfCounters::Thread *PerfCounters::thread()
+{
+    if(!current)
+    {
+        Thread *thread = new Thread();
+        std::string errors[EVENTS];
+        for(int e = 0; e < EVENTS; ++e)
+            thread->fd[e] = openEvent(Event(e), errors[e]);
+
+        std::lock_guard<std::mutex> lock(mutex());
+        thread->index = threads().size();
+        threads().push_back(thread);
+        for(int e = 0; e < EVENTS; ++e)
+            if(thread->fd[e] < 0 && unavailable()[e].empty()) unavailable()[e] = errors[e];
+        current = thread;
+    }
+    return current;
+}
+
+bool PerfCounters::read(int fd, unsigned long long value[3])
+{
+    return fd >= 0 && ::read(fd, value, 3 * sizeof(unsigned long long)) == 3 * sizeof(unsigned long long);
+}
+
+PerfCounters::Scope::Scope(Phase phase) : thread(NULL), phase(phase), outer(false)
+{
+    if(!enabled()) return;
+    thread = PerfCounters::thread();
+    outer = thread->depth++ == 0;
+    if(!outer) return;
+    for(int e = 0; e < EVENTS; ++e)
+        if(!read(thread->fd[e], begin[e])) begin[e][0] = begin[e][1] = begin[e][2] = 0;
+}
+
+PerfCounters::Scope::~Scope()
+{
+    if(!thread) return;
+    --thread->depth;
+    if(!outer || !enabled()) return;
+    for(int e = 0; e < EVENTS; ++e)
+    {
+        unsigned long long end[3];
+        if(!read(thread->fd[e], end)) continue;
+        for(int i = 0; i < 3; ++i)
+            thread->totals[phase][e][i] += end[i] - begin[e][i];
+    }
+}
+
+//the count, estimated from the share of the time the event was scheduled when the counters were multiplexed
+static double scaled(const unsigned long long total[3])
+{
+    if(total[2] == 0) return 0;
+    return total[2] < total[1] ? double(total[0]) * total[1] / total[2] : double(total[0]);
+}
+
+bool PerfCounters::finish()
+{
+    if(!enabled()) return true;
+    on.store(false);
+
+    std::lock_guard<std::mutex> lock(mutex());
+    bool available[EVENTS];
+    int availableCount = 0;
+    for(int e = 0; e < EVENTS; ++e)
+    {
+        available[e] = unavailable()[e].empty();
+        availableCount += available[e];
+    }
+
+    //the totals of all threads per phase
+    double sums[PHASES][EVENTS];
+    for(int p = 0; p < PHASES; ++p)
+        for(int e = 0; e < EVENTS; ++e)
+        {
+            sums[p][e] = 0;
+            for(size_t t = 0; t < threads().size(); ++t)
+                sums[p][e] += scaled(threads()[t]->totals[p][e]);
+        }
+
+    if(availableCount == 0) std::cerr << "Warning: no performance counters are available, nothing was counted." << std::endl;
+    else
+    {
+        std::cout << "Performance counters (all threads):\n";
+        for(int p = 0; p < PHASES; ++p)
+        {
+            std::cout << "    " << phaseName(Phase(p)) << ":";
+            for(int e = 0; e < EVENTS; ++e)
+                if(available[e]) std::cout << " " << name(Event(e)) << " " << (unsigned long long)sums[p][e];
+            if(available[CYCLES] && available[INSTRUCTIONS] && sums[p][CYCLES] > 0)
+                std::cout << " ipc " << sums[p][INSTRUCTIONS] / sums[p][CYCLES];
+            std::cout << ".\n";
+        }
+        for(int e = 0; e < EVENTS; ++e)
+            if(!available[e]) std::cout << "    " << name(Event(e)) << " unavailable (" << unavailable()[e] << ").\n";
+        std::cout.flush();
+    }
+
+    bool written = true;
+    FILE *file = fopen(filename().c_str(), "w");
+    if(!file)
+    {
+        std::cerr << "Error: unable to open " << filename() << " for writing." << std::endl;
+        written = false;
+    }
+    else
+    {
+        //the phases with their totals and the counts of every thread, events that are unavailable are left out
+        fprintf(file, "{\n  \"counters\": {\n    \"unavailable\": {");
+        bool first = true;
+        for(int e = 0; e < EVENTS; ++e)
+            if(!available[e])
+            {
+                fprintf(file, "%s\"%s\": \"%s\"", first ? "" : ", ", name(Event(e)), unavailable()[e].c_str());
+                first = false;
+            }
+        fprintf(file, "},\n");
+        for(int p = 0; p < PHASES; ++p)
+        {
+            fprintf(file, "    \"%s\": {\n      \"total\": {", phaseName(Phase(p)));
+            first = true;
+            for(int e = 0; e < EVENTS; ++e)
+                if(available[e])
+                {
+                    fprintf(file, "%s\"%s\": %.0f", first ? "" : ", ", name(Event(e)), sums[p][e]);
+                    first = false;
+                }
+            fprintf(file, "},\n      \"threads\": [");
+            for(size_t t = 0; t < threads().size(); ++t)
+            {
+                fprintf(file, "%s\n        {\"thread\": %zu", t ? "," : "", threads()[t]->index);
+                for(int e = 0; e < EVENTS; ++e)
+                    if(available[e]) fprintf(file, ", \"%s\": %.0f", name(Event(e)), scaled(threads()[t]->totals[p][e]));
+                fprintf(file, "}");
+            }
+            fprintf(file, "\n      ]\n    }%s\n", p + 1 < PHASES ? "," : "");
+        }
+        fprintf(file, "  }\n}\n");
+        written = fclose(file) == 0;
+        if(!written) std::cerr << "Error: writing " << filename() << " failed." << std::endl;
+    }
+
+    //the threads keep their (closed) counters, a scope may still be open on one of them
+    for(size_t t = 0; t < threads().size(); ++t)
+        for(int e = 0; e < EVENTS; ++e)
+            if(threads()[t]->fd[e] >= 0)
+            {
+                close(threads()[t]->fd[e]);
+                threads()[t]->fd[e] = -1;
+            }
+    return written;
+}
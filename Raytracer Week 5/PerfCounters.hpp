@@ -0,0 +1,81 @@
+#ifndef PERFCOUNTERS_HPP
+#define PERFCOUNTERS_HPP
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/*
+    Class created for the course Computer graphics (2016 - 2017).
+    Hardware performance counters (cycles, instructions, cache and branch
+    misses) of the parse, render and encode phases, per thread, read with
+    perf_event_open. Every counter is opened on its own, the ones the
+    system does not offer (in a container, on a virtual machine, or with
+    a strict perf_event_paranoid) are reported as unavailable and the
+    others, like the software task clock, are still counted.
+
+        PerfCounters::Scope counters(PerfCounters::RENDER);
+
+    Scopes of a thread do not nest, an inner scope counts nothing.
+*/
+
+class PerfCounters
+{
+    struct Thread; //the counters of a thread
+
+public:
+    enum Phase { PARSE, RENDER, ENCODE, PHASES };
+
+    //counts from now on, finish prints the totals and writes them to filename
+    static void start(const std::string &filename);
+    //false if writing failed
+    static bool finish();
+
+    static bool enabled() { return on.load(std::memory_order_relaxed); }
+
+    enum Event
+    {
+        CYCLES,
+        INSTRUCTIONS,
+        L1D_MISSES,     //level 1 data cache read misses
+        LLC_MISSES,     //last level cache misses
+        BRANCH_MISSES,
+        TASK_CLOCK,     //ns on the cpu, a software counter
+        PAGE_FAULTS,    //software counter
+        EVENTS
+    };
+
+    class Scope
+    {
+    public:
+        explicit Scope(Phase phase);
+        ~Scope();
+
+    private:
+        Thread *thread; //NULL if not counting
+        Phase phase;
+        bool outer; //the outermost scope of the thread, the one that counts
+        unsigned long long begin[EVENTS][3]; //value, time enabled, time running
+
+        Scope(const Scope&);
+        Scope &operator=(const Scope&);
+    };
+
+private:
+    static std::atomic<bool> on;
+    static thread_local Thread *current; //of the calling thread, once it counts
+
+    static Thread *thread(); //of the calling thread, opens its counters
+    static bool read(int fd, unsigned long long value[3]);
+    static const char *name(Event event);
+    static const char *phaseName(Phase phase);
+
+    //the counters of threads that have finished stay until the report is written
+    static std::vector<Thread*> &threads();
+    static std::mutex &mutex();
+    static std::string &filename();
+    static std::string *unavailable(); //why an event could not be opened, per event
+};
+
+#endif
@@ -0,0 +1,637 @@
+#include "PngReader.hpp"
+#include <algorithm>
+#include <emmintrin.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+    Inflate
+*/
+
+//codes up to this many bits are decoded with a single table lookup
+static const unsigned LITERAL_BITS = 10;
+static const unsigned DISTANCE_BITS = 8;
+
+static const unsigned short LENGTH_BASE[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+static const unsigned char LENGTH_EXTRA[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+static const unsigned short DISTANCE_BASE[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129,
+    193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+static const unsigned char DISTANCE_EXTRA[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6,
+    6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+static const unsigned char CODE_LENGTH_ORDER[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+//little endian bit reader over the deflate stream, reads past the end as zero bits
+struct BitReader
+{
+    const unsigned char *in;
+    const unsigned char *end;
+    uint64_t bits;
+    unsigned count;
+    unsigned padding; //zero bytes added past the end
+
+    inline void refill()
+    {
+        if(end - in >= 8)
+        {
+            //whole bytes that fit are taken from one unaligned load
+            uint64_t next;
+            memcpy(&next, in, 8);
+            bits |= next << count;
+            in += (63 - count) >> 3;
+            count |= 56;
+            return;
+        }
+        while(count <= 56)
+        {
+            if(in < end) bits |= uint64_t(*in++) << count;
+            else ++padding;
+            count += 8;
+        }
+    }
+
+    inline unsigned peek(unsigned n) const { return unsigned(bits) & ((1u << n) - 1); }
+    inline void skip(unsigned n) { bits >>= n; count -= n; }
+    inline unsigned take(unsigned n)
+    {
+        unsigned value = peek(n);
+        skip(n);
+        return value;
+    }
+    inline bool overrun() const { return padding * 8 > count; }
+};
+
+/*
+    Canonical Huffman code: codes of at most `bits` bits are looked up in
+    `fast`, the few longer ones are decoded from the counts per length.
+    A fast entry holds symbol | length << 16, a zero length means a long code.
+*/
+struct HuffmanCode
+{
+    unsigned bits;
+    std::vector<unsigned> fast;
+    unsigned short counts[16];
+    std::vector<unsigned short> symbols; //ordered by code
+
+    bool build(const unsigned char *lengths, unsigned n, unsigned tableBits)
+    {
+        bits = tableBits;
+        memset(counts, 0, sizeof(counts));
+        for(unsigned i = 0; i < n; ++i) counts[lengths[i]]++;
+        counts[0] = 0;
+
+        //reject oversubscribed codes, incomplete ones are allowed (single distance code)
+        int left = 1;
+        for(unsigned len = 1; len < 16; ++len)
+        {
+            left = 2 * left - counts[len];
+            if(left < 0) return false;
+        }
+
+        unsigned short offsets[16];
+        offsets[1] = 0;
+        for(unsigned len = 1; len < 15; ++len) offsets[len + 1] = offsets[len] + counts[len];
+        symbols.assign(n, 0);
+        for(unsigned i = 0; i < n; ++i)
+            if(lengths[i]) symbols[offsets[lengths[i]]++] = i;
+
+        fast.assign(1u << bits, 0);
+        unsigned code = 0, index = 0;
+        for(unsigned len = 1; len <= bits; ++len)
+        {
+            for(unsigned i = 0; i < counts[len]; ++i, ++code, ++index)
+            {
+                //the stream holds codes most significant bit first
+                unsigned reversed = 0;
+                for(unsigned b = 0; b < len; ++b)
+                    reversed |= ((code >> b) & 1) << (len - 1 - b);
+                for(unsigned fill = reversed; fill < fast.size(); fill += 1u << len)
+                    fast[fill] = symbols[index] | (len << 16);
+            }
+            code <<= 1;
+        }
+        return true;
+    }
+
+    //returns the symbol or -1, needs at least 15 bits in the reader
+    inline int decode(BitReader &br) const
+    {
+        unsigned entry = fast[br.peek(bits)];
+        if(entry >> 16)
+        {
+            br.skip(entry >> 16);
+            return entry & 0xffff;
+        }
+
+        //long code, walk the lengths one bit at a time
+        int code = 0, first = 0, index = 0;
+        for(unsigned len = 1; len < 16; ++len)
+        {
+            code |= br.take(1);
+            int count = counts[len];
+            if(code - count < first) return symbols[index + (code - first)];
+            index += count;
+            first = (first + count) << 1;
+            code <<= 1;
+        }
+        return -1;
+    }
+};
+
+static bool fixedCodes(HuffmanCode &literals, HuffmanCode &distances)
+{
+    unsigned char lengths[320];
+    for(int i = 0; i < 144; ++i) lengths[i] = 8;
+    for(int i = 144; i < 256; ++i) lengths[i] = 9;
+    for(int i = 256; i < 280; ++i) lengths[i] = 7;
+    for(int i = 280; i < 288; ++i) lengths[i] = 8;
+    for(int i = 288; i < 320; ++i) lengths[i] = 5;
+    return literals.build(lengths, 288, LITERAL_BITS) && distances.build(lengths + 288, 30, DISTANCE_BITS);
+}
+
+static bool dynamicCodes(BitReader &br, HuffmanCode &literals, HuffmanCode &distances)
+{
+    br.refill();
+    unsigned nliterals = br.take(5) + 257;
+    unsigned ndistances = br.take(5) + 1;
+    unsigned ncodes = br.take(4) + 4;
+    if(nliterals > 286 || ndistances > 30) return false;
+
+    unsigned char codeLengths[19] = {0};
+    for(unsigned i = 0; i < ncodes; ++i)
+    {
+        br.refill();
+        codeLengths[CODE_LENGTH_ORDER[i]] = br.take(3);
+    }
+    HuffmanCode lengthCode;
+    if(!lengthCode.build(codeLengths, 19, 7)) return false;
+
+    unsigned char lengths[286 + 30];
+    unsigned n = 0;
+    while(n < nliterals + ndistances)
+    {
+        br.refill();
+        int symbol = lengthCode.decode(br);
+        if(symbol < 0) return false;
+        if(symbol < 16)
+        {
+            lengths[n++] = symbol;
+            continue;
+        }
+
+        unsigned char value = 0;
+        unsigned repeat;
+        if(symbol == 16)
+        {
+            if(n == 0) return false;
+            value = lengths[n - 1];
+            repeat = 3 + br.take(2);
+        }
+        else if(symbol == 17) repeat = 3 + br.take(3);
+        else repeat = 11 + br.take(7);
+
+        if(n + repeat > nliterals + ndistances) return false;
+        while(repeat--) lengths[n++] = value;
+    }
+    if(lengths[256] == 0 || br.overrun()) return false;
+
+    return literals.build(lengths, nliterals, LITERAL_BITS)
+        && distances.build(lengths + nliterals, ndistances, DISTANCE_BITS);
+}
+
+/*
+    Inflates a raw deflate stream into out, which must have exactly the
+    size of the decompressed data. Returns the number of input bytes used,
+    or 0 on failure.
+*/
+static size_t inflate(const unsigned char *in, size_t length, unsigned char *out, size_t size)
+{
+    BitReader br = {in, in + length, 0, 0, 0};
+    size_t pos = 0;
+    HuffmanCode literals, distances;
+
+    bool last = false;
+    while(!last)
+    {
+        br.refill();
+        last = br.take(1);
+        unsigned type = br.take(2);
+
+        if(type == 0)
+        {
+            //stored block: give the whole bytes in the bit buffer back to the input
+            br.skip(br.count & 7);
+            if(br.overrun()) return 0;
+            br.in -= br.count / 8 - br.padding;
+            br.bits = 0;
+            br.count = 0;
+            br.padding = 0;
+
+            if(br.end - br.in < 4) return 0;
+            unsigned len = br.in[0] | (br.in[1] << 8);
+            unsigned nlen = br.in[2] | (br.in[3] << 8);
+            br.in += 4;
+            if((len ^ 0xffff) != nlen || size_t(br.end - br.in) < len || size - pos < len) return 0;
+            memcpy(out + pos, br.in, len);
+            br.in += len;
+            pos += len;
+            continue;
+        }
+
+        if(type == 1) fixedCodes(literals, distances);
+        else if(type != 2 || !dynamicCodes(br, literals, distances)) return 0;
+
+        while(true)
+        {
+            br.refill();
+            int symbol = literals.decode(br);
+            if(symbol < 256)
+            {
+                if(symbol < 0 || pos == size) return 0;
+                out[pos++] = symbol;
+                continue;
+            }
+            if(symbol == 256) break;
+
+            symbol -= 257;
+            if(symbol >= 29) return 0;
+            size_t len = LENGTH_BASE[symbol] + br.take(LENGTH_EXTRA[symbol]);
+
+            int code = distances.decode(br);
+            if(code < 0 || code >= 30) return 0;
+            br.refill();
+            size_t distance = DISTANCE_BASE[code] + br.take(DISTANCE_EXTRA[code]);
+            if(distance > pos || size - pos < len) return 0;
+
+            unsigned char *dst = out + pos;
+            const unsigned char *src = dst - distance;
+            if(distance >= 8 && size - pos >= len + 8)
+            {
+                //8 bytes at a time, may write up to 7 bytes past the match that later symbols overwrite
+                for(size_t i = 0; i < len; i += 8) memcpy(dst + i, src + i, 8);
+            }
+            else for(size_t i = 0; i < len; ++i) dst[i] = src[i]; //overlapping run
+            pos += len;
+        }
+        if(br.overrun()) return 0;
+    }
+
+    if(pos != size) return 0;
+    //unused whole bytes in the bit buffer were not part of the stream
+    return (br.in - in) - (br.count / 8 - br.padding);
+}
+
+/*
+    Checksums
+*/
+
+static uint32_t CRC_TABLE[8][256];
+
+static void makeCrcTable()
+{
+    for(unsigned n = 0; n < 256; ++n)
+    {
+        uint32_t c = n;
+        for(int k = 0; k < 8; ++k) c = c & 1 ? 0xedb88320u ^ (c >> 1) : c >> 1;
+        CRC_TABLE[0][n] = c;
+    }
+    for(unsigned n = 0; n < 256; ++n)
+        for(int t = 1; t < 8; ++t)
+            CRC_TABLE[t][n] = (CRC_TABLE[t - 1][n] >> 8) ^ CRC_TABLE[0][CRC_TABLE[t - 1][n] & 0xff];
+}
+
+//slicing by 8: eight table lookups per 8 bytes instead of a dependent lookup per byte
+unsigned PngReader::crc32(unsigned crc, const unsigned char *data, size_t length)
+{
+    static bool initialized = (makeCrcTable(), true);
+    (void)initialized;
+
+    uint32_t c = ~crc;
+    while(length >= 8)
+    {
+        uint32_t lo, hi;
+        memcpy(&lo, data, 4);
+        memcpy(&hi, data + 4, 4);
+        lo ^= c;
+        c = CRC_TABLE[7][lo & 0xff] ^ CRC_TABLE[6][(lo >> 8) & 0xff]
+          ^ CRC_TABLE[5][(lo >> 16) & 0xff] ^ CRC_TABLE[4][lo >> 24]
+          ^ CRC_TABLE[3][hi & 0xff] ^ CRC_TABLE[2][(hi >> 8) & 0xff]
+          ^ CRC_TABLE[1][(hi >> 16) & 0xff] ^ CRC_TABLE[0][hi >> 24];
+        data += 8;
+        length -= 8;
+    }
+    while(length--) c = CRC_TABLE[0][(c ^ *data++) & 0xff] ^ (c >> 8);
+    return ~c;
+}
+
+//16 bytes at a time: the byte sums come from psadbw, the weighted sums from pmaddwd
+unsigned PngReader::adler32(unsigned adler, const unsigned char *data, size_t length)
+{
+    const unsigned BASE = 65521;
+    const size_t BLOCK = 5552 / 16 * 16; //the sums fit in 32 bits for this many bytes
+    uint32_t s1 = adler & 0xffff;
+    uint32_t s2 = adler >> 16;
+
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i weightsHigh = _mm_set_epi16(9, 10, 11, 12, 13, 14, 15, 16);
+    const __m128i weightsLow = _mm_set_epi16(1, 2, 3, 4, 5, 6, 7, 8);
+
+    while(length >= 16)
+    {
+        size_t n = std::min(length, BLOCK) & ~size_t(15);
+        length -= n;
+        s2 += s1 * n;
+
+        __m128i vs1 = zero, vs1Sum = zero, vs2 = zero;
+        for(size_t i = 0; i < n; i += 16)
+        {
+            __m128i bytes = _mm_loadu_si128((const __m128i*)(data + i));
+            vs1Sum = _mm_add_epi64(vs1Sum, vs1);
+            vs1 = _mm_add_epi64(vs1, _mm_sad_epu8(bytes, zero));
+            vs2 = _mm_add_epi32(vs2, _mm_madd_epi16(_mm_unpacklo_epi8(bytes, zero), weightsHigh));
+            vs2 = _mm_add_epi32(vs2, _mm_madd_epi16(_mm_unpackhi_epi8(bytes, zero), weightsLow));
+        }
+        data += n;
+
+        uint64_t lanes[2], sums[2];
+        uint32_t weighted[4];
+        _mm_storeu_si128((__m128i*)lanes, vs1);
+        _mm_storeu_si128((__m128i*)sums, vs1Sum);
+        _mm_storeu_si128((__m128i*)weighted, vs2);
+        s1 = (s1 + lanes[0] + lanes[1]) % BASE;
+        s2 = (s2 + 16 * (sums[0] + sums[1]) + weighted[0] + weighted[1] + weighted[2] + weighted[3]) % BASE;
+    }
+
+    while(length--)
+    {
+        s1 += *data++;
+        s2 += s1;
+    }
+    return ((s2 % BASE) << 16) | (s1 % BASE);
+}
+
+/*
+    Unfiltering
+*/
+
+static inline int paeth(int a, int b, int c)
+{
+    int pa = abs(b - c), pb = abs(a - c), pc = abs(a + b - 2 * c);
+    if(pa <= pb && pa <= pc) return a;
+    return pb <= pc ? b : c;
+}
+
+static inline __m128i load4(const unsigned char *p)
+{
+    int value;
+    memcpy(&value, p, 4);
+    return _mm_cvtsi32_si128(value);
+}
+
+static inline void store4(unsigned char *p, __m128i v)
+{
+    int value = _mm_cvtsi128_si32(v);
+    memcpy(p, &value, 4);
+}
+
+//one pixel per step for 3 and 4 byte pixels, the left neighbour makes Sub, Avg and Paeth sequential.
+//3 byte pixels are loaded and stored as 4 bytes with the fourth one kept out of the sums, so the
+//byte after the row (the next filter byte, or padding) must be readable.
+template<size_t BPP>
+static void unfilterPixels(unsigned char *row, const unsigned char *above, size_t rowBytes, int type)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i mask = _mm_cvtsi32_si128(BPP == 4 ? -1 : 0xffffff);
+    __m128i a = zero, c = zero;
+
+    for(size_t i = 0; i < rowBytes; i += BPP)
+    {
+        __m128i x = load4(row + i);
+        if(type == 1) a = _mm_add_epi8(x, a);
+        else if(type == 3)
+        {
+            //pavgb rounds up, the filter rounds down
+            __m128i b = _mm_and_si128(load4(above + i), mask);
+            __m128i average = _mm_avg_epu8(a, b);
+            average = _mm_sub_epi8(average, _mm_and_si128(_mm_xor_si128(a, b), _mm_set1_epi8(1)));
+            a = _mm_add_epi8(x, average);
+        }
+        else
+        {
+            __m128i b = _mm_unpacklo_epi8(_mm_and_si128(load4(above + i), mask), zero);
+            __m128i a16 = _mm_unpacklo_epi8(a, zero);
+            __m128i pa = _mm_sub_epi16(b, c);
+            __m128i pb = _mm_sub_epi16(a16, c);
+            __m128i pc = _mm_add_epi16(pa, pb);
+            pa = _mm_max_epi16(pa, _mm_sub_epi16(zero, pa));
+            pb = _mm_max_epi16(pb, _mm_sub_epi16(zero, pb));
+            pc = _mm_max_epi16(pc, _mm_sub_epi16(zero, pc));
+            __m128i smallest = _mm_min_epi16(pc, _mm_min_epi16(pa, pb));
+
+            //ties prefer a, then b, then c
+            __m128i isA = _mm_cmpeq_epi16(smallest, pa);
+            __m128i isB = _mm_cmpeq_epi16(smallest, pb);
+            __m128i nearest = _mm_or_si128(_mm_and_si128(isB, b), _mm_andnot_si128(isB, c));
+            nearest = _mm_or_si128(_mm_and_si128(isA, a16), _mm_andnot_si128(isA, nearest));
+
+            a = _mm_add_epi8(x, _mm_packus_epi16(nearest, nearest));
+            c = b;
+        }
+        store4(row + i, a); //the fourth byte of a 3 byte pixel is stored unchanged
+        a = _mm_and_si128(a, mask);
+    }
+}
+
+bool PngReader::unfilter(unsigned char *row, const unsigned char *above, size_t rowBytes, size_t bpp, int type) const
+{
+    switch(type)
+    {
+        case 0:
+            return true;
+        case 2:
+        {
+            size_t i = 0;
+            for(; i + 16 <= rowBytes; i += 16)
+            {
+                __m128i x = _mm_loadu_si128((const __m128i*)(row + i));
+                __m128i b = _mm_loadu_si128((const __m128i*)(above + i));
+                _mm_storeu_si128((__m128i*)(row + i), _mm_add_epi8(x, b));
+            }
+            for(; i < rowBytes; ++i) row[i] += above[i];
+            return true;
+        }
+        case 1:
+        case 3:
+        case 4:
+            if(bpp == 4) unfilterPixels<4>(row, above, rowBytes, type);
+            else if(bpp == 3) unfilterPixels<3>(row, above, rowBytes, type);
+            else
+            {
+                for(size_t i = 0; i < rowBytes; ++i)
+                {
+                    int a = i >= bpp ? row[i - bpp] : 0;
+                    int c = i >= bpp ? above[i - bpp] : 0;
+                    if(type == 1) row[i] += a;
+                    else if(type == 3) row[i] += (a + above[i]) >> 1;
+                    else row[i] += paeth(a, above[i], c);
+                }
+            }
+            return true;
+    }
+    return false;
+}
+
+/*
+    Decoding
+*/
+
+static inline unsigned read32(const unsigned char *p)
+{
+    return (unsigned(p[0]) << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+PngReader::Result PngReader::fail(const std::string &why)
+{
+    message = why;
+    return FAILED;
+}
+
+PngReader::Result PngReader::readChunks(const unsigned char *data, size_t length)
+{
+    static const unsigned char SIGNATURE[8] = {137, 80, 78, 71, 13, 10, 26, 10};
+    if(length < 8 + 25 || memcmp(data, SIGNATURE, 8) != 0) return fail("not a PNG file");
+
+    palette.assign(4 * 256, 0);
+    for(size_t i = 3; i < palette.size(); i += 4) palette[i] = 255;
+    stream.clear();
+    width = 0;
+
+    const unsigned char *p = data + 8, *end = data + length;
+    while(true)
+    {
+        if(end - p < 12) return fail("the file is truncated");
+        unsigned size = read32(p);
+        if(size > size_t(end - p) - 12) return fail("a chunk runs past the end of the file");
+        const unsigned char *type = p + 4, *body = p + 8;
+        if(crc32(0, type, size + 4) != read32(body + size)) return fail("a chunk has a wrong CRC");
+        p = body + size + 4;
+
+        if(!memcmp(type, "IHDR", 4))
+        {
+            if(size != 13) return fail("invalid header");
+            width = read32(body);
+            height = read32(body + 4);
+            bitDepth = body[8];
+            colorType = body[9];
+            static const size_t CHANNELS[7] = {1, 0, 3, 1, 2, 0, 4};
+            channels = colorType <= 6 ? CHANNELS[colorType] : 0;
+            if(width <= 0 || height <= 0 || channels == 0 || body[10] != 0 || body[11] != 0)
+                return fail("invalid header");
+            if(body[12] != 0 || (bitDepth != 8 && (bitDepth != 16 || colorType == 3)))
+                return UNSUPPORTED; //interlaced or packed pixels
+        }
+        else if(!memcmp(type, "PLTE", 4))
+        {
+            if(size % 3 || size > 3 * 256) return fail("invalid palette");
+            for(unsigned i = 0; i < size / 3; ++i) memcpy(&palette[4 * i], body + 3 * i, 3);
+        }
+        else if(!memcmp(type, "tRNS", 4))
+        {
+            if(colorType != 3) return UNSUPPORTED; //color key transparency
+            for(unsigned i = 0; i < size && i < 256; ++i) palette[4 * i + 3] = body[i];
+        }
+        else if(!memcmp(type, "IDAT", 4)) stream.insert(stream.end(), body, body + size);
+        else if(!memcmp(type, "IEND", 4)) break;
+        else if(!(type[0] & 32)) return UNSUPPORTED; //unknown critical chunk
+    }
+    if(width == 0) return fail("the header is missing");
+    return OK;
+}
+
+void PngReader::toRGBA(const unsigned char *row, unsigned char *out) const
+{
+    size_t step = bitDepth / 8; //16 bit samples keep their high byte
+    size_t pixel = channels * step;
+    unsigned char *end = out + 4 * size_t(width);
+    switch(colorType)
+    {
+        case 0:
+            for(; out < end; out += 4, row += pixel) { out[0] = out[1] = out[2] = row[0]; out[3] = 255; }
+            break;
+        case 2:
+            for(; out < end; out += 4, row += pixel) { out[0] = row[0]; out[1] = row[step]; out[2] = row[2 * step]; out[3] = 255; }
+            break;
+        case 3:
+            for(; out < end; out += 4, row += pixel) memcpy(out, &palette[4 * row[0]], 4);
+            break;
+        case 4:
+            for(; out < end; out += 4, row += pixel) { out[0] = out[1] = out[2] = row[0]; out[3] = row[step]; }
+            break;
+        case 6:
+            for(; out < end; out += 4, row += pixel) { out[0] = row[0]; out[1] = row[step]; out[2] = row[2 * step]; out[3] = row[3 * step]; }
+            break;
+    }
+}
+
+PngReader::Result PngReader::decode(const unsigned char *data, size_t length, const SizeHandler &size, const RowHandler &row)
+{
+    Result result = readChunks(data, length);
+    if(result != OK) return result;
+
+    //zlib header: deflate, no preset dictionary
+    if(stream.size() < 6 || (stream[0] & 15) != 8 || (stream[1] & 32) || ((stream[0] << 8) | stream[1]) % 31)
+        return fail("invalid zlib stream");
+
+    size_t bpp = channels * bitDepth / 8;
+    size_t rowBytes = bpp * width;
+    size_t stride = rowBytes + 1;
+    pixels.resize(stride * height + 1); //one byte of padding for unfilterPixels
+
+    size_t used = inflate(&stream[2], stream.size() - 2, &pixels[0], stride * height);
+    if(used == 0 || used + 6 > stream.size()) return fail("the image data is corrupt");
+    if(adler32(1, &pixels[0], stride * height) != read32(&stream[2 + used])) return fail("the image data has a wrong checksum");
+    std::vector<unsigned char>().swap(stream);
+
+    size(width, height);
+    std::vector<unsigned char> zeros(rowBytes, 0), rgba(4 * size_t(width));
+    for(int y = 0; y < height; ++y)
+    {
+        unsigned char *line = &pixels[y * stride];
+        const unsigned char *above = y > 0 ? line - stride + 1 : &zeros[0];
+        if(!unfilter(line + 1, above, rowBytes, bpp, line[0])) return fail("invalid filter type");
+
+        if(colorType == 6 && bitDepth == 8) row(y, line + 1);
+        else
+        {
+            toRGBA(line + 1, &rgba[0]);
+            row(y, &rgba[0]);
+        }
+    }
+    std::vector<unsigned char>().swap(pixels);
+    return OK;
+}
+
+PngReader::Result PngReader::decode(const char *filename, const SizeHandler &size, const RowHandler &row)
+{
+    FILE *file = fopen(filename, "rb");
+    if(!file) return fail("unable to open the file");
+
+    std::vector<unsigned char> data;
+    if(fseek(file, 0, SEEK_END) == 0)
+    {
+        long length = ftell(file);
+        if(length > 0)
+        {
+            data.resize(length);
+            rewind(file);
+            if(fread(&data[0], 1, length, file) != size_t(length)) data.clear();
+        }
+    }
+    fclose(file);
+    if(data.empty()) return fail("unable to read the file");
+
+    return decode(&data[0], data.size(), size, row);
+}
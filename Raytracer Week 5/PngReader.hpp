@@ -0,0 +1,57 @@
+#ifndef PNGREADER_HPP
+#define PNGREADER_HPP
+
+#include <functional>
+#include <string>
+#include <vector>
+
+/*
+    Class created for the course Computer graphics (2016 - 2017).
+    Fast decoder for the PNG files textures normally come in: 8 and 16 bit
+    grey, grey + alpha, RGB and RGBA and 8 bit palette images, without
+    interlacing. The zlib stream is inflated with lookup tables and the
+    scanlines are unfiltered in place with SSE2. Rows are handed out one at
+    a time as 8 bit RGBA, so the caller can store them in its own format
+    without a full RGBA copy of the image. Other files are left to LodePNG.
+*/
+
+class PngReader
+{
+public:
+    enum Result
+    {
+        OK,
+        UNSUPPORTED, //valid PNG this reader does not handle, use LodePNG
+        FAILED       //unreadable or corrupt file, error() tells why
+    };
+
+    typedef std::function<void(int width, int height)> SizeHandler;
+    typedef std::function<void(int y, const unsigned char *rgba)> RowHandler;
+
+    Result decode(const char *filename, const SizeHandler &size, const RowHandler &row);
+    Result decode(const unsigned char *data, size_t length, const SizeHandler &size, const RowHandler &row);
+
+    const std::string &error() const { return message; }
+
+    //checksums used by PNG, exposed for the benchmarks
+    static unsigned crc32(unsigned crc, const unsigned char *data, size_t length);
+    static unsigned adler32(unsigned adler, const unsigned char *data, size_t length);
+
+private:
+    int width;
+    int height;
+    int bitDepth;
+    int colorType;
+    size_t channels;
+    std::vector<unsigned char> palette; //256 RGBA entries
+    std::vector<unsigned char> stream;  //the IDAT data
+    std::vector<unsigned char> pixels;  //inflated scanlines with their filter bytes
+    std::string message;
+
+    Result fail(const std::string &why);
+    Result readChunks(const unsigned char *data, size_t length);
+    bool unfilter(unsigned char *row, const unsigned char *above, size_t rowBytes, size_t bpp, int type) const;
+    void toRGBA(const unsigned char *row, unsigned char *out) const;
+};
+
+#endif
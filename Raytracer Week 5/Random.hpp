@@ -0,0 +1,43 @@
+#ifndef RANDOM_HPP
+#define RANDOM_HPP
+
+#include <stdint.h>
+
+/*
+    Class created for the course Computer graphics (2016 - 2017).
+    splitmix64: a sequence of random numbers that is the same on every
+    platform, unlike rand(). Its mixing function is also what Sampler
+    hashes its keys with.
+*/
+
+class Random
+{
+public:
+    explicit Random(uint64_t seed) : state(seed) { }
+
+    double uniform() //in [0, 1)
+    {
+        uint64_t z = mix(state);
+        state += GAMMA;
+        return unit(z);
+    }
+
+    //z plus the increment through the splitmix64 finalizer, every bit of z changes half of the result
+    static uint64_t mix(uint64_t z)
+    {
+        z += GAMMA;
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+
+    //the top 53 bits as a double in [0, 1)
+    static double unit(uint64_t z) { return (z >> 11) * (1.0 / 9007199254740992.0); }
+
+private:
+    static const uint64_t GAMMA = 0x9e3779b97f4a7c15ULL;
+
+    uint64_t state;
+};
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef SAMPLER_HPP
+#define SAMPLER_HPP
+
+#include <stdint.h>
+#include "Random.hpp"
+
+/*
+    Class created for the course Computer graphics (2016 - 2017).
+    Random numbers for sampling that are a function of what they are for:
+    the pixel, the sample within the pixel, the bounce of the path and
+    which number of that bounce (the dimension). There is no generator
+    state, so the numbers, and the image, are the same whichever thread
+    renders a pixel and in whatever order the tiles are done.
+*/
+
+class Sampler
+{
+public:
+    //in [0, 1)
+    static double uniform(uint32_t x, uint32_t y, uint32_t sample, uint32_t bounce, uint32_t dimension)
+    {
+        uint64_t h = Random::mix(x | uint64_t(y) << 32);
+        h = Random::mix(h ^ (sample | uint64_t(bounce) << 32));
+        h = Random::mix(h ^ dimension);
+        return Random::unit(h);
+    }
+};
+
+#endif
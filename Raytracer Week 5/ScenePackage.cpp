@@ -0,0 +1,498 @@
+#include "ScenePackage.hpp"
+#include "raytracer.h"
+#include "sphere.h"
+#include "Disk.h"
+#include "Cylinder.h"
+#include "Mesh.hpp"
+#include "TextureCache.hpp"
+#include <fcntl.h>
+#include <map>
+#include <sstream>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+const uint32_t ScenePackage::VERSION;
+const uint32_t ScenePackage::NONE;
+
+static const char MAGIC[8] = {'R', 'T', 'S', 'C', 'E', 'N', 'E', '\n'};
+
+static uint64_t align16(uint64_t offset)
+{
+    return (offset + 15) & ~uint64_t(15);
+}
+
+ScenePackage::ScenePackage() : data(NULL), size(0) { }
+
+ScenePackage::~ScenePackage()
+{
+    if(data) munmap((void*)data, size);
+}
+
+bool ScenePackage::isPackage(const std::string &filename)
+{
+    char magic[sizeof(MAGIC)];
+    FILE *file = fopen(filename.c_str(), "rb");
+    if(!file) return false;
+    bool package = fread(magic, 1, sizeof(magic), file) == sizeof(magic) && memcmp(magic, MAGIC, sizeof(MAGIC)) == 0;
+    fclose(file);
+    return package;
+}
+
+//whether count elements of elementSize bytes at offset lie within the file
+static bool inside(uint64_t offset, uint64_t count, uint64_t elementSize, uint64_t size)
+{
+    return offset % 16 == 0 && offset <= size && count <= (size - offset) / elementSize;
+}
+
+bool ScenePackage::open(const std::string &filename)
+{
+    message.clear();
+    if(data) munmap((void*)data, size);
+    data = NULL;
+    size = 0;
+    name = filename;
+
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if(fd < 0)
+    {
+        message = "unable to open the file";
+        return false;
+    }
+    struct stat info;
+    if(fstat(fd, &info) != 0 || size_t(info.st_size) < sizeof(Header))
+    {
+        close(fd);
+        message = "not a scene package";
+        return false;
+    }
+    void *mapped = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(mapped == MAP_FAILED)
+    {
+        message = "unable to map the file";
+        return false;
+    }
+    data = (const char*)mapped;
+    size = info.st_size;
+
+    if(validate()) return true;
+    munmap((void*)data, size);
+    data = NULL;
+    size = 0;
+    return false;
+}
+
+//nothing is parsed, but nothing may point outside the file or its sections either
+bool ScenePackage::validate()
+{
+    const Header &h = header();
+    if(memcmp(h.magic, MAGIC, sizeof(MAGIC)) != 0) message = "not a scene package";
+    else if(h.version != VERSION) message = "compiled for another version, compile the scene again";
+    else if(!inside(h.lightOffset, h.numLights, sizeof(Light), size)
+        || !inside(h.materialOffset, h.numMaterials, sizeof(Material), size)
+        || !inside(h.textureOffset, h.numTextures, sizeof(Texture), size)
+        || !inside(h.objectOffset, h.numObjects, sizeof(Object), size)
+        || !inside(h.meshOffset, h.numMeshes, sizeof(Mesh), size)
+        || !inside(h.triangleOffset, h.numTriangles, sizeof(Triangle), size)
+        || !inside(h.clusterOffset, h.numClusters, sizeof(Cluster), size))
+        message = "the file is truncated";
+    else if(h.renderMode > Scene::COST || h.costMetric > Scene::TIME || h.sampling > Scene::JITTERED || h.format > Image::FLOAT16)
+        message = "the settings are invalid";
+    if(!message.empty()) return false;
+
+    const Material *materials = section<Material>(h.materialOffset);
+    for(size_t i = 0; i < h.numMaterials; ++i)
+        if(materials[i].texture != NONE && materials[i].texture >= h.numTextures)
+            return message = "a material has an invalid texture", false;
+
+    const Texture *textures = section<Texture>(h.textureOffset);
+    for(size_t i = 0; i < h.numTextures; ++i)
+        if(textures[i].width < 1 || textures[i].height < 1 || textures[i].width > (1 << 16) || textures[i].height > (1 << 16)
+            || textures[i].bytes != ::Texture::bytesFor(textures[i].width, textures[i].height)
+            || !inside(textures[i].offset, textures[i].bytes, 1, size))
+            return message = "a texture is invalid", false;
+
+    const Mesh *meshes = section<Mesh>(h.meshOffset);
+    for(size_t i = 0; i < h.numMeshes; ++i)
+        if(meshes[i].firstMaterial > h.numMaterials || meshes[i].numMaterials > h.numMaterials - meshes[i].firstMaterial
+            || meshes[i].firstTriangle > h.numTriangles || meshes[i].numTriangles > h.numTriangles - meshes[i].firstTriangle
+            || meshes[i].firstCluster > h.numClusters || meshes[i].numClusters > h.numClusters - meshes[i].firstCluster)
+            return message = "a mesh has invalid contents", false;
+
+    const Object *objects = section<Object>(h.objectOffset);
+    for(size_t i = 0; i < h.numObjects; ++i)
+        if(objects[i].type > MESH || objects[i].material >= h.numMaterials
+            || (objects[i].type == MESH && objects[i].mesh >= h.numMeshes))
+            return message = "an object is invalid", false;
+
+    const Triangle *triangles = section<Triangle>(h.triangleOffset);
+    const Cluster *clusters = section<Cluster>(h.clusterOffset);
+    for(size_t i = 0; i < h.numMeshes; ++i)
+    {
+        for(size_t j = meshes[i].firstTriangle; j < meshes[i].firstTriangle + meshes[i].numTriangles; ++j)
+            if(triangles[j].material != NONE && triangles[j].material >= meshes[i].numMaterials)
+                return message = "a triangle has an invalid material", false;
+        for(size_t j = meshes[i].firstCluster; j < meshes[i].firstCluster + meshes[i].numClusters; ++j)
+            if(clusters[j].first > meshes[i].numTriangles || clusters[j].count > meshes[i].numTriangles - clusters[j].first)
+                return message = "a cluster has invalid triangles", false;
+    }
+    return true;
+}
+
+static Triple triple(const double *v)
+{
+    return Triple(v[0], v[1], v[2]);
+}
+
+void ScenePackage::restore(Raytracer &raytracer) const
+{
+    const Header &h = header();
+    raytracer.width = h.width;
+    raytracer.height = h.height;
+    raytracer.format = Image::Format(h.format);
+    raytracer.outOfCore = h.outOfCore;
+    raytracer.pngLevel = PngWriter::Level(h.pngLevel);
+    raytracer.toneMapper.exposure = h.exposure;
+    raytracer.toneMapper.op = ToneMapper::Operator(h.toneOperator);
+    raytracer.toneMapper.transfer = ToneMapper::Transfer(h.toneTransfer);
+    raytracer.toneMapper.dither = h.dither;
+    raytracer.toneMapper.bits = h.bits;
+
+    Scene *scene = raytracer.scene = new Scene();
+    scene->renderMode = Scene::RenderMode(h.renderMode);
+    scene->costMetric = Scene::CostMetric(h.costMetric);
+    scene->sampling = Scene::Sampling(h.sampling);
+    if(h.camera) scene->setCamera(triple(h.eye), triple(h.center), triple(h.up));
+    else scene->setEye(triple(h.eye));
+    scene->setViewsize(h.width, h.height);
+    scene->setShadows(h.shadows);
+    scene->setReflectionDepth(h.reflectionDepth);
+    scene->setSupersampingFactor(h.supersampling);
+    if(h.depthOfField) scene->setDepthOfField(h.apertureRadius, h.apertureSamples);
+    scene->setGoochParameters(h.gooch[0], h.gooch[1], h.gooch[2], h.gooch[3]);
+    //a scene without a thread count uses the cores of the machine that renders it
+    if(h.threads != h.defaultThreads) scene->setThreads(h.threads);
+
+    const Light *lights = section<Light>(h.lightOffset);
+    for(size_t i = 0; i < h.numLights; ++i)
+        scene->addLight(new ::Light(triple(lights[i].position), triple(lights[i].color)));
+
+    //the textures use the texels in the file, every material holds a reference
+    std::vector< ::Texture*> textures(h.numTextures);
+    for(size_t i = 0; i < h.numTextures; ++i)
+    {
+        const Texture &texture = section<Texture>(h.textureOffset)[i];
+        textures[i] = new ::Texture();
+        textures[i]->map(section<unsigned char>(texture.offset), texture.width, texture.height);
+        std::ostringstream key;
+        key << name << ":" << i;
+        TextureCache::adopt(key.str(), textures[i]);
+    }
+
+    const Material *materials = section<Material>(h.materialOffset);
+    struct MaterialMaker
+    {
+        const Material *materials;
+        const std::vector< ::Texture*> &textures;
+
+        ::Material *operator()(size_t i) const
+        {
+            ::Material *m = new ::Material();
+            m->color = triple(materials[i].color);
+            m->ka = materials[i].ka;
+            m->kd = materials[i].kd;
+            m->ks = materials[i].ks;
+            m->n = materials[i].n;
+            if(materials[i].texture != NONE)
+            {
+                m->texture = textures[materials[i].texture];
+                TextureCache::retain(m->texture);
+            }
+            return m;
+        }
+    } material = {materials, textures};
+
+    const Object *objects = section<Object>(h.objectOffset);
+    for(size_t i = 0; i < h.numObjects; ++i)
+    {
+        const double *v = objects[i].values;
+        ::Object *object = NULL;
+        if(objects[i].type == SPHERE) object = new Sphere(triple(v), v[3], v[4], triple(v + 5));
+        else if(objects[i].type == DISK) object = new Disk(triple(v), triple(v + 3), v[6], false);
+        else if(objects[i].type == CYLINDER) object = new Cylinder(triple(v), triple(v + 3), v[6], v[7], false);
+        else
+        {
+            const Mesh &m = section<Mesh>(h.meshOffset)[objects[i].mesh];
+            ::Mesh *mesh = new ::Mesh(triple(m.center), m.radius, material(objects[i].material));
+            for(size_t j = 0; j < m.numMaterials; ++j)
+                mesh->materials.push_back(material(m.firstMaterial + j));
+
+            const Triangle *triangles = section<Triangle>(h.triangleOffset) + m.firstTriangle;
+            mesh->triangles.reserve(m.numTriangles);
+            for(size_t j = 0; j < m.numTriangles; ++j)
+            {
+                const Triangle &t = triangles[j];
+                ::Triangle triangle(triple(t.vertex[0]), triple(t.vertex[1]), triple(t.vertex[2]),
+                    Vector(t.normal[0][0], t.normal[0][1], t.normal[0][2]),
+                    Vector(t.normal[1][0], t.normal[1][1], t.normal[1][2]),
+                    Vector(t.normal[2][0], t.normal[2][1], t.normal[2][2]));
+                triangle.t0 = Vector(t.texcoord[0][0], t.texcoord[0][1], 0);
+                triangle.t1 = Vector(t.texcoord[1][0], t.texcoord[1][1], 0);
+                triangle.t2 = Vector(t.texcoord[2][0], t.texcoord[2][1], 0);
+                triangle.material = t.material == NONE ? mesh->material : mesh->materials[t.material];
+                mesh->triangles.push_back(triangle);
+            }
+
+            const Cluster *clusters = section<Cluster>(h.clusterOffset) + m.firstCluster;
+            mesh->clusters.reserve(m.numClusters);
+            for(size_t j = 0; j < m.numClusters; ++j)
+            {
+                ::Mesh::Cluster cluster = {triple(clusters[j].min), triple(clusters[j].max), clusters[j].first, clusters[j].count};
+                mesh->clusters.push_back(cluster);
+            }
+            scene->addObject(mesh);
+            continue;
+        }
+        object->material = material(objects[i].material);
+        scene->addObject(object);
+    }
+
+    //the materials hold the textures now
+    for(size_t i = 0; i < textures.size(); ++i)
+        TextureCache::release(textures[i]);
+}
+
+//collects the sections of a scene while it is written
+struct PackageBuilder
+{
+    std::vector<ScenePackage::Material> materials;
+    std::vector<ScenePackage::Texture> textures;
+    std::vector<const Texture*> textureData;
+    std::map<const Texture*, uint32_t> textureIndex;
+
+    uint32_t addMaterial(const Material *m)
+    {
+        ScenePackage::Material material;
+        memset(&material, 0, sizeof(material));
+        for(int a = 0; a < 3; ++a) material.color[a] = m->color.data[a];
+        material.ka = m->ka;
+        material.kd = m->kd;
+        material.ks = m->ks;
+        material.n = m->n;
+        material.texture = ScenePackage::NONE;
+        if(m->texture)
+        {
+            std::map<const Texture*, uint32_t>::iterator it = textureIndex.find(m->texture);
+            if(it == textureIndex.end())
+            {
+                ScenePackage::Texture texture = {uint32_t(m->texture->width()), uint32_t(m->texture->height()), 0, m->texture->bytes()};
+                it = textureIndex.insert(std::make_pair(m->texture, uint32_t(textures.size()))).first;
+                textures.push_back(texture);
+                textureData.push_back(m->texture);
+            }
+            material.texture = it->second;
+        }
+        materials.push_back(material);
+        return materials.size() - 1;
+    }
+};
+
+static void store(double *out, const Triple &t)
+{
+    for(int a = 0; a < 3; ++a) out[a] = t.data[a];
+}
+
+static bool writeSection(FILE *file, uint64_t &offset, const void *section, size_t bytes)
+{
+    static const char zeros[16] = {0};
+    size_t padding = align16(offset) - offset;
+    if(fwrite(zeros, 1, padding, file) != padding) return false;
+    if(bytes && fwrite(section, 1, bytes, file) != bytes) return false;
+    offset += padding + bytes;
+    return true;
+}
+
+bool ScenePackage::write(const std::string &filename, const Raytracer &raytracer, std::string &error)
+{
+    const Scene &scene = *raytracer.scene;
+    Header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.defaultThreads = ThreadPool::defaultThreads();
+    header.width = raytracer.width;
+    header.height = raytracer.height;
+    header.format = raytracer.format;
+    header.outOfCore = raytracer.outOfCore;
+    header.pngLevel = raytracer.pngLevel;
+    header.toneOperator = raytracer.toneMapper.op;
+    header.toneTransfer = raytracer.toneMapper.transfer;
+    header.dither = raytracer.toneMapper.dither;
+    header.bits = raytracer.toneMapper.bits;
+    header.exposure = raytracer.toneMapper.exposure;
+    header.renderMode = scene.renderMode;
+    header.costMetric = scene.costMetric;
+    header.sampling = scene.sampling;
+    header.camera = scene.camera;
+    header.shadows = scene.shadows;
+    header.depthOfField = scene.depthOfField;
+    header.supersampling = scene.supersampling;
+    header.reflectionDepth = scene.reflectionDepth;
+    header.apertureRadius = scene.apertureRadius;
+    header.apertureSamples = scene.apertureSamples;
+    header.threads = scene.threads;
+    store(header.eye, scene.eye);
+    store(header.center, scene.center);
+    store(header.up, scene.up);
+    header.gooch[0] = scene.bGooch;
+    header.gooch[1] = scene.yGooch;
+    header.gooch[2] = scene.alphaGooch;
+    header.gooch[3] = scene.betaGooch;
+
+    std::vector<Light> lights(scene.lights.size());
+    for(size_t i = 0; i < lights.size(); ++i)
+    {
+        store(lights[i].position, scene.lights[i]->position);
+        store(lights[i].color, scene.lights[i]->color);
+    }
+
+    PackageBuilder builder;
+    std::vector<Object> objects;
+    std::vector<Mesh> meshes;
+    std::vector<Triangle> triangles;
+    std::vector<Cluster> clusters;
+    for(size_t i = 0; i < scene.objects.size(); ++i)
+    {
+        Object object;
+        memset(&object, 0, sizeof(object));
+        object.mesh = NONE;
+        const ::Object *o = scene.objects[i];
+        if(const Sphere *sphere = dynamic_cast<const Sphere*>(o))
+        {
+            object.type = SPHERE;
+            store(object.values, sphere->position);
+            object.values[3] = sphere->r;
+            object.values[4] = sphere->ang;
+            store(object.values + 5, sphere->axis);
+        }
+        else if(const Disk *disk = dynamic_cast<const Disk*>(o))
+        {
+            object.type = DISK;
+            store(object.values, disk->position);
+            store(object.values + 3, disk->N);
+            object.values[6] = disk->radius;
+        }
+        else if(const Cylinder *cylinder = dynamic_cast<const Cylinder*>(o))
+        {
+            object.type = CYLINDER;
+            store(object.values, cylinder->start);
+            store(object.values + 3, cylinder->V);
+            object.values[6] = cylinder->radius;
+            object.values[7] = cylinder->length;
+        }
+        else if(const ::Mesh *mesh = dynamic_cast<const ::Mesh*>(o))
+        {
+            object.type = MESH;
+            object.mesh = meshes.size();
+
+            Mesh m;
+            memset(&m, 0, sizeof(m));
+            store(m.center, mesh->bounding_sphere->position);
+            m.radius = mesh->bounding_sphere->r;
+            std::map<const ::Material*, uint32_t> groups;
+            m.firstMaterial = builder.materials.size();
+            m.numMaterials = mesh->materials.size();
+            for(size_t j = 0; j < mesh->materials.size(); ++j)
+            {
+                builder.addMaterial(mesh->materials[j]);
+                groups[mesh->materials[j]] = j;
+            }
+
+            m.firstTriangle = triangles.size();
+            m.numTriangles = mesh->triangles.size();
+            for(size_t j = 0; j < mesh->triangles.size(); ++j)
+            {
+                const ::Triangle &t = mesh->triangles[j];
+                Triangle triangle;
+                memset(&triangle, 0, sizeof(triangle));
+                const Point *vertices[3] = {&t.v0, &t.v1, &t.v2};
+                const Vector *normals[3] = {&t.n0, &t.n1, &t.n2};
+                const Point *texcoords[3] = {&t.t0, &t.t1, &t.t2};
+                for(int k = 0; k < 3; ++k)
+                {
+                    store(triangle.vertex[k], *vertices[k]);
+                    for(int a = 0; a < 3; ++a) triangle.normal[k][a] = normals[k]->data[a];
+                    for(int a = 0; a < 2; ++a) triangle.texcoord[k][a] = texcoords[k]->data[a];
+                }
+                triangle.material = t.material == mesh->material ? NONE : groups[t.material];
+                triangles.push_back(triangle);
+            }
+
+            m.firstCluster = clusters.size();
+            m.numClusters = mesh->clusters.size();
+            for(size_t j = 0; j < mesh->clusters.size(); ++j)
+            {
+                Cluster cluster;
+                store(cluster.min, mesh->clusters[j].min);
+                store(cluster.max, mesh->clusters[j].max);
+                cluster.first = mesh->clusters[j].first;
+                cluster.count = mesh->clusters[j].count;
+                clusters.push_back(cluster);
+            }
+            meshes.push_back(m);
+        }
+        else
+        {
+            error = "the scene has an object that cannot be packaged";
+            return false;
+        }
+        object.material = builder.addMaterial(o->material);
+        objects.push_back(object);
+    }
+
+    header.numLights = lights.size();
+    header.numMaterials = builder.materials.size();
+    header.numTextures = builder.textures.size();
+    header.numObjects = objects.size();
+    header.numMeshes = meshes.size();
+    header.numTriangles = triangles.size();
+    header.numClusters = clusters.size();
+    header.lightOffset = align16(sizeof(Header));
+    header.materialOffset = align16(header.lightOffset + lights.size() * sizeof(Light));
+    header.textureOffset = align16(header.materialOffset + builder.materials.size() * sizeof(Material));
+    header.objectOffset = align16(header.textureOffset + builder.textures.size() * sizeof(Texture));
+    header.meshOffset = align16(header.objectOffset + objects.size() * sizeof(Object));
+    header.triangleOffset = align16(header.meshOffset + meshes.size() * sizeof(Mesh));
+    header.clusterOffset = align16(header.triangleOffset + triangles.size() * sizeof(Triangle));
+    uint64_t texels = header.clusterOffset + clusters.size() * sizeof(Cluster);
+    for(size_t i = 0; i < builder.textures.size(); ++i)
+    {
+        builder.textures[i].offset = align16(texels);
+        texels = builder.textures[i].offset + builder.textures[i].bytes;
+    }
+
+    FILE *file = fopen(filename.c_str(), "wb");
+    if(!file)
+    {
+        error = "unable to create the file";
+        return false;
+    }
+    uint64_t offset = 0;
+    bool written = writeSection(file, offset, &header, sizeof(header))
+        && writeSection(file, offset, lights.data(), lights.size() * sizeof(Light))
+        && writeSection(file, offset, builder.materials.data(), builder.materials.size() * sizeof(Material))
+        && writeSection(file, offset, builder.textures.data(), builder.textures.size() * sizeof(Texture))
+        && writeSection(file, offset, objects.data(), objects.size() * sizeof(Object))
+        && writeSection(file, offset, meshes.data(), meshes.size() * sizeof(Mesh))
+        && writeSection(file, offset, triangles.data(), triangles.size() * sizeof(Triangle))
+        && writeSection(file, offset, clusters.data(), clusters.size() * sizeof(Cluster));
+    for(size_t i = 0; i < builder.textureData.size() && written; ++i)
+        written = writeSection(file, offset, builder.textureData[i]->texels(), builder.textures[i].bytes);
+    written = fclose(file) == 0 && written;
+    if(!written) error = "unable to write the file";
+    return written;
+}
@@ -0,0 +1,154 @@
+#ifndef SCENEPACKAGE_HPP
+#define SCENEPACKAGE_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+class Raytracer;
+
+/*
+    Class created for the course Computer graphics (2016 - 2017).
+    Scene packages: a scene as the raytracer has it after reading the YAML
+    file, its meshes and its textures, written into one binary file that
+    is mapped into memory and turned into a scene without parsing, welding
+    or decoding anything. The file holds
+
+        Header                      render settings and camera
+        Light[numLights]
+        Material[numMaterials]      of the objects and of the mesh groups
+        Texture[numTextures]        sizes, the texels follow the clusters
+        Object[numObjects]
+        Mesh[numMeshes]             ranges of materials, triangles and clusters
+        Triangle[numTriangles]      as Mesh builds them, ready to intersect
+        Cluster[numClusters]        the mesh acceleration structure
+        texels of every texture     tiled and mipmapped, as Texture stores them
+
+    every section starting at a multiple of 16 bytes, in the byte order
+    of the machine that wrote it. Positions are doubles as the scene has
+    them, normals and texture coordinates floats as the models have them,
+    so a package renders exactly like its YAML file. The package has to
+    stay open as long as the scene, the textures use its texels in place.
+    Compile a scene with ray --compile scene.yaml.
+*/
+
+class ScenePackage
+{
+public:
+    static const uint32_t VERSION = 2;
+    static const uint32_t NONE = 0xffffffff;
+
+    enum ObjectType
+    {
+        SPHERE,     //values: position, radius, angle, axis
+        DISK,       //values: position, normal, radius
+        CYLINDER,   //values: start, direction, radius, length
+        MESH        //mesh: index of the Mesh
+    };
+
+    struct Header
+    {
+        char magic[8];  //"RTSCENE\n"
+        uint32_t version;
+        uint32_t defaultThreads;    //of the machine that wrote it
+        //output
+        uint32_t width, height;
+        uint32_t format;            //Image::Format
+        int32_t outOfCore;
+        int32_t pngLevel;
+        uint32_t toneOperator, toneTransfer, dither, bits;
+        float exposure;
+        //scene
+        uint32_t renderMode, camera, shadows, depthOfField;
+        uint32_t supersampling, reflectionDepth, apertureRadius, apertureSamples;
+        uint32_t threads, costMetric;
+        uint32_t sampling, reserved;
+        double eye[3], center[3], up[3];
+        double gooch[4];            //b, y, alpha, beta
+        //sections
+        uint64_t numLights, numMaterials, numTextures, numObjects, numMeshes, numTriangles, numClusters;
+        uint64_t lightOffset, materialOffset, textureOffset, objectOffset, meshOffset, triangleOffset, clusterOffset;
+    };
+
+    struct Light
+    {
+        double position[3];
+        double color[3];
+    };
+
+    struct Material
+    {
+        double color[3];
+        double ka, kd, ks, n;
+        uint32_t texture;   //or NONE
+        uint32_t reserved;
+    };
+
+    struct Texture
+    {
+        uint32_t width, height;
+        uint64_t offset;    //of the texels in the file
+        uint64_t bytes;
+    };
+
+    struct Object
+    {
+        uint32_t type;      //ObjectType
+        uint32_t material;
+        uint32_t mesh;      //or NONE
+        uint32_t reserved;
+        double values[8];
+    };
+
+    struct Mesh
+    {
+        uint64_t firstMaterial, numMaterials; //the materials of its groups
+        uint64_t firstTriangle, numTriangles;
+        uint64_t firstCluster, numClusters;
+        double center[3], radius; //bounding sphere
+    };
+
+    struct Triangle
+    {
+        double vertex[3][3];
+        float normal[3][3];
+        float texcoord[3][2];
+        uint32_t material;  //of the mesh groups, or NONE for the mesh material
+    };
+
+    struct Cluster
+    {
+        double min[3], max[3];
+        uint64_t first, count;
+    };
+
+    ScenePackage();
+    ~ScenePackage();
+
+    bool open(const std::string &filename); //false if failed, error() tells why
+    const std::string &error() const { return message; }
+
+    //gives raytracer the settings and a new scene with everything in the package
+    void restore(Raytracer &raytracer) const;
+
+    //whether the file starts like a scene package, without reading more of it
+    static bool isPackage(const std::string &filename);
+
+    //writes the scene raytracer has read
+    static bool write(const std::string &filename, const Raytracer &raytracer, std::string &error);
+
+private:
+    const char *data;
+    size_t size;
+    std::string name;
+    std::string message;
+
+    const Header &header() const { return *(const Header*)data; }
+    template <typename T> const T *section(uint64_t offset) const { return (const T*)(data + offset); }
+    bool validate();
+
+    ScenePackage(const ScenePackage&);
+    ScenePackage &operator=(const ScenePackage&);
+};
+
+#endif
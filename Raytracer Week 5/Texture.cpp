@@ -0,0 +1,212 @@
+#include "Texture.hpp"
+#include "lodepng.h"
+#include "PngReader.hpp"
+#include "Trace.hpp"
+#include <string.h>
+#include <cmath>
+#include <sstream>
+
+//spreads the three low bits of i over the even bits, used for Morton order.
+static const unsigned char SPREAD[8] = {0x00, 0x01, 0x04, 0x05, 0x10, 0x11, 0x14, 0x15};
+
+Texture::Texture() : memory(NULL), size(0)
+{}
+
+inline const unsigned char *Texture::address(const Level &level, int x, int y) const
+{
+    size_t tile = (y >> TILE_BITS) * level.tilesX + (x >> TILE_BITS);
+    size_t inTile = SPREAD[x & (TILE_SIZE - 1)] | (SPREAD[y & (TILE_SIZE - 1)] << 1);
+    return &memory[level.offset + 4 * (tile * TILE_SIZE * TILE_SIZE + inTile)];
+}
+
+bool Texture::read_png(const char *filename)
+{
+    std::string error;
+    if (read_png(filename, std::cout, error)) return true;
+    std::cerr << "Error: decoding " << filename << " failed (" << error << ")." << std::endl;
+    return false;
+}
+
+bool Texture::read_png(const char *filename, std::ostream &log, std::string &error)
+{
+    Trace::Scope trace("decodePNG", filename);
+    //common formats are decoded row by row straight into the tiles
+    PngReader reader;
+    PngReader::Result result = reader.decode(filename,
+        [this](int width, int height) { allocateLevels(width, height); },
+        [this](int y, const unsigned char *rgba) { store_row(y, rgba); });
+
+    if (result == PngReader::FAILED)
+    {
+        error = reader.error();
+        return false;
+    }
+
+    if (result == PngReader::UNSUPPORTED)
+    {
+        std::vector<unsigned char> buffer, image;
+        LodePNG::loadFile(buffer, filename);
+
+        //the decoder converts every color type to 8 bit RGBA
+        LodePNG::Decoder decoder;
+        decoder.decode(image, &buffer[0], (unsigned)buffer.size());
+        if (decoder.hasError())
+        {
+            std::ostringstream message;
+            message << "LodePNG error " << decoder.getError();
+            error = message.str();
+            return false;
+        }
+
+        build(&image[0], decoder.getWidth(), decoder.getHeight());
+    }
+    else
+    {
+        for(size_t i = 1; i < levels.size(); ++i)
+            downsample(i);
+    }
+
+    log << "succesfully read texture from " << filename << " (" << numLevels() << " mip levels)" << std::endl;
+    return true;
+}
+
+size_t Texture::layoutLevels(int width, int height)
+{
+    levels.clear();
+    size_t total = 0;
+    while(true)
+    {
+        Level level;
+        level.width = width;
+        level.height = height;
+        level.tilesX = (width + TILE_SIZE - 1) / TILE_SIZE;
+        level.offset = total;
+        levels.push_back(level);
+
+        int tilesY = (height + TILE_SIZE - 1) / TILE_SIZE;
+        total += 4 * TILE_SIZE * TILE_SIZE * level.tilesX * tilesY;
+
+        if(width == 1 && height == 1) break;
+        width = std::max(1, width / 2);
+        height = std::max(1, height / 2);
+    }
+    return total;
+}
+
+size_t Texture::bytesFor(int width, int height)
+{
+    Texture texture;
+    return texture.layoutLevels(width, height);
+}
+
+void Texture::allocateLevels(int width, int height)
+{
+    size = layoutLevels(width, height);
+    owned.assign(size, 0);
+    memory = owned.data();
+}
+
+void Texture::map(const unsigned char *texels, int width, int height)
+{
+    size = layoutLevels(width, height);
+    owned.clear();
+    memory = texels;
+}
+
+void Texture::build(const unsigned char *rgba, int width, int height)
+{
+    allocateLevels(width, height);
+
+    for(int y = 0; y < height; ++y)
+        store_row(y, rgba + 4 * size_t(y) * width);
+
+    for(size_t i = 1; i < levels.size(); ++i)
+        downsample(i);
+}
+
+void Texture::store_row(int y, const unsigned char *rgba)
+{
+    //a row of the full resolution level crosses one row of tiles, 8 texels per tile
+    const Level &base = levels[0];
+    for(int x = 0; x < base.width; ++x)
+        memcpy(const_cast<unsigned char*>(address(base, x, y)), rgba + 4 * x, 4);
+}
+
+void Texture::downsample(size_t i)
+{
+    const Level &src = levels[i - 1];
+    const Level &dst = levels[i];
+    for(int y = 0; y < dst.height; ++y)
+    {
+        int y0 = std::min(2 * y, src.height - 1);
+        int y1 = std::min(2 * y + 1, src.height - 1);
+        for(int x = 0; x < dst.width; ++x)
+        {
+            int x0 = std::min(2 * x, src.width - 1);
+            int x1 = std::min(2 * x + 1, src.width - 1);
+            const unsigned char *a = address(src, x0, y0);
+            const unsigned char *b = address(src, x1, y0);
+            const unsigned char *c = address(src, x0, y1);
+            const unsigned char *d = address(src, x1, y1);
+            unsigned char *out = const_cast<unsigned char*>(address(dst, x, y));
+            for(int ch = 0; ch < 4; ++ch)
+                out[ch] = (a[ch] + b[ch] + c[ch] + d[ch] + 2) / 4;
+        }
+    }
+}
+
+Color Texture::texel(int level, int x, int y) const
+{
+    const unsigned char *t = address(levels[level], x, y);
+    return Color(t[0], t[1], t[2]) / 255.0;
+}
+
+Color Texture::bilinear(int i, double u, double v) const
+{
+    const Level &level = levels[i];
+    double s = u * level.width - 0.5;
+    double t = v * level.height - 0.5;
+    double fs = floor(s);
+    double ft = floor(t);
+    double ws = s - fs;
+    double wt = t - ft;
+
+    //repeat horizontally, clamp vertically
+    int x0 = (int)fs % level.width;
+    if(x0 < 0) x0 += level.width;
+    int x1 = x0 + 1 == level.width ? 0 : x0 + 1;
+    int y0 = std::min(std::max((int)ft, 0), level.height - 1);
+    int y1 = std::min(std::max((int)ft + 1, 0), level.height - 1);
+
+    const unsigned char *a = address(level, x0, y0);
+    const unsigned char *b = address(level, x1, y0);
+    const unsigned char *c = address(level, x0, y1);
+    const unsigned char *d = address(level, x1, y1);
+
+    double wa = (1 - ws) * (1 - wt);
+    double wb = ws * (1 - wt);
+    double wc = (1 - ws) * wt;
+    double wd = ws * wt;
+    return Color(wa * a[0] + wb * b[0] + wc * c[0] + wd * d[0],
+                 wa * a[1] + wb * b[1] + wc * c[1] + wd * d[1],
+                 wa * a[2] + wb * b[2] + wc * c[2] + wd * d[2]) / 255.0;
+}
+
+Color Texture::sample(double u, double v, double du, double dv) const
+{
+    if(levels.empty()) return Color();
+
+    u -= floor(u); //repeat, keeps the modulo in bilinear positive and small
+
+    //level of detail: log2 of the footprint measured in base level texels
+    double texels = std::max(du * levels[0].width, dv * levels[0].height);
+    if(texels <= 1.0) return bilinear(0, u, v);
+
+    double lod = std::log2(texels);
+    int last = levels.size() - 1;
+    if(lod >= last) return bilinear(last, u, v);
+
+    int lo = (int)lod;
+    double w = lod - lo;
+    return (1 - w) * bilinear(lo, u, v) + w * bilinear(lo + 1, u, v);
+}
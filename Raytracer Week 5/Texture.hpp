@@ -0,0 +1,69 @@
+#ifndef TEXTURE_HPP
+#define TEXTURE_HPP
+
+#include <ostream>
+#include <string>
+#include <vector>
+#include "triple.h"
+#include "Memory.hpp"
+
+/*
+    Class created for the course Computer graphics (2016 - 2017).
+    A mipmapped texture. Texels are stored as 8 bit RGBA in 8x8 tiles,
+    with the texels of a tile in Morton (z-curve) order so a bilinear
+    lookup touches a single cache line most of the time.
+    Texture coordinates repeat horizontally and clamp vertically.
+    The texels are either owned or, for a scene package, mapped.
+*/
+
+class Texture
+{
+public:
+    Texture();
+
+    bool read_png(const char *filename); //false if the file could not be decoded
+    //as read_png, with the messages going to log and why it failed to error
+    bool read_png(const char *filename, std::ostream &log, std::string &error);
+    void build(const unsigned char *rgba, int width, int height); //from row-major RGBA8
+    //uses texels laid out as texels() of a texture of this size, without copying them.
+    //they have to stay valid as long as the texture.
+    void map(const unsigned char *texels, int width, int height);
+
+    //filtered lookup, du and dv are the ray footprint in texture space.
+    //a zero footprint gives a bilinear lookup in the full resolution level.
+    Color sample(double u, double v, double du = 0, double dv = 0) const;
+    Color texel(int level, int x, int y) const;
+
+    inline int width() const    { return levels.empty() ? 0 : levels[0].width; }
+    inline int height() const   { return levels.empty() ? 0 : levels[0].height; }
+    inline int numLevels() const { return levels.size(); }
+    inline size_t bytes() const { return size; }
+    inline const unsigned char *texels() const { return memory; }
+
+    static size_t bytesFor(int width, int height); //of all levels
+
+protected:
+    enum { TILE_BITS = 3, TILE_SIZE = 1 << TILE_BITS };
+
+    struct Level
+    {
+        int width;
+        int height;
+        int tilesX;
+        size_t offset; //first byte of the level in texels
+    };
+
+    std::vector<Level> levels;
+    std::vector<unsigned char, Memory::Allocator<unsigned char, Memory::TEXTURES> > owned;
+    const unsigned char *memory; //owned or mapped texels
+    size_t size;
+
+    inline const unsigned char *address(const Level &level, int x, int y) const;
+    Color bilinear(int level, double u, double v) const;
+    size_t layoutLevels(int width, int height); //returns the bytes of all levels
+    void allocateLevels(int width, int height);
+    void store_row(int y, const unsigned char *rgba); //into the full resolution level
+    void downsample(size_t level); //fills level from level - 1 with a box filter
+};
+
+#endif
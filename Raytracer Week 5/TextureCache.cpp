@@ -0,0 +1,128 @@
+#include "TextureCache.hpp"
+
+std::map<Texture*, TextureCache::Entry> &TextureCache::entries()
+{
+    static std::map<Texture*, Entry> entries;
+    return entries;
+}
+
+std::map<std::string, Texture*> &TextureCache::files()
+{
+    static std::map<std::string, Texture*> files;
+    return files;
+}
+
+std::set<std::string> &TextureCache::decoding()
+{
+    static std::set<std::string> decoding;
+    return decoding;
+}
+
+std::mutex &TextureCache::mutex()
+{
+    static std::mutex mutex;
+    return mutex;
+}
+
+std::condition_variable &TextureCache::decoded()
+{
+    static std::condition_variable decoded;
+    return decoded;
+}
+
+Texture *TextureCache::acquire(const std::string &filename)
+{
+    std::string warning;
+    Texture *texture = acquire(filename, std::cout, warning);
+    if(!texture) std::cerr << "Warning: " << warning << "." << std::endl;
+    return texture;
+}
+
+Texture *TextureCache::acquire(const std::string &filename, std::ostream &log, std::string &warning)
+{
+    std::unique_lock<std::mutex> lock(mutex());
+    while(true)
+    {
+        std::map<std::string, Texture*>::iterator it = files().find(filename);
+        if(it != files().end())
+        {
+            ++entries()[it->second].references;
+            return it->second;
+        }
+        if(decoding().count(filename) == 0) break;
+        decoded().wait(lock);
+    }
+
+    //decoded without the lock, other files can be decoded meanwhile
+    decoding().insert(filename);
+    lock.unlock();
+    Texture *texture = new Texture();
+    std::string error;
+    bool read = texture->read_png(filename.c_str(), log, error);
+    lock.lock();
+    decoding().erase(filename);
+    decoded().notify_all();
+
+    if(!read)
+    {
+        warning = "unable to load texture " + filename + " (" + error + "), using material color";
+        delete texture;
+        return NULL;
+    }
+
+    Entry entry = {filename, 1};
+    entries()[texture] = entry;
+    files()[filename] = texture;
+    return texture;
+}
+
+Texture *TextureCache::adopt(const std::string &name, Texture *texture)
+{
+    std::unique_lock<std::mutex> lock(mutex());
+    Entry entry = {name, 1};
+    entries()[texture] = entry;
+    files()[name] = texture;
+    return texture;
+}
+
+void TextureCache::retain(Texture *texture)
+{
+    std::unique_lock<std::mutex> lock(mutex());
+    std::map<Texture*, Entry>::iterator it = entries().find(texture);
+    if(it != entries().end()) ++it->second.references;
+}
+
+void TextureCache::release(Texture *texture)
+{
+    std::unique_lock<std::mutex> lock(mutex());
+    std::map<Texture*, Entry>::iterator it = entries().find(texture);
+    if(it == entries().end()) return;
+
+    if(--it->second.references == 0)
+    {
+        files().erase(it->second.filename);
+        entries().erase(it);
+        delete texture;
+    }
+}
+
+size_t TextureCache::numLoaded()
+{
+    std::unique_lock<std::mutex> lock(mutex());
+    return entries().size();
+}
+
+size_t TextureCache::residentBytes()
+{
+    std::unique_lock<std::mutex> lock(mutex());
+    size_t bytes = 0;
+    for(std::map<Texture*, Entry>::iterator it = entries().begin(); it != entries().end(); ++it)
+        bytes += it->first->bytes();
+    return bytes;
+}
+
+void TextureCache::printStatistics()
+{
+    std::cout << "Textures: " << numLoaded() << " loaded, "
+              << residentBytes() << " bytes resident.\n";
+}
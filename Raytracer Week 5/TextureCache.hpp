@@ -0,0 +1,51 @@
+#ifndef TEXTURECACHE_HPP
+#define TEXTURECACHE_HPP
+
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include "Texture.hpp"
+
+/*
+    Class created for the course Computer graphics (2016 - 2017).
+    Reference counted registry of the textures used by a scene.
+    Every file is decoded once and shared between all materials
+    (and mesh groups) referring to it. It can be used from several
+    threads, a file being decoded is waited for rather than decoded
+    twice.
+*/
+
+class TextureCache
+{
+public:
+    //returns the texture stored in filename, decoding it on first use.
+    //returns NULL if the file could not be read.
+    static Texture *acquire(const std::string &filename);
+    //as acquire, with the messages going to log and the warning to warning
+    static Texture *acquire(const std::string &filename, std::ostream &log, std::string &warning);
+    //registers a texture built elsewhere under name, with one reference
+    static Texture *adopt(const std::string &name, Texture *texture);
+    static void retain(Texture *texture); //adds a reference to an acquired texture
+    static void release(Texture *texture); //drops a reference, frees at zero.
+
+    static size_t numLoaded();
+    static size_t residentBytes();
+    static void printStatistics(); //outputs cache statistics.
+
+private:
+    struct Entry
+    {
+        std::string filename;
+        size_t references;
+    };
+
+    static std::map<Texture*, Entry> &entries();
+    static std::map<std::string, Texture*> &files();
+    static std::set<std::string> &decoding(); //files being decoded now
+    static std::mutex &mutex();
+    static std::condition_variable &decoded();
+};
+
+#endif
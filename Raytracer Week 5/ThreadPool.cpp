@@ -0,0 +1,70 @@
+#include "ThreadPool.hpp"
+
+ThreadPool::ThreadPool(size_t threads)
+    : running(0), stopping(false)
+{
+    for(size_t i = 0; i < threads; ++i)
+        workers.push_back(std::thread(&ThreadPool::work, this));
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    available.notify_all();
+    for(size_t i = 0; i < workers.size(); ++i)
+        workers[i].join();
+}
+
+size_t ThreadPool::defaultThreads()
+{
+    size_t n = std::thread::hardware_concurrency();
+    return n == 0 ? 1 : n;
+}
+
+void ThreadPool::add(const std::function<void()> &task)
+{
+    if(workers.empty())
+    {
+        task();
+        return;
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        tasks.push_back(task);
+    }
+    available.notify_one();
+}
+
+void ThreadPool::wait()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while(!tasks.empty() || running > 0)
+        finished.wait(lock);
+}
+
+void ThreadPool::work()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while(true)
+    {
+        while(tasks.empty() && !stopping)
+            available.wait(lock);
+        if(tasks.empty()) return; //stopping and nothing left
+
+        std::function<void()> task = tasks.front();
+        tasks.pop_front();
+        ++running;
+
+        lock.unlock();
+        task();
+        lock.lock();
+
+        --running;
+        if(tasks.empty() && running == 0)
+            finished.notify_all();
+    }
+}
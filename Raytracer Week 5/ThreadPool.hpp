@@ -0,0 +1,41 @@
+#ifndef THREADPOOL_HPP
+#define THREADPOOL_HPP
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+    Class created for the course Computer graphics (2016 - 2017).
+    A fixed set of worker threads executing queued tasks.
+    With zero threads tasks run on the calling thread when they are added.
+*/
+
+class ThreadPool
+{
+public:
+    explicit ThreadPool(size_t threads = defaultThreads());
+    ~ThreadPool();
+
+    void add(const std::function<void()> &task);
+    void wait(); //blocks until every added task has finished
+
+    size_t size() const { return workers.size(); }
+    static size_t defaultThreads(); //number of hardware threads
+
+private:
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()> > tasks;
+    std::mutex mutex;
+    std::condition_variable available;
+    std::condition_variable finished;
+    size_t running;
+    bool stopping;
+
+    void work();
+};
+
+#endif
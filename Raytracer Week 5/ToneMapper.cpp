@@ -0,0 +1,186 @@
+#include "ToneMapper.hpp"
+#include <emmintrin.h>
+#include <math.h>
+#include <string.h>
+
+//the sRGB curve is interpolated from a table this fine, close enough for 16 bit output
+static const int SRGB_STEPS = 1 << 14;
+
+static double srgb(double x)
+{
+    return x <= 0.0031308 ? 12.92 * x : 1.055 * pow(x, 1.0 / 2.4) - 0.055;
+}
+
+//pairs of a value and the step to the next one, so one 8 byte load gets both
+struct SrgbTable
+{
+    float value[2 * (SRGB_STEPS + 1)]; //the last step is only used with a zero weight
+
+    SrgbTable()
+    {
+        for(int i = 0; i <= SRGB_STEPS; ++i)
+        {
+            value[2 * i] = srgb(double(i) / SRGB_STEPS);
+            value[2 * i + 1] = i < SRGB_STEPS ? srgb(double(i + 1) / SRGB_STEPS) - value[2 * i] : 0.0f;
+        }
+    }
+};
+
+static const float *srgbTable()
+{
+    static const SrgbTable table;
+    return table.value;
+}
+
+//8x8 Bayer matrix for ordered dithering
+static const unsigned char BAYER[8][8] =
+{
+    { 0, 32,  8, 40,  2, 34, 10, 42},
+    {48, 16, 56, 24, 50, 18, 58, 26},
+    {12, 44,  4, 36, 14, 46,  6, 38},
+    {60, 28, 52, 20, 62, 30, 54, 22},
+    { 3, 35, 11, 43,  1, 33,  9, 41},
+    {51, 19, 59, 27, 49, 17, 57, 25},
+    {15, 47,  7, 39, 13, 45,  5, 37},
+    {63, 31, 55, 23, 61, 29, 53, 21}
+};
+
+void ToneMapper::map_row(const float *rgb, int width, int y, unsigned char *out) const
+{
+    size_t count = 3 * size_t(width);
+    size_t full = count & ~size_t(3);
+    map(rgb, full, 0, y, out);
+
+    if(full < count)
+    {
+        //the last one to three channels go through a padded copy
+        float in[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+        unsigned char tail[8];
+        memcpy(in, rgb + full, (count - full) * sizeof(float));
+        map(in, 4, full, y, tail);
+        memcpy(out + full * bytesPerChannel(), tail, (count - full) * bytesPerChannel());
+    }
+}
+
+//one loop for every combination of settings, so the loop itself has no branches
+template <ToneMapper::Operator OP, ToneMapper::Transfer TRANSFER, bool WIDE>
+static void mapValues(const ToneMapper &mapper, const float *in, size_t count, size_t start, int y, unsigned char *out)
+{
+    //the dither pattern repeats every 8 pixels, 24 channels, of the row.
+    //without dithering the values are truncated, as they always were.
+    float threshold[24];
+    for(int i = 0; i < 24; ++i)
+        threshold[i] = mapper.dither ? (BAYER[y & 7][i / 3] + 0.5f) / 64.0f : 0.0f;
+    size_t phase = start % 24;
+
+    const float *table = srgbTable();
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 scale = _mm_set1_ps(exp2f(mapper.exposure));
+    const __m128 steps = _mm_set1_ps(SRGB_STEPS);
+    const __m128 maximum = _mm_set1_ps(mapper.maxValue());
+
+    for(size_t i = 0; i < count; i += 4)
+    {
+        __m128 v = _mm_mul_ps(_mm_loadu_ps(in + i), scale);
+        v = _mm_max_ps(v, zero); //negative values and NaN become 0
+
+        if(OP == ToneMapper::REINHARD) v = _mm_div_ps(v, _mm_add_ps(v, one));
+        else if(OP == ToneMapper::ACES)
+        {
+            __m128 a = _mm_mul_ps(v, _mm_add_ps(_mm_mul_ps(v, _mm_set1_ps(2.51f)), _mm_set1_ps(0.03f)));
+            __m128 b = _mm_add_ps(_mm_mul_ps(v, _mm_add_ps(_mm_mul_ps(v, _mm_set1_ps(2.43f)), _mm_set1_ps(0.59f))), _mm_set1_ps(0.14f));
+            v = _mm_div_ps(a, b);
+        }
+        v = _mm_min_ps(v, one);
+
+        if(TRANSFER == ToneMapper::SRGB)
+        {
+            __m128 f = _mm_mul_ps(v, steps);
+            __m128i index = _mm_cvttps_epi32(f);
+            __m128 weight = _mm_sub_ps(f, _mm_cvtepi32_ps(index));
+            int at[4];
+            _mm_storeu_si128((__m128i*)at, index);
+            __m128 a = _mm_loadh_pi(_mm_loadl_pi(zero, (const __m64*)(table + 2 * at[0])), (const __m64*)(table + 2 * at[1]));
+            __m128 b = _mm_loadh_pi(_mm_loadl_pi(zero, (const __m64*)(table + 2 * at[2])), (const __m64*)(table + 2 * at[3]));
+            __m128 base = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+            __m128 step = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+            v = _mm_add_ps(base, _mm_mul_ps(step, weight));
+        }
+
+        //v * maximum + threshold stays below maximum + 1, truncation is enough
+        __m128i q = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(v, maximum), _mm_loadu_ps(threshold + phase)));
+        phase = phase == 20 ? 0 : phase + 4;
+
+        if(WIDE)
+        {
+            //the pack saturates to signed values, so shift the range down and back
+            __m128i h = _mm_packs_epi32(_mm_sub_epi32(q, _mm_set1_epi32(32768)), _mm_setzero_si128());
+            h = _mm_xor_si128(h, _mm_set1_epi16((short)0x8000));
+            h = _mm_or_si128(_mm_slli_epi16(h, 8), _mm_srli_epi16(h, 8)); //big endian
+            _mm_storel_epi64((__m128i*)(out + 2 * i), h);
+        }
+        else
+        {
+            __m128i b = _mm_packus_epi16(_mm_packs_epi32(q, _mm_setzero_si128()), _mm_setzero_si128());
+            int word = _mm_cvtsi128_si32(b);
+            memcpy(out + i, &word, 4);
+        }
+    }
+}
+
+template <ToneMapper::Operator OP, ToneMapper::Transfer TRANSFER>
+static void mapValues(const ToneMapper &mapper, const float *in, size_t count, size_t start, int y, unsigned char *out)
+{
+    if(mapper.bits > 8) mapValues<OP, TRANSFER, true>(mapper, in, count, start, y, out);
+    else mapValues<OP, TRANSFER, false>(mapper, in, count, start, y, out);
+}
+
+template <ToneMapper::Operator OP>
+static void mapValues(const ToneMapper &mapper, const float *in, size_t count, size_t start, int y, unsigned char *out)
+{
+    if(mapper.transfer == ToneMapper::SRGB) mapValues<OP, ToneMapper::SRGB>(mapper, in, count, start, y, out);
+    else mapValues<OP, ToneMapper::LINEAR>(mapper, in, count, start, y, out);
+}
+
+void ToneMapper::map(const float *in, size_t count, size_t start, int y, unsigned char *out) const
+{
+    switch(op)
+    {
+        case REINHARD: mapValues<REINHARD>(*this, in, count, start, y, out); break;
+        case ACES: mapValues<ACES>(*this, in, count, start, y, out); break;
+        default: mapValues<CLAMP>(*this, in, count, start, y, out); break;
+    }
+}
+
+bool ToneMapper::parseOperator(const std::string &name, Operator &op)
+{
+    if(name == "clamp") op = CLAMP;
+    else if(name == "reinhard") op = REINHARD;
+    else if(name == "aces") op = ACES;
+    else return false;
+    return true;
+}
+
+bool ToneMapper::parseTransfer(const std::string &name, Transfer &transfer)
+{
+    if(name == "linear") transfer = LINEAR;
+    else if(name == "srgb") transfer = SRGB;
+    else return false;
+    return true;
+}
+
+const char *ToneMapper::operatorName(Operator op)
+{
+    switch(op)
+    {
+        case REINHARD: return "reinhard";
+        case ACES: return "aces";
+        default: return "clamp";
+    }
+}
+
+const char *ToneMapper::transferName(Transfer transfer)
+{
+    return transfer == SRGB ? "srgb" : "linear";
+}
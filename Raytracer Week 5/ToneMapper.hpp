@@ -0,0 +1,56 @@
+#ifndef TONEMAPPER_HPP
+#define TONEMAPPER_HPP
+
+#include <string>
+
+/*
+    Class created for the course Computer graphics (2016 - 2017).
+    Turns rows of rendered linear RGB into 8 or 16 bit output values:
+    exposure, a tone curve, sRGB encoding, ordered dithering and
+    quantization, four channels at a time with SSE2. The defaults (no
+    exposure, clamping, linear values, no dithering, 8 bits) give the
+    same images as before the stage existed.
+*/
+
+class ToneMapper
+{
+public:
+    enum Operator
+    {
+        CLAMP,    //values above 1 are clipped
+        REINHARD, //x / (1 + x)
+        ACES      //fit of the ACES filmic curve
+    };
+
+    enum Transfer
+    {
+        LINEAR,   //values are written as they are
+        SRGB      //sRGB encoded, for a display
+    };
+
+    float exposure;    //in stops, the values are scaled by 2^exposure
+    Operator op;
+    Transfer transfer;
+    bool dither;       //8x8 ordered dithering instead of truncation
+    int bits;          //8 or 16 bits per channel
+
+    ToneMapper() : exposure(0.0f), op(CLAMP), transfer(LINEAR), dither(false), bits(8) { }
+
+    int bytesPerChannel() const { return bits > 8 ? 2 : 1; }
+    int maxValue() const { return bits > 8 ? 65535 : 255; }
+
+    //one row of width RGB pixels to 3 * width values of bytesPerChannel bytes each,
+    //16 bit values big endian as PNG and PPM store them. y selects the dither row.
+    void map_row(const float *rgb, int width, int y, unsigned char *out) const;
+
+    static bool parseOperator(const std::string &name, Operator &op);
+    static bool parseTransfer(const std::string &name, Transfer &transfer);
+    static const char *operatorName(Operator op);
+    static const char *transferName(Transfer transfer);
+
+private:
+    //count is a multiple of 4, start the position of in[0] in its row
+    void map(const float *in, size_t count, size_t start, int y, unsigned char *out) const;
+};
+
+#endif
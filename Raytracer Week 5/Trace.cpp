@@ -0,0 +1,157 @@
+#include "Trace.hpp"
+#include <iostream>
+#include <stdio.h>
+
+struct Trace::Event
+{
+    const char *name;
+    std::string detail;
+    int x, y;
+    long long begin, duration;
+};
+
+//every thread appends to its own buffer, only creating one takes the lock
+struct Trace::Buffer
+{
+    size_t thread;
+    std::vector<Event> events;
+};
+
+std::atomic<bool> Trace::on(false);
+thread_local Trace::Buffer *Trace::current = NULL;
+
+std::vector<Trace::Buffer*> &Trace::buffers()
+{
+    static std::vector<Buffer*> buffers;
+    return buffers;
+}
+
+std::mutex &Trace::mutex()
+{
+    static std::mutex mutex;
+    return mutex;
+}
+
+std::string &Trace::filename()
+{
+    static std::string filename;
+    return filename;
+}
+
+std::chrono::steady_clock::time_point &Trace::started()
+{
+    static std::chrono::steady_clock::time_point started;
+    return started;
+}
+
+void Trace::start(const std::string &name)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex());
+        filename() = name;
+        started() = std::chrono::steady_clock::now();
+    }
+    buffer(); //the thread that starts the trace is thread 0
+    on.store(true);
+}
+
+long long Trace::now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - started()).count();
+}
+
+Trace::Buffer &Trace::buffer()
+{
+    if(!current)
+    {
+        current = new Buffer();
+        std::lock_guard<std::mutex> lock(mutex());
+        current->thread = buffers().size();
+        buffers().push_back(current);
+    }
+    return *current;
+}
+
+void Trace::record(const Scope &scope, long long end)
+{
+    Event event = {scope.name, scope.detail, scope.x, scope.y, scope.begin, end - scope.begin};
+    buffer().events.push_back(event);
+}
+
+static void writeString(FILE *file, const char *s)
+{
+    fputc('"', file);
+    for(; *s; ++s)
+    {
+        if(*s == '"' || *s == '\\') fprintf(file, "\\%c", *s);
+        else if((unsigned char)*s < 0x20) fprintf(file, "\\u%04x", *s);
+        else fputc(*s, file);
+    }
+    fputc('"', file);
+}
+
+bool Trace::finish()
+{
+    if(!enabled()) return true;
+    on.store(false);
+
+    std::lock_guard<std::mutex> lock(mutex());
+    FILE *file = fopen(filename().c_str(), "w");
+    if(!file)
+    {
+        std::cerr << "Error: unable to open " << filename() << " for writing." << std::endl;
+        return false;
+    }
+
+    //complete events (ph X) in microseconds, and a name for every thread
+    size_t count = 0;
+    fprintf(file, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+    for(size_t b = 0; b < buffers().size(); ++b)
+    {
+        const Buffer &buffer = *buffers()[b];
+        fprintf(file, "{\"ph\": \"M\", \"name\": \"thread_name\", \"pid\": 1, \"tid\": %zu, \"args\": {\"name\": \"%s %zu\"}},\n",
+                buffer.thread, buffer.thread == 0 ? "main" : "thread", buffer.thread);
+        for(size_t i = 0; i < buffer.events.size(); ++i)
+        {
+            const Event &event = buffer.events[i];
+            fprintf(file, "{\"ph\": \"X\", \"pid\": 1, \"tid\": %zu, \"ts\": %.3f, \"dur\": %.3f, \"name\": ",
+                    buffer.thread, event.begin / 1000.0, event.duration / 1000.0);
+            writeString(file, event.name);
+            if(!event.detail.empty())
+            {
+                fprintf(file, ", \"args\": {\"detail\": ");
+                writeString(file, event.detail.c_str());
+                fprintf(file, "}");
+            }
+            else if(event.x >= 0) fprintf(file, ", \"args\": {\"x\": %d, \"y\": %d}", event.x, event.y);
+            fprintf(file, "},\n");
+            ++count;
+        }
+    }
+    //the last event has no comma after it
+    fprintf(file, "{\"ph\": \"M\", \"name\": \"process_name\", \"pid\": 1, \"args\": {\"name\": \"ray\"}}\n]}\n");
+    bool written = fclose(file) == 0;
+    if(!written) std::cerr << "Error: writing " << filename() << " failed." << std::endl;
+    else std::cout << "Trace of " << count << " events written to " << filename() << "." << std::endl;
+
+    for(size_t b = 0; b < buffers().size(); ++b)
+        buffers()[b]->events.clear();
+    return written;
+}
+
+Trace::Scope::Scope(const char *name) : name(name), x(-1), y(-1), begin(enabled() ? now() : -1) { }
+
+Trace::Scope::Scope(const char *name, const std::string &detail)
+    : name(name), x(-1), y(-1), begin(-1)
+{
+    if(!enabled()) return;
+    this->detail = detail;
+    begin = now();
+}
+
+Trace::Scope::Scope(const char *name, int x, int y) : name(name), x(x), y(y), begin(enabled() ? now() : -1) { }
+
+Trace::Scope::~Scope()
+{
+    if(begin >= 0 && enabled()) record(*this, now());
+}
@@ -0,0 +1,69 @@
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/*
+    Class created for the course Computer graphics (2016 - 2017).
+    A timeline of the phases of a run (reading the scene, loading assets,
+    rendering tiles, encoding the output) in the Chrome trace event format,
+    which chrome://tracing and Perfetto open. A Scope placed in a function
+    records its start and duration on the calling thread. When tracing is
+    off, which it is unless start is called, a Scope costs one flag test.
+
+        Trace::Scope scope("render");
+*/
+
+class Trace
+{
+public:
+    //records from now on, finish writes them to filename
+    static void start(const std::string &filename);
+    //writes the recorded events and stops. false if writing failed.
+    static bool finish();
+
+    static bool enabled() { return on.load(std::memory_order_relaxed); }
+
+    class Scope
+    {
+    public:
+        explicit Scope(const char *name); //name: a string that outlives the trace
+        Scope(const char *name, const std::string &detail); //detail: a file name, for example
+        Scope(const char *name, int x, int y); //a position, of a tile for example
+        ~Scope();
+
+    private:
+        friend class Trace;
+
+        const char *name;
+        std::string detail;
+        int x, y;
+        long long begin; //ns, or -1 if not tracing
+
+        Scope(const Scope&);
+        Scope &operator=(const Scope&);
+    };
+
+private:
+    struct Event;
+    struct Buffer;
+
+    static std::atomic<bool> on;
+    static thread_local Buffer *current; //of the calling thread, once it records
+
+    static long long now(); //ns since the trace started
+    static Buffer &buffer(); //of the calling thread
+    static void record(const Scope &scope, long long end);
+
+    //the buffers outlive their threads, render threads are gone before the trace is written
+    static std::vector<Buffer*> &buffers();
+    static std::mutex &mutex();
+    static std::string &filename();
+    static std::chrono::steady_clock::time_point &started();
+};
+
+#endif
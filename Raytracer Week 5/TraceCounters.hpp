@@ -0,0 +1,20 @@
+#ifndef TRACECOUNTERS_HPP
+#define TRACECOUNTERS_HPP
+
+/*
+    Class created for the course Computer graphics (2016 - 2017).
+    The work done while tracing, counted per thread so the render threads
+    do not share anything. The cost render mode reads the counters before
+    and after every pixel.
+*/
+
+struct TraceCounters
+{
+    unsigned long long tests;   //intersect calls of scene objects and mesh triangles
+    unsigned long long steps;   //mesh cluster boxes tested
+    unsigned long long rays;    //rays traced: camera, shadow and reflection rays
+
+    static thread_local TraceCounters current; //of the calling thread
+};
+
+#endif
@@ -37,7 +37,7 @@ Hit Triangle::intersect(const Ray &ray)
     return Hit(t, norm.normalized(), this);
 }
 
-Color Triangle::colorAt(const Point &point)
+Color Triangle::colorAt(const Point &point, double footprint)
 {
     if(material->texture == NULL) return material->color;
 
@@ -62,20 +62,12 @@ Color Triangle::colorAt(const Point &point)
     float tcu = (t0.x * tcw) + (t1.x * r) + (t2.x * t);
     float tcv = (t0.y * tcw) + (t1.y * r) + (t2.y * t);
 
-    if(tcu < 0 || tcu > 1.0 || tcv < 0 || tcv > 1.0)
-    {
-        std::cout << "denom: " << denom << "\n";
-        std::cout << "r: " << r << "\n";
-        std::cout << "t: " << t << "\n";
-        std::cout << "tcw: " << tcw << "\n";
-        std::cout << "tcu: " << tcu << "\n";
-        std::cout << "tcv: " << tcw << "\n";
-        std::cout << "t0: " << t0 << "\n";
-        std::cout << "t1: " << t1 << "\n";
-        std::cout << "t2: " << t2 << "\n";
-    }
-
-    return material->texture->colorAt(tcu, 1.0 - tcv);
+    //scale the footprint by the ratio between texture and surface area.
+    Vector tu = t1 - t0;
+    Vector tv = t2 - t0;
+    double texScale = sqrt(tu.cross(tv).length() / denom);
+    double d = footprint * texScale;
+    return material->texture->sample(tcu, 1.0 - tcv, d, d);
 
 /*
     Vector f1 = v0 - point;
@@ -88,8 +80,6 @@ Color Triangle::colorAt(const Point &point)
     float a3 = f1.cross(f2).length() / a;
 
     Vector uvz = (t0 * a1 + t1 * a2 + t2 * a3);
-    if(uvz.x > 1.0 || uvz.x < 0.0) std::cout << "oh-ooh, u is: "  << uvz.x << std::endl;
-    if(uvz.y > 1.0 || uvz.y < 0.0) std::cout << "oh-ooh, v is: "  << uvz.y << std::endl;
 
     return material->texture->colorAt(uvz.x, uvz.y);
 */
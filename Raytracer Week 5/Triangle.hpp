@@ -15,7 +15,7 @@ class Triangle : public Object
         //Triangle(const Triangle&) = delete;
 
         virtual Hit intersect(const Ray &ray);
-        virtual Color colorAt(const Point &point);
+        virtual Color colorAt(const Point &point, double footprint);
 
         //corners
         const Point v0;
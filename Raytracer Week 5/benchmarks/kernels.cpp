@@ -0,0 +1,337 @@
+/*
+    Benchmark created for the course Computer graphics (2016 - 2017).
+    Times the intersection, shading and vector kernels on fixed sets of
+    random rays (the same every run) and reports the median time per
+    call with the spread over the repetitions. Every kernel is run until
+    it is warm, then timed in repetitions of a few milliseconds each.
+
+    With --save the medians are written to a baseline file, with
+    --baseline they are compared to one, a change smaller than the noise
+    is reported as such.
+
+    usage: kernels [--save baseline.txt] [--baseline baseline.txt] [repetitions] [model.obj]
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <iomanip>
+#include <map>
+#include <string>
+#include <vector>
+#include "../scene.h"
+#include "../sphere.h"
+#include "../Disk.h"
+#include "../Cylinder.h"
+#include "../Triangle.hpp"
+#include "../Mesh.hpp"
+#include "../TextureCache.hpp"
+#include "../Random.hpp"
+
+static volatile double sink; //keeps the results from being optimized away
+
+//reaches the shading of a scene, which is not part of its interface
+class KernelBenchmark
+{
+public:
+    static Color phong(Scene &scene, Object *obj, const Point &hit, const Vector &N, const Vector &V)
+    {
+        return scene.phongColor(obj->material, hit, N, V, obj, 0, 0.001, 0.0);
+    }
+};
+
+//in the unit ball
+static Vector inBall(Random &random)
+{
+    for(;;)
+    {
+        Vector v(2 * random.uniform() - 1, 2 * random.uniform() - 1, 2 * random.uniform() - 1);
+        if(v.length_2() <= 1 && v.length_2() > 1e-6) return v;
+    }
+}
+
+//rays from around a ball aimed into it, about half of them hit what is inside
+static std::vector<Ray> raysAt(const Point &center, double radius, size_t count, unsigned long long seed)
+{
+    Random random(seed);
+    std::vector<Ray> rays;
+    for(size_t i = 0; i < count; ++i)
+    {
+        Point from = center + inBall(random).normalized() * 4 * radius;
+        Point to = center + inBall(random) * radius;
+        rays.push_back(Ray(from, (to - from).normalized()));
+    }
+    return rays;
+}
+
+static double seconds(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+struct Kernel
+{
+    std::string name;
+    size_t calls;                   //per pass
+    std::function<double()> pass;   //calls the kernel calls times, returns a checksum
+};
+
+struct Result
+{
+    double median;  //ns per call
+    double best;
+    double spread;  //median absolute deviation, relative to the median
+};
+
+static Result measure(const Kernel &kernel, int repetitions)
+{
+    //warm up, and repeat the pass often enough to take a few milliseconds
+    size_t loops = 1;
+    auto warm = std::chrono::steady_clock::now();
+    for(;;)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for(size_t l = 0; l < loops; ++l) sink += kernel.pass();
+        if(seconds(start) >= 0.005 && seconds(warm) >= 0.05) break;
+        if(seconds(start) < 0.005) loops *= 2;
+    }
+
+    std::vector<double> times;
+    for(int r = 0; r < repetitions; ++r)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for(size_t l = 0; l < loops; ++l) sink += kernel.pass();
+        times.push_back(seconds(start) * 1e9 / (loops * kernel.calls));
+    }
+    std::sort(times.begin(), times.end());
+
+    Result result;
+    result.median = times[times.size() / 2];
+    result.best = times[0];
+    std::vector<double> deviations;
+    for(size_t i = 0; i < times.size(); ++i) deviations.push_back(std::abs(times[i] - result.median));
+    std::sort(deviations.begin(), deviations.end());
+    result.spread = deviations[deviations.size() / 2] / result.median;
+    return result;
+}
+
+static bool readBaseline(const char *filename, std::map<std::string, double> &baseline)
+{
+    std::ifstream in(filename);
+    if(!in)
+    {
+        std::cerr << "Error: unable to open baseline " << filename << "." << std::endl;
+        return false;
+    }
+    std::string line;
+    while(std::getline(in, line))
+    {
+        if(line.empty() || line[0] == '#') continue;
+        size_t space = line.rfind(' ');
+        if(space == std::string::npos) continue;
+        baseline[line.substr(0, space)] = atof(line.c_str() + space + 1);
+    }
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *save = NULL, *compare = NULL;
+    while(argc > 2 && (std::string(argv[1]) == "--save" || std::string(argv[1]) == "--baseline"))
+    {
+        (std::string(argv[1]) == "--save" ? save : compare) = argv[2];
+        argc -= 2;
+        argv += 2;
+    }
+    int repetitions = std::max(argc > 1 ? atoi(argv[1]) : 15, 1);
+    const char *model = argc > 2 ? argv[2] : "objects/cat.obj";
+
+    std::map<std::string, double> baseline;
+    if(compare && !readBaseline(compare, baseline)) return 1;
+
+    const size_t COUNT = 4096;
+    std::vector<Kernel> kernels;
+
+    Material plain;
+    plain.color = Color(0.8, 0.4, 0.2);
+    plain.ka = 0.2;
+    plain.kd = 0.7;
+    plain.ks = 0.5;
+    plain.n = 32;
+
+    //intersections
+    Sphere sphere(Point(0, 0, 0), 1);
+    Disk disk(Point(0, 0, 0), Vector(0.3, 1, 0.2), 1);
+    Cylinder cylinder(Point(0, -1, 0), Vector(0.2, 1, 0.1), 0.5, 2);
+    Triangle triangle(Point(-1, -1, 0), Point(1, -1, 0.2), Point(0, 1, -0.2),
+                      Vector(0, 0, 1), Vector(0.1, 0, 1), Vector(0, 0.1, 1));
+    Object *shapes[] = {&sphere, &disk, &cylinder, &triangle};
+    const char *shapeNames[] = {"Sphere::intersect", "Disk::intersect", "Cylinder::intersect", "Triangle::intersect"};
+    std::vector<Ray> rays = raysAt(Point(0, 0, 0), 1, COUNT, 1);
+    for(int s = 0; s < 4; ++s)
+    {
+        Object *shape = shapes[s];
+        shape->material = &plain;
+        kernels.push_back(Kernel{shapeNames[s], COUNT, [shape, &rays]()
+        {
+            double sum = 0;
+            for(size_t i = 0; i < rays.size(); ++i)
+            {
+                Hit hit = shape->intersect(rays[i]);
+                if(hit.object) sum += hit.t;
+            }
+            return sum;
+        }});
+    }
+
+    Mesh *mesh = new Mesh(&plain);
+    std::vector<Ray> meshRays;
+    std::string error;
+    if(!mesh->load(model, Vector(0, 0, 0), 1, std::cout, error))
+        std::cerr << "Warning: reading " << model << " failed (" << error << "), Mesh::intersect is not timed." << std::endl;
+    else if(mesh->triangles.empty()) std::cerr << "Warning: " << model << " has no triangles, Mesh::intersect is not timed." << std::endl;
+    else
+    {
+        meshRays = raysAt(mesh->bounding_sphere->position, mesh->bounding_sphere->r, COUNT, 2);
+        kernels.push_back(Kernel{"Mesh::intersect", COUNT, [mesh, &meshRays]()
+        {
+            double sum = 0;
+            for(size_t i = 0; i < meshRays.size(); ++i)
+            {
+                Hit hit = mesh->intersect(meshRays[i]);
+                if(hit.object) sum += hit.t;
+            }
+            return sum;
+        }});
+    }
+
+    //shading of the points where the rays hit a sphere, lit by two lights
+    struct Surface { Point hit; Vector N, V; };
+    std::vector<Surface> surfaces;
+    for(size_t i = 0; i < rays.size(); ++i)
+    {
+        Hit hit = sphere.intersect(rays[i]);
+        if(!hit.object) continue;
+        Surface surface = {rays[i].at(hit.t), hit.N, -rays[i].D};
+        surfaces.push_back(surface);
+    }
+    Scene scene;
+    Sphere *lit = new Sphere(Point(0, 0, 0), 1);
+    lit->material = new Material(plain);
+    scene.addObject(lit);
+    scene.addLight(new Light(Point(-5, 5, 5), Color(1, 1, 1)));
+    scene.addLight(new Light(Point(5, 2, 3), Color(0.5, 0.5, 0.6)));
+    kernels.push_back(Kernel{"Scene::phongColor", surfaces.size(), [&scene, lit, &surfaces]()
+    {
+        double sum = 0;
+        for(size_t i = 0; i < surfaces.size(); ++i)
+            sum += KernelBenchmark::phong(scene, lit, surfaces[i].hit, surfaces[i].N, surfaces[i].V).r;
+        return sum;
+    }});
+
+    Material textured(plain);
+    textured.texture = TextureCache::acquire("earthmap1k.png");
+    Sphere globe(Point(0, 0, 0), 1, 23.5, Vector(0.2, 1, 0));
+    globe.material = &textured;
+    if(!textured.texture) std::cerr << "Warning: earthmap1k.png could not be read, Sphere::colorAt is not timed." << std::endl;
+    else kernels.push_back(Kernel{"Sphere::colorAt", surfaces.size(), [&globe, &surfaces]()
+    {
+        double sum = 0;
+        for(size_t i = 0; i < surfaces.size(); ++i)
+            sum += globe.colorAt(surfaces[i].hit, 0.002).g;
+        return sum;
+    }});
+
+    //vector math on random vectors
+    Random random(3);
+    std::vector<Vector> a, b;
+    for(size_t i = 0; i < COUNT; ++i)
+    {
+        a.push_back(inBall(random));
+        b.push_back(inBall(random));
+    }
+    kernels.push_back(Kernel{"Triple::operator+", COUNT, [&a, &b]()
+    {
+        Vector sum;
+        for(size_t i = 0; i < a.size(); ++i) sum += a[i] + b[i];
+        return sum.x;
+    }});
+    kernels.push_back(Kernel{"Triple::operator*", COUNT, [&a, &b]()
+    {
+        Vector sum;
+        for(size_t i = 0; i < a.size(); ++i) sum += a[i] * b[i] * 0.5;
+        return sum.y;
+    }});
+    kernels.push_back(Kernel{"Triple::dot", COUNT, [&a, &b]()
+    {
+        double sum = 0;
+        for(size_t i = 0; i < a.size(); ++i) sum += a[i].dot(b[i]);
+        return sum;
+    }});
+    kernels.push_back(Kernel{"Triple::cross", COUNT, [&a, &b]()
+    {
+        Vector sum;
+        for(size_t i = 0; i < a.size(); ++i) sum += a[i].cross(b[i]);
+        return sum.z;
+    }});
+    kernels.push_back(Kernel{"Triple::normalized", COUNT, [&a]()
+    {
+        Vector sum;
+        for(size_t i = 0; i < a.size(); ++i) sum += a[i].normalized();
+        return sum.x;
+    }});
+
+    std::ofstream out;
+    if(save)
+    {
+        out.open(save);
+        if(!out)
+        {
+            std::cerr << "Error: unable to open " << save << " for writing." << std::endl;
+            return 1;
+        }
+        out << "# kernel, median ns per call\n";
+    }
+
+    std::cout << repetitions << " repetitions, ns per call\n" << std::fixed;
+    std::cout << std::setw(22) << "kernel" << std::setw(10) << "median" << std::setw(10) << "best" << std::setw(9) << "spread";
+    if(compare) std::cout << std::setw(11) << "baseline" << std::setw(10) << "change";
+    std::cout << "\n";
+    for(size_t k = 0; k < kernels.size(); ++k)
+    {
+        Result result = measure(kernels[k], repetitions);
+        std::cout << std::setw(22) << kernels[k].name << std::setprecision(2)
+                  << std::setw(10) << result.median << std::setw(10) << result.best
+                  << std::setprecision(1) << std::setw(8) << 100 * result.spread << "%";
+        if(compare)
+        {
+            std::map<std::string, double>::const_iterator old = baseline.find(kernels[k].name);
+            if(old == baseline.end() || old->second <= 0) std::cout << std::setw(11) << "-";
+            else
+            {
+                //a change within three times the spread, or 2%, is noise
+                double change = result.median / old->second - 1;
+                double noise = std::max(3 * result.spread, 0.02);
+                std::cout << std::setprecision(2) << std::setw(11) << old->second << std::setprecision(1)
+                          << std::setw(9) << std::showpos << 100 * change << std::noshowpos << "%"
+                          << (change > noise ? " slower" : change < -noise ? " faster" : "");
+            }
+        }
+        std::cout << "\n";
+        if(save) out << kernels[k].name << " " << std::setprecision(6) << result.median << "\n";
+    }
+
+    bool ok = true;
+    if(save)
+    {
+        out.close();
+        ok = !out.fail();
+        if(!ok) std::cerr << "Error: writing " << save << " failed." << std::endl;
+        else std::cout << "Baseline written to " << save << ".\n";
+    }
+    delete mesh;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,82 @@
+/*
+    Benchmark created for the course Computer graphics (2016 - 2017).
+    Reads an OBJ file with glmReadOBJ and with ObjReader and reports the
+    speed of both in MB/s of OBJ text, and whether the models agree.
+
+    usage: objload [model.obj] [repetitions] [threads]
+*/
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <iomanip>
+#include <sys/stat.h>
+#include "../ObjReader.hpp"
+
+static double seconds(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static bool same(const GLMmodel *a, const GLMmodel *b)
+{
+    if(a->numvertices != b->numvertices || a->numnormals != b->numnormals
+        || a->numtexcoords != b->numtexcoords || a->numtriangles != b->numtriangles
+        || a->numgroups != b->numgroups || a->nummaterials != b->nummaterials)
+        return false;
+    if(memcmp(a->vertices + 3, b->vertices + 3, 3 * sizeof(GLfloat) * a->numvertices)
+        || (a->numnormals && memcmp(a->normals + 3, b->normals + 3, 3 * sizeof(GLfloat) * a->numnormals))
+        || (a->numtexcoords && memcmp(a->texcoords + 2, b->texcoords + 2, 2 * sizeof(GLfloat) * a->numtexcoords)))
+        return false;
+    for(GLuint i = 0; i < a->numtriangles; ++i)
+        if(memcmp(a->triangles[i].vindices, b->triangles[i].vindices, sizeof(a->triangles[i].vindices)))
+            return false;
+    for(const GLMgroup *g = a->groups, *h = b->groups; g; g = g->next, h = h->next)
+        if(strcmp(g->name, h->name) || g->material != h->material || g->numtriangles != h->numtriangles
+            || memcmp(g->triangles, h->triangles, sizeof(GLuint) * g->numtriangles))
+            return false;
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *input = argc > 1 ? argv[1] : "objects/cat.obj";
+    int repetitions = argc > 2 ? atoi(argv[2]) : 5;
+    size_t threads = argc > 3 ? atoi(argv[3]) : ThreadPool::defaultThreads();
+
+    struct stat info;
+    if(stat(input, &info) != 0) return 1;
+    double megabytes = double(info.st_size) / (1 << 20);
+
+    double glm = 1e30, reader = 1e30;
+    GLMmodel *expected = NULL, *model = NULL;
+    for(int r = 0; r <= repetitions; ++r) //the first run warms up the page cache
+    {
+        if(expected) glmDelete(expected);
+        auto start = std::chrono::steady_clock::now();
+        expected = glmReadOBJ(input);
+        if(r > 0) glm = std::min(glm, seconds(start));
+
+        if(model) glmDelete(model);
+        start = std::chrono::steady_clock::now();
+        ObjReader objReader(threads);
+        model = objReader.read(input);
+        if(!model)
+        {
+            std::cerr << input << ": " << objReader.error() << std::endl;
+            return 1;
+        }
+        if(r > 0) reader = std::min(reader, seconds(start));
+    }
+
+    std::cout << input << ": " << std::fixed << std::setprecision(2) << megabytes << " MB, "
+              << model->numtriangles << " triangles\n"
+              << "  glmReadOBJ: " << std::setw(8) << megabytes / glm << " MB/s\n"
+              << "   ObjReader: " << std::setw(8) << megabytes / reader << " MB/s with "
+              << threads << " threads, " << (same(expected, model) ? "same model" : "DIFFERENT model") << "\n";
+    bool ok = same(expected, model);
+    glmDelete(expected);
+    glmDelete(model);
+    return ok ? 0 : 1;
+}
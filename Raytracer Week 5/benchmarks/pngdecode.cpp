@@ -0,0 +1,164 @@
+/*
+    Benchmark created for the course Computer graphics (2016 - 2017).
+    Compares texture loading through LodePNG (decode to RGBA, then tile)
+    with the PngReader path that unfilters straight into the tiles, and
+    reports the speed of the checksums. Besides the given PNG files a
+    4096x2048 upscaled copy of the first one is written and decoded.
+    Every file is first decoded both ways, the benchmark fails unless
+    PngReader gives exactly the RGBA values LodePNG gives.
+
+    usage: pngdecode [image.png ...]
+*/
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include "../ImageWriter.hpp"
+#include "../PngReader.hpp"
+#include "../Texture.hpp"
+#include "../lodepng.h"
+
+typedef std::chrono::steady_clock Clock;
+
+static double seconds(Clock::time_point start)
+{
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+//best of a few runs, the textures print a line for every load
+template<class F>
+static double best(F f, int runs = 5)
+{
+    std::ostringstream quiet;
+    std::streambuf *out = std::cout.rdbuf(quiet.rdbuf());
+    double fastest = 1e30;
+    for(int r = 0; r < runs; ++r)
+    {
+        Clock::time_point start = Clock::now();
+        f();
+        fastest = std::min(fastest, seconds(start));
+    }
+    std::cout.rdbuf(out);
+    return fastest;
+}
+
+//PngReader has to give the pixels LodePNG gives, or leave the file to it
+static bool matchesLodePNG(const char *filename, const std::vector<unsigned char> &file)
+{
+    LodePNG::Decoder decoder;
+    std::vector<unsigned char> expected, actual;
+    decoder.decode(expected, &file[0], (unsigned)file.size());
+    if(decoder.hasError())
+    {
+        std::cerr << "Error: LodePNG cannot decode " << filename << " (error " << decoder.getError() << ")." << std::endl;
+        return false;
+    }
+
+    PngReader reader;
+    int width = 0, height = 0;
+    PngReader::Result result = reader.decode(&file[0], file.size(),
+        [&](int w, int h) { width = w; height = h; actual.assign(4 * size_t(w) * h, 0); },
+        [&](int y, const unsigned char *rgba) { memcpy(&actual[4 * size_t(y) * width], rgba, 4 * size_t(width)); });
+    if(result == PngReader::UNSUPPORTED)
+    {
+        std::cout << filename << ": PngReader leaves the file to LodePNG.\n";
+        return true;
+    }
+    if(result == PngReader::FAILED)
+    {
+        std::cerr << "Error: PngReader fails on " << filename << " (" << reader.error() << "), LodePNG decodes it." << std::endl;
+        return false;
+    }
+    if(unsigned(width) != decoder.getWidth() || unsigned(height) != decoder.getHeight())
+    {
+        std::cerr << "Error: PngReader decodes " << filename << " as " << width << "x" << height
+                  << ", LodePNG as " << decoder.getWidth() << "x" << decoder.getHeight() << "." << std::endl;
+        return false;
+    }
+    for(size_t i = 0; i < expected.size(); ++i)
+    {
+        if(actual[i] == expected[i]) continue;
+        size_t pixel = i / 4;
+        std::cerr << "Error: PngReader and LodePNG differ in " << filename << " at pixel ("
+                  << pixel % width << ", " << pixel / width << "), channel " << i % 4 << ": "
+                  << int(actual[i]) << " instead of " << int(expected[i]) << "." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+static bool benchmark(const char *filename)
+{
+    Texture texture;
+    std::vector<unsigned char> file, rgba;
+    LodePNG::loadFile(file, filename);
+    if(file.empty())
+    {
+        std::cerr << "Error: unable to read " << filename << "." << std::endl;
+        return false;
+    }
+    if(!matchesLodePNG(filename, file)) return false;
+    best([&]() { texture.read_png(filename); }, 1);
+    if(texture.width() == 0) return false;
+    double megabytes = 4.0 * texture.width() * texture.height() / (1 << 20);
+
+    double lode = best([&]() {
+        LodePNG::Decoder decoder;
+        decoder.decode(rgba, &file[0], (unsigned)file.size());
+        texture.build(&rgba[0], decoder.getWidth(), decoder.getHeight());
+    });
+    double fast = best([&]() { texture.read_png(filename); });
+    double rows = best([&]() {
+        PngReader reader;
+        reader.decode(&file[0], file.size(), [](int, int) { }, [](int, const unsigned char *) { });
+    });
+
+    std::cout << filename << ": " << texture.width() << "x" << texture.height() << ", "
+              << file.size() << " bytes\n" << std::fixed << std::setprecision(1)
+              << "    LodePNG + build:      " << std::setw(7) << megabytes / lode << " MB/s\n"
+              << "    PngReader texture:    " << std::setw(7) << megabytes / fast << " MB/s ("
+              << std::setprecision(2) << lode / fast << "x)\n" << std::setprecision(1)
+              << "    PngReader rows only:  " << std::setw(7) << megabytes / rows << " MB/s\n";
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    std::vector<const char*> files;
+    for(int i = 1; i < argc; ++i) files.push_back(argv[i]);
+    if(files.empty()) files.push_back("earthmap1k.png");
+
+    //a larger texture: the first file scaled up with bilinear filtering
+    const char *large = "pngdecode-4096.png";
+    {
+        Texture source;
+        best([&]() { source.read_png(files[0]); }, 1);
+        Image img(4096, 2048);
+        for(int y = 0; y < img.height(); ++y)
+            for(int x = 0; x < img.width(); ++x)
+                img.put_pixel(x, y, source.sample((x + 0.5) / img.width(), (y + 0.5) / img.height()));
+        if(!img.write_png(large)) return 1;
+    }
+    files.push_back(large);
+
+    bool matched = true;
+    for(size_t i = 0; i < files.size(); ++i)
+        matched = benchmark(files[i]) && matched;
+    remove(large);
+
+    std::vector<unsigned char> data(64 << 20);
+    for(size_t i = 0; i < data.size(); ++i) data[i] = (unsigned char)(i * 2654435761u >> 24);
+    volatile unsigned sink = 0; //keeps the checksums from being optimized away
+    double lodeAdler = best([&]() { sink += LodeZlib_adler32(1, &data[0], data.size()); });
+    double adler = best([&]() { sink += PngReader::adler32(1, &data[0], data.size()); });
+    double crc = best([&]() { sink += PngReader::crc32(0, &data[0], data.size()); });
+    std::cout << "checksums over 64 MB:\n"
+              << "    LodePNG adler32:      " << std::setw(7) << 64 / lodeAdler << " MB/s\n"
+              << "    PngReader adler32:    " << std::setw(7) << 64 / adler << " MB/s\n"
+              << "    PngReader crc32:      " << std::setw(7) << 64 / crc << " MB/s\n";
+    return matched ? 0 : 1;
+}
@@ -0,0 +1,63 @@
+/*
+    Benchmark created for the course Computer graphics (2016 - 2017).
+    Encodes an image at every PNG compression level, with one thread and
+    with all hardware threads, and reports the encode speed in MB/s of
+    8 bit RGB input together with the compressed size.
+
+    usage: pngencode [image.png] [repetitions] [threads]
+*/
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <iomanip>
+#include <sys/stat.h>
+#include "../ImageWriter.hpp"
+
+static double encode(const Image &img, PngWriter::Level level, size_t threads, const char *out)
+{
+    auto start = std::chrono::steady_clock::now();
+    PngWriter writer(out, level, threads);
+    if(!writer.begin(img.width(), img.height())
+        || !writer.write_rows(img, 0, img.height())
+        || !writer.finish())
+        exit(1);
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char *argv[])
+{
+    const char *input = argc > 1 ? argv[1] : "earthmap1k.png";
+    int repetitions = argc > 2 ? atoi(argv[2]) : 5;
+    const char *out = "pngencode-benchmark.png";
+
+    Image img(input);
+    if(img.width() == 0) return 1;
+    double megabytes = 3.0 * img.width() * img.height() / (1 << 20);
+    std::cout << input << ": " << img.width() << "x" << img.height() << ", "
+              << std::fixed << std::setprecision(2) << megabytes << " MB of RGB data\n";
+
+    size_t counts[2] = {1, argc > 3 ? size_t(atoi(argv[3])) : ThreadPool::defaultThreads()};
+    for(int l = PngWriter::STORE; l <= PngWriter::BEST; ++l)
+    {
+        for(int t = 0; t < (counts[1] > 1 ? 2 : 1); ++t)
+        {
+            PngWriter::Level level = PngWriter::Level(l);
+            encode(img, level, counts[t], out); //warm up
+
+            double best = 1e30;
+            for(int r = 0; r < repetitions; ++r)
+                best = std::min(best, encode(img, level, counts[t], out));
+
+            struct stat info;
+            stat(out, &info);
+            std::cout << std::setw(8) << PngWriter::levelName(level) << std::setw(4) << counts[t] << " threads: "
+                      << std::setw(8) << megabytes / best << " MB/s, "
+                      << std::setw(10) << info.st_size << " bytes ("
+                      << 100.0 * info.st_size / (megabytes * (1 << 20)) << "%)\n";
+        }
+    }
+    remove(out);
+    return 0;
+}
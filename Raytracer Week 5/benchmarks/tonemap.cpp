@@ -0,0 +1,88 @@
+/*
+    Benchmark created for the course Computer graphics (2016 - 2017).
+    Converts every row of an image to 8 and 16 bit output values with a
+    few tone mapping settings and reports the speed in megapixels per
+    second, next to the per pixel conversion the writers used to do.
+
+    usage: tonemap [image.png] [repetitions]
+*/
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include "../image.h"
+#include "../ToneMapper.hpp"
+
+static unsigned checksum; //keeps the conversions from being optimized away
+
+static double seconds(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static double perPixel(const Image &img)
+{
+    auto start = std::chrono::steady_clock::now();
+    std::vector<unsigned char> row(3 * size_t(img.width()));
+    for(int y = 0; y < img.height(); ++y)
+    {
+        for(int x = 0; x < img.width(); ++x)
+        {
+            Color c = img.get_pixel(x, y);
+            for(int i = 0; i < 3; ++i)
+                row[3 * x + i] = c.data[i] <= 0.0 ? 0 : c.data[i] >= 1.0 ? 255 : (unsigned char)(c.data[i] * 255.0);
+        }
+        checksum += row[y % row.size()];
+    }
+    return seconds(start);
+}
+
+static double rows(const Image &img, const ToneMapper &mapper)
+{
+    auto start = std::chrono::steady_clock::now();
+    std::vector<float> rgb(3 * size_t(img.width()));
+    std::vector<unsigned char> row(rgb.size() * mapper.bytesPerChannel());
+    for(int y = 0; y < img.height(); ++y)
+    {
+        img.get_row(y, &rgb[0]);
+        mapper.map_row(&rgb[0], img.width(), y, &row[0]);
+        checksum += row[y % row.size()];
+    }
+    return seconds(start);
+}
+
+int main(int argc, char *argv[])
+{
+    const char *input = argc > 1 ? argv[1] : "earthmap1k.png";
+    int repetitions = argc > 2 ? atoi(argv[2]) : 5;
+
+    Image img(input);
+    if(img.width() == 0) return 1;
+    double megapixels = double(img.width()) * img.height() / 1e6;
+    std::cout << input << ": " << img.width() << "x" << img.height() << "\n" << std::fixed << std::setprecision(1);
+
+    double best = 1e30;
+    for(int r = 0; r <= repetitions; ++r) best = std::min(best, perPixel(img));
+    std::cout << std::setw(32) << "per pixel, 8 bits: " << std::setw(8) << megapixels / best << " MP/s\n";
+
+    ToneMapper settings[4];
+    settings[1].transfer = ToneMapper::SRGB;
+    settings[1].dither = true;
+    settings[2] = settings[1];
+    settings[2].op = ToneMapper::ACES;
+    settings[2].exposure = 1.0f;
+    settings[3] = settings[2];
+    settings[3].bits = 16;
+    for(int s = 0; s < 4; ++s)
+    {
+        const ToneMapper &m = settings[s];
+        best = 1e30;
+        for(int r = 0; r <= repetitions; ++r) best = std::min(best, rows(img, m)); //the first run warms up
+        std::cout << std::setw(8) << ToneMapper::operatorName(m.op) << std::setw(7) << ToneMapper::transferName(m.transfer)
+                  << (m.dither ? " dither" : "       ") << std::setw(3) << m.bits << " bits: "
+                  << std::setw(8) << megapixels / best << " MP/s\n";
+    }
+    return checksum == 1; //practically never
+}
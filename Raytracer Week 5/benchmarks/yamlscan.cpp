@@ -0,0 +1,103 @@
+/*
+    Benchmark created for the course Computer graphics (2016 - 2017).
+    Scans a scene file with the yaml-cpp scanner (tokens only) and parses
+    it into a node tree, and reports the speed of both in MB/s of YAML
+    text. Without a file it scans a generated scene of many spheres, in
+    the layout of our scene files.
+
+    usage: yamlscan [scene.yaml] [repetitions]
+*/
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include "../yaml/yaml.h"
+#include "../yaml/scanner.h"
+
+static double seconds(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+//a scene with the given number of spheres, the same every time
+static std::string generateScene(int spheres)
+{
+    std::string yaml = "---\nCamera:\n    eye: [200,200,1000]\n    center: [200,200,0]\n    up: [0,1,0]\n"
+                       "    viewSize: [16,16]\n\nLights:\n- position: [-200,600,1500]\n  color: [1.0,1.0,1.0]\n\n"
+                       "Objects:\n";
+    unsigned seed = 1;
+    char line[512];
+    for(int i = 0; i < spheres; ++i)
+    {
+        double r[7];
+        for(int j = 0; j < 7; ++j)
+        {
+            seed = seed * 1103515245 + 12345;
+            r[j] = (seed >> 8) / double(1 << 24);
+        }
+        snprintf(line, sizeof(line), "- type: sphere # number %d\n  position: [%.3f,%.3f,%.3f]\n  radius: %.2f\n"
+                 "  material:\n    color: [%.2f,%.2f,%.2f]\n    ka: 0.2\n    kd: 0.7\n    ks: 0.5\n    n: 64\n",
+                 i, 400 * r[0], 400 * r[1], -400 * r[2], 1 + 4 * r[3], r[4], r[5], r[6]);
+        yaml += line;
+    }
+    return yaml + "RenderMode: \"phong\"\n";
+}
+
+int main(int argc, char *argv[])
+{
+    int repetitions = argc > 2 ? atoi(argv[2]) : 5;
+
+    std::string yaml, name = "generated scene";
+    if(argc > 1)
+    {
+        std::ifstream file(argv[1], std::ios::binary);
+        if(!file)
+        {
+            std::cerr << "Error: unable to open " << argv[1] << "." << std::endl;
+            return 1;
+        }
+        std::stringstream contents;
+        contents << file.rdbuf();
+        yaml = contents.str();
+        name = argv[1];
+    }
+    else yaml = generateScene(20000);
+    double megabytes = double(yaml.size()) / (1 << 20);
+
+    double scan = 1e30, parse = 1e30;
+    size_t tokens = 0;
+    try
+    {
+        for(int r = 0; r < repetitions; ++r)
+        {
+            std::istringstream input(yaml);
+            auto start = std::chrono::steady_clock::now();
+            YAML::Scanner scanner(input);
+            for(tokens = 0; !scanner.empty(); ++tokens)
+                scanner.pop();
+            scan = std::min(scan, seconds(start));
+
+            std::istringstream document(yaml);
+            start = std::chrono::steady_clock::now();
+            YAML::Parser parser(document);
+            YAML::Node doc;
+            parser.GetNextDocument(doc);
+            parse = std::min(parse, seconds(start));
+        }
+    }
+    catch(YAML::Exception &e)
+    {
+        std::cerr << "Error: " << name << ": " << e.what() << std::endl;
+        return 1;
+    }
+
+    std::cout << name << ": " << std::fixed << std::setprecision(2) << megabytes << " MB, " << tokens << " tokens\n"
+              << "  scanner: " << std::setw(8) << megabytes / scan << " MB/s\n"
+              << "   parser: " << std::setw(8) << megabytes / parse << " MB/s (scanner and node tree)\n";
+    return 0;
+}
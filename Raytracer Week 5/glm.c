@@ -17,21 +17,14 @@
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#include <pthread.h>
+#include <unistd.h>
 #include "glm.h"
 
 
 #define T(x) (model->triangles[(x)])
 
 
-/* _GLMnode: general purpose node
- */
-typedef struct _GLMnode {
-  GLuint           index;
-  GLboolean        averaged;
-  struct _GLMnode* next;
-} GLMnode;
-
-
 /* glmMax: returns the maximum of two floats */
 static GLfloat
 glmMax(GLfloat a, GLfloat b) 
@@ -115,6 +108,212 @@ glmEqual(GLfloat* u, GLfloat* v, GLfloat epsilon)
   return GL_FALSE;
 }
 
+/* glmParallel: calls work(data, begin, end) on consecutive ranges that
+ * together cover [0, count), one range per processor. The calling
+ * thread does the first range, counts too small to split are done
+ * there entirely.
+ */
+typedef GLvoid (*GLMwork)(GLvoid* data, GLuint begin, GLuint end);
+
+typedef struct _GLMtask {
+  GLMwork work;
+  GLvoid* data;
+  GLuint  begin, end;
+} GLMtask;
+
+#define GLM_MAX_THREADS 64
+#define GLM_MIN_RANGE   16384
+
+static GLvoid*
+glmRunTask(GLvoid* task)
+{
+  GLMtask* t = (GLMtask*)task;
+  t->work(t->data, t->begin, t->end);
+  return NULL;
+}
+
+static GLvoid
+glmParallel(GLuint count, GLMwork work, GLvoid* data)
+{
+  GLMtask   tasks[GLM_MAX_THREADS];
+  pthread_t threads[GLM_MAX_THREADS];
+  int       started[GLM_MAX_THREADS];
+  long      cpus;
+  GLuint    numtasks, i;
+
+  cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  numtasks = count / GLM_MIN_RANGE + 1;
+  if (cpus < 1) cpus = 1;
+  if (numtasks > (GLuint)cpus) numtasks = (GLuint)cpus;
+  if (numtasks > GLM_MAX_THREADS) numtasks = GLM_MAX_THREADS;
+
+  for (i = 0; i < numtasks; i++) {
+    tasks[i].work  = work;
+    tasks[i].data  = data;
+    tasks[i].begin = (GLuint)((unsigned long long)count * i / numtasks);
+    tasks[i].end   = (GLuint)((unsigned long long)count * (i + 1) / numtasks);
+  }
+  for (i = 1; i < numtasks; i++)
+    started[i] = pthread_create(&threads[i], NULL, glmRunTask, &tasks[i]) == 0;
+  glmRunTask(&tasks[0]);
+  for (i = 1; i < numtasks; i++) {
+    if (started[i])
+      pthread_join(threads[i], NULL);
+    else
+      glmRunTask(&tasks[i]);	/* no thread for it, do it here */
+  }
+}
+
+
+/* _GLMweld: a spatial hash of the vectors being welded. The grid cells
+ * are 4 * epsilon wide, so every vector within epsilon of a vector is
+ * in the cell of that vector or, when it is within epsilon of a side,
+ * in the neighbour on that side: at most 8 cells to look in, usually
+ * far fewer. The vectors of every hash bucket are stored in index
+ * order in one array (compressed rows).
+ */
+typedef struct _GLMweld {
+  GLfloat* vectors;			/* 1 based, as in the model */
+  double   scale;			/* 1 / cell size */
+  GLuint   mask;			/* number of buckets - 1 */
+  GLuint*  bucket;			/* hash bucket of every vector */
+  GLuint*  start;			/* first entry of every bucket */
+  GLuint*  entries;			/* vector indices by bucket */
+} GLMweld;
+
+static GLvoid
+glmWeldCell(GLMweld* weld, GLfloat* v, long long* cell, int* side)
+{
+  double x;
+  int    i;
+
+  for (i = 0; i < 3; i++) {
+    x = v[i] * weld->scale;
+    if (!(x > -1e18 && x < 1e18)) x = 0.0;	/* huge or NaN: any cell will do */
+    cell[i] = (long long)floor(x);
+    x -= cell[i];
+    side[i] = x < 0.25 ? -1 : x > 0.75 ? 1 : 0;
+  }
+}
+
+static GLuint
+glmWeldHash(GLMweld* weld, long long x, long long y, long long z)
+{
+  unsigned long long h;
+
+  h = (unsigned long long)x * 73856093ULL ^ (unsigned long long)y * 19349663ULL ^
+      (unsigned long long)z * 83492791ULL;
+  h ^= h >> 29;
+  h *= 0xbf58476d1ce4e5b9ULL;
+  h ^= h >> 32;
+  return (GLuint)h & weld->mask;
+}
+
+static GLvoid
+glmWeldBuckets(GLvoid* data, GLuint begin, GLuint end)
+{
+  GLMweld*  weld = (GLMweld*)data;
+  long long cell[3];
+  int       side[3];
+  GLuint    i;
+
+  for (i = begin; i < end; i++) {
+    glmWeldCell(weld, &weld->vectors[3 * (i + 1)], cell, side);
+    weld->bucket[i] = glmWeldHash(weld, cell[0], cell[1], cell[2]);
+  }
+}
+
+/* glmWeldMap: welds vectors like glmWeldVectors, but returns the new
+ * index of every vector in map (1 based, to be free'd) instead of
+ * storing it in the vectors, where large indices would not fit.
+ * Every vector becomes the first earlier vector that was kept and is
+ * within epsilon of it, as when comparing every vector with all kept
+ * ones, but only vectors in nearby cells of a spatial hash are
+ * compared.
+ */
+static GLfloat*
+glmWeldMap(GLfloat* vectors, GLuint* numvectors, GLfloat epsilon, GLuint** map)
+{
+  GLMweld   weld;
+  GLfloat*  copies;
+  GLuint*   kept;			/* index in copies, 0 if welded */
+  GLuint    copied, numbuckets, n;
+  GLuint    i, j, e, b, best;
+  long long cell[3];
+  int       side[3], k;
+
+  n = *numvectors;
+  copies = (GLfloat*)malloc(sizeof(GLfloat) * 3 * (n + 1));
+  memcpy(copies, vectors, (sizeof(GLfloat) * 3 * (n + 1)));
+  kept = (GLuint*)calloc(n + 1, sizeof(GLuint));
+  *map = (GLuint*)malloc(sizeof(GLuint) * (n + 1));
+  (*map)[0] = 0;
+
+  /* at least as many buckets as vectors */
+  numbuckets = 1;
+  while (numbuckets < n && numbuckets < 0x80000000u)
+    numbuckets <<= 1;
+
+  weld.vectors = vectors;
+  weld.scale   = epsilon > 0 ? 1.0 / (4.0 * epsilon) : 0.0;
+  weld.mask    = numbuckets - 1;
+  weld.bucket  = (GLuint*)malloc(sizeof(GLuint) * (n + 1));
+  weld.start   = (GLuint*)calloc(numbuckets + 1, sizeof(GLuint));
+  weld.entries = (GLuint*)malloc(sizeof(GLuint) * (n + 1));
+  glmParallel(n, glmWeldBuckets, &weld);
+
+  /* sort the vectors by bucket, keeping them in index order */
+  for (i = 0; i < n; i++)
+    weld.start[weld.bucket[i] + 1]++;
+  for (b = 0; b < numbuckets; b++)
+    weld.start[b + 1] += weld.start[b];
+  for (i = 0; i < n; i++)
+    weld.entries[weld.start[weld.bucket[i]]++] = i + 1;
+  for (b = numbuckets; b > 0; b--)
+    weld.start[b] = weld.start[b - 1];
+  weld.start[0] = 0;
+
+  copied = 1;
+  for (i = 1; i <= n; i++) {
+    best = 0;
+    if (epsilon > 0) {
+      glmWeldCell(&weld, &vectors[3 * i], cell, side);
+      for (k = 0; k < 8; k++) {
+	if ((k & 1 && !side[0]) || (k & 2 && !side[1]) || (k & 4 && !side[2]))
+	  continue;			/* no neighbour needed on this axis */
+	b = glmWeldHash(&weld, cell[0] + (k & 1 ? side[0] : 0),
+			cell[1] + (k & 2 ? side[1] : 0),
+			cell[2] + (k & 4 ? side[2] : 0));
+	for (e = weld.start[b]; e < weld.start[b + 1]; e++) {
+	  j = weld.entries[e];
+	  if (j >= i || (best && j >= best))
+	    break;
+	  if (kept[j] && glmEqual(&vectors[3 * i], &vectors[3 * j], epsilon))
+	    best = j;
+	}
+      }
+    }
+
+    if (best) {
+      (*map)[i] = kept[best];
+    } else {
+      /* must not be any duplicates -- add to the copies array */
+      copies[3 * copied + 0] = vectors[3 * i + 0];
+      copies[3 * copied + 1] = vectors[3 * i + 1];
+      copies[3 * copied + 2] = vectors[3 * i + 2];
+      (*map)[i] = kept[i] = copied++;
+    }
+  }
+
+  free(weld.bucket);
+  free(weld.start);
+  free(weld.entries);
+  free(kept);
+
+  *numvectors = copied-1;
+  return copies;
+}
+
 /* glmWeldVectors: eliminate (weld) vectors that are within an
  * epsilon of each other.
  *
@@ -127,34 +326,18 @@ GLfloat*
 glmWeldVectors(GLfloat* vectors, GLuint* numvectors, GLfloat epsilon)
 {
   GLfloat* copies;
-  GLuint   copied;
-  GLuint   i, j;
+  GLuint*  map;
+  GLuint   i, n;
 
-  copies = (GLfloat*)malloc(sizeof(GLfloat) * 3 * (*numvectors + 1));
-  memcpy(copies, vectors, (sizeof(GLfloat) * 3 * (*numvectors + 1)));
+  n = *numvectors;
+  copies = glmWeldMap(vectors, numvectors, epsilon, &map);
 
-  copied = 1;
-  for (i = 1; i <= *numvectors; i++) {
-    for (j = 1; j <= copied; j++) {
-      if (glmEqual(&vectors[3 * i], &copies[3 * j], epsilon)) {
-	goto duplicate;
-      }
-    }
-
-    /* must not be any duplicates -- add to the copies array */
-    copies[3 * copied + 0] = vectors[3 * i + 0];
-    copies[3 * copied + 1] = vectors[3 * i + 1];
-    copies[3 * copied + 2] = vectors[3 * i + 2];
-    j = copied;				/* pass this along for below */
-    copied++;
-
-  duplicate:
-    /* set the first component of this vector to point at the correct
-       index into the new copies array */
-    vectors[3 * i + 0] = (GLfloat)j;
-  }
+  /* set the first component of this vector to point at the correct
+     index into the new copies array */
+  for (i = 1; i <= n; i++)
+    vectors[3 * i + 0] = (GLfloat)map[i];
+  free(map);
 
-  *numvectors = copied-1;
   return copies;
 }
 
@@ -981,169 +1164,226 @@ glmFacetNormals(GLMmodel* model)
   }
 }
 
-/* glmVertexNormals: Generates smooth vertex normals for a model.
- * First builds a list of all the triangles each vertex is in.  Then
- * loops through each vertex in the the list averaging all the facet
- * normals of the triangles each vertex is in.  Finally, sets the
- * normal index in the triangle for the vertex to the generated smooth
- * normal.  If the dot product of a facet normal and the facet normal
- * associated with the first triangle in the list of triangles the
- * current vertex is in is greater than the cosine of the angle
- * parameter to the function, that facet normal is not added into the
- * average normal calculation and the corresponding vertex is given
- * the facet normal.  This tends to preserve hard edges.  The angle to
- * use depends on the model, but 90 degrees is usually a good start.
- *
- * model - initialized GLMmodel structure
- * angle - maximum angle (in degrees) to smooth across
+/* _GLMadjacency: the triangles around every vertex as compressed rows,
+ * the triangles of vertex i are entries[start[i]] up to
+ * entries[start[i + 1]], the newest triangle first.
  */
-GLvoid
-glmVertexNormals(GLMmodel* model, GLfloat angle)
-{
-  GLMnode*  node;
-  GLMnode*  tail;
-  GLMnode** members;
-  GLfloat*  normals;
-  GLuint    numnormals;
-  GLfloat   average[3];
-  GLfloat   dot, cos_angle;
-  GLuint    i, avg;
+typedef struct _GLMadjacency {
+  GLMmodel*  model;
+  GLfloat    cos_angle;
+  GLuint*    start;			/* numvertices + 2 offsets */
+  GLuint*    cursor;			/* next free entry while filling */
+  GLuint*    entries;			/* triangle indices */
+  GLboolean* averaged;			/* per entry */
+  GLfloat*   average;			/* smooth normal of every vertex */
+  GLuint*    first;			/* first new normal of every vertex */
+} GLMadjacency;
 
-  assert(model);
-  assert(model->facetnorms);
+static GLvoid
+glmCountCorners(GLvoid* data, GLuint begin, GLuint end)
+{
+  GLMadjacency* adj = (GLMadjacency*)data;
+  GLMmodel*     model = adj->model;
+  GLuint        i, j;
 
-  /* calculate the cosine of the angle (in degrees) */
-  cos_angle = cos(angle * M_PI / 180.0);
+  for (i = begin; i < end; i++)
+    for (j = 0; j < 3; j++)
+      __sync_fetch_and_add(&adj->start[T(i).vindices[j] + 1], 1);
+}
 
-  /* nuke any previous normals */
-  if (model->normals)
-    free(model->normals);
+static GLvoid
+glmFillCorners(GLvoid* data, GLuint begin, GLuint end)
+{
+  GLMadjacency* adj = (GLMadjacency*)data;
+  GLMmodel*     model = adj->model;
+  GLuint        i, j;
 
-  /* allocate space for new normals */
-  model->numnormals = model->numtriangles * 3; /* 3 normals per triangle */
-  model->normals = (GLfloat*)malloc(sizeof(GLfloat)* 3* (model->numnormals+1));
+  for (i = begin; i < end; i++)
+    for (j = 0; j < 3; j++)
+      adj->entries[__sync_fetch_and_add(&adj->cursor[T(i).vindices[j]], 1)] = i;
+}
 
-  /* allocate a structure that will hold a linked list of triangle
-     indices for each vertex */
-  members = (GLMnode**)malloc(sizeof(GLMnode*) * (model->numvertices + 1));
-  for (i = 1; i <= model->numvertices; i++)
-    members[i] = NULL;
-  
-  /* for every triangle, create a node for each vertex in it */
-  for (i = 0; i < model->numtriangles; i++) {
-    node = (GLMnode*)malloc(sizeof(GLMnode));
-    node->index = i;
-    node->next  = members[T(i).vindices[0]];
-    members[T(i).vindices[0]] = node;
-
-    node = (GLMnode*)malloc(sizeof(GLMnode));
-    node->index = i;
-    node->next  = members[T(i).vindices[1]];
-    members[T(i).vindices[1]] = node;
-
-    node = (GLMnode*)malloc(sizeof(GLMnode));
-    node->index = i;
-    node->next  = members[T(i).vindices[2]];
-    members[T(i).vindices[2]] = node;
-  }
+/* glmAverageNormals: sorts the triangles of every vertex (newest
+ * first, as glm's linked lists had them), decides which of them are
+ * averaged and counts the normals the vertex needs.
+ */
+static GLvoid
+glmAverageNormals(GLvoid* data, GLuint begin, GLuint end)
+{
+  GLMadjacency* adj = (GLMadjacency*)data;
+  GLMmodel*     model = adj->model;
+  GLfloat*      average;
+  GLfloat*      facet;
+  GLfloat       dot;
+  GLuint        i, e, f, t, count, avg;
+
+  for (i = begin; i < end; i++) {
+    GLuint  first = adj->start[i + 1];
+    GLuint  last  = adj->start[i + 2];
+
+    /* insertion sort, there are only a few triangles per vertex */
+    for (e = first + 1; e < last; e++) {
+      t = adj->entries[e];
+      for (f = e; f > first && adj->entries[f - 1] < t; f--)
+	adj->entries[f] = adj->entries[f - 1];
+      adj->entries[f] = t;
+    }
 
-  /* calculate the average normal for each vertex */
-  numnormals = 1;
-  for (i = 1; i <= model->numvertices; i++) {
-    /* calculate an average normal for this vertex by averaging the
-       facet normal of every triangle this vertex is in */
-    node = members[i];
-    if (!node)
-      fprintf(stderr, "glmVertexNormals(): vertex w/o a triangle\n");
+    average = &adj->average[3 * (i + 1)];
     average[0] = 0.0; average[1] = 0.0; average[2] = 0.0;
     avg = 0;
-    while (node) {
+    count = 0;
+    for (e = first; e < last; e++) {
       /* only average if the dot product of the angle between the two
          facet normals is greater than the cosine of the threshold
          angle -- or, said another way, the angle between the two
          facet normals is less than (or equal to) the threshold angle */
-      dot = glmDot(&model->facetnorms[3 * T(node->index).findex],
- 		    &model->facetnorms[3 * T(members[i]->index).findex]);
-      if (dot > cos_angle) {
-	node->averaged = GL_TRUE;
-	average[0] += model->facetnorms[3 * T(node->index).findex + 0];
-	average[1] += model->facetnorms[3 * T(node->index).findex + 1];
-	average[2] += model->facetnorms[3 * T(node->index).findex + 2];
+      facet = &model->facetnorms[3 * T(adj->entries[e]).findex];
+      dot = glmDot(facet, &model->facetnorms[3 * T(adj->entries[first]).findex]);
+      if (dot > adj->cos_angle) {
+	adj->averaged[e] = GL_TRUE;
+	average[0] += facet[0];
+	average[1] += facet[1];
+	average[2] += facet[2];
 	avg = 1;			/* we averaged at least one normal! */
       } else {
-	node->averaged = GL_FALSE;
+	adj->averaged[e] = GL_FALSE;
+	count++;			/* this one gets the facet normal */
       }
-      node = node->next;
     }
-
     if (avg) {
-      /* normalize the averaged normal */
       glmNormalize(average);
+      count++;
+    }
+    adj->first[i + 1] = count;
+  }
+}
 
-      /* add the normal to the vertex normals list */
-      model->normals[3 * numnormals + 0] = average[0];
-      model->normals[3 * numnormals + 1] = average[1];
-      model->normals[3 * numnormals + 2] = average[2];
-      avg = numnormals;
-      numnormals++;
+/* glmStoreNormals: stores the normals of every vertex from its first
+ * new normal on, the averaged one first, and points the triangles at
+ * them.
+ */
+static GLvoid
+glmStoreNormals(GLvoid* data, GLuint begin, GLuint end)
+{
+  GLMadjacency* adj = (GLMadjacency*)data;
+  GLMmodel*     model = adj->model;
+  GLfloat*      facet;
+  GLuint        i, e, t, n, avg, index;
+
+  for (i = begin + 1; i <= end; i++) {
+    n = adj->first[i];
+    avg = 0;
+    for (e = adj->start[i]; e < adj->start[i + 1]; e++) {
+      if (adj->averaged[e] && !avg) {
+	avg = n++;
+	model->normals[3 * avg + 0] = adj->average[3 * i + 0];
+	model->normals[3 * avg + 1] = adj->average[3 * i + 1];
+	model->normals[3 * avg + 2] = adj->average[3 * i + 2];
+      }
     }
 
     /* set the normal of this vertex in each triangle it is in */
-    node = members[i];
-    while (node) {
-      if (node->averaged) {
+    for (e = adj->start[i]; e < adj->start[i + 1]; e++) {
+      t = adj->entries[e];
+      if (adj->averaged[e]) {
 	/* if this node was averaged, use the average normal */
-	if (T(node->index).vindices[0] == i)
-	  T(node->index).nindices[0] = avg;
-	else if (T(node->index).vindices[1] == i)
-	  T(node->index).nindices[1] = avg;
-	else if (T(node->index).vindices[2] == i)
-	  T(node->index).nindices[2] = avg;
+	index = avg;
       } else {
 	/* if this node wasn't averaged, use the facet normal */
-	model->normals[3 * numnormals + 0] = 
-	  model->facetnorms[3 * T(node->index).findex + 0];
-	model->normals[3 * numnormals + 1] = 
-	  model->facetnorms[3 * T(node->index).findex + 1];
-	model->normals[3 * numnormals + 2] = 
-	  model->facetnorms[3 * T(node->index).findex + 2];
-	if (T(node->index).vindices[0] == i)
-	  T(node->index).nindices[0] = numnormals;
-	else if (T(node->index).vindices[1] == i)
-	  T(node->index).nindices[1] = numnormals;
-	else if (T(node->index).vindices[2] == i)
-	  T(node->index).nindices[2] = numnormals;
-	numnormals++;
+	facet = &model->facetnorms[3 * T(t).findex];
+	index = n++;
+	model->normals[3 * index + 0] = facet[0];
+	model->normals[3 * index + 1] = facet[1];
+	model->normals[3 * index + 2] = facet[2];
       }
-      node = node->next;
+      if (T(t).vindices[0] == i)
+	T(t).nindices[0] = index;
+      else if (T(t).vindices[1] == i)
+	T(t).nindices[1] = index;
+      else if (T(t).vindices[2] == i)
+	T(t).nindices[2] = index;
     }
   }
-  
-  model->numnormals = numnormals - 1;
+}
+
+/* glmVertexNormals: Generates smooth vertex normals for a model.
+ * First builds a list of all the triangles each vertex is in.  Then
+ * loops through each vertex in the the list averaging all the facet
+ * normals of the triangles each vertex is in.  Finally, sets the
+ * normal index in the triangle for the vertex to the generated smooth
+ * normal.  If the dot product of a facet normal and the facet normal
+ * associated with the first triangle in the list of triangles the
+ * current vertex is in is greater than the cosine of the angle
+ * parameter to the function, that facet normal is not added into the
+ * average normal calculation and the corresponding vertex is given
+ * the facet normal.  This tends to preserve hard edges.  The angle to
+ * use depends on the model, but 90 degrees is usually a good start.
+ * The lists are compressed rows of one array and the vertices are
+ * done in parallel, in two passes: one to count the normals of every
+ * vertex and one to store them where the counts say.
+ *
+ * model - initialized GLMmodel structure
+ * angle - maximum angle (in degrees) to smooth across
+ */
+GLvoid
+glmVertexNormals(GLMmodel* model, GLfloat angle)
+{
+  GLMadjacency adj;
+  GLuint       numentries, numnormals, lonely, count, i;
 
-  /* free the member information */
+  assert(model);
+  assert(model->facetnorms);
+
+  /* calculate the cosine of the angle (in degrees) */
+  adj.model = model;
+  adj.cos_angle = cos(angle * M_PI / 180.0);
+
+  /* nuke any previous normals */
+  if (model->normals)
+    free(model->normals);
+
+  /* count the triangles of every vertex, then turn the counts into
+     offsets: the triangles of vertex i start at start[i] */
+  numentries = 3 * model->numtriangles;
+  adj.start    = (GLuint*)calloc(model->numvertices + 2, sizeof(GLuint));
+  adj.cursor   = (GLuint*)malloc(sizeof(GLuint) * (model->numvertices + 2));
+  adj.entries  = (GLuint*)malloc(sizeof(GLuint) * (numentries + 1));
+  adj.averaged = (GLboolean*)malloc(sizeof(GLboolean) * (numentries + 1));
+  adj.average  = (GLfloat*)malloc(sizeof(GLfloat) * 3 * (model->numvertices + 1));
+  adj.first    = (GLuint*)malloc(sizeof(GLuint) * (model->numvertices + 2));
+  glmParallel(model->numtriangles, glmCountCorners, &adj);
+  for (i = 1; i <= model->numvertices + 1; i++)
+    adj.start[i] += adj.start[i - 1];
+  memcpy(adj.cursor, adj.start, sizeof(GLuint) * (model->numvertices + 2));
+  glmParallel(model->numtriangles, glmFillCorners, &adj);
+
+  /* count the normals of every vertex, the counts become the index of
+     its first normal */
+  glmParallel(model->numvertices, glmAverageNormals, &adj);
+  lonely = 0;
+  numnormals = 1;
   for (i = 1; i <= model->numvertices; i++) {
-    node = members[i];
-    while (node) {
-      tail = node;
-      node = node->next;
-      free(tail);
-    }
+    if (adj.start[i] == adj.start[i + 1])
+      lonely++;
+    count = adj.first[i];
+    adj.first[i] = numnormals;
+    numnormals += count;
   }
-  free(members);
+  if (lonely)
+    fprintf(stderr, "glmVertexNormals(): %u vertices w/o a triangle\n", lonely);
 
-  /* pack the normals array (we previously allocated the maximum
-     number of normals that could possibly be created (numtriangles *
-     3), so get rid of some of them (usually alot unless none of the
-     facet normals were averaged)) */
-  normals = model->normals;
+  /* allocate space for exactly the new normals */
+  model->numnormals = numnormals - 1;
   model->normals = (GLfloat*)malloc(sizeof(GLfloat)* 3* (model->numnormals+1));
-  for (i = 1; i <= model->numnormals; i++) {
-    model->normals[3 * i + 0] = normals[3 * i + 0];
-    model->normals[3 * i + 1] = normals[3 * i + 1];
-    model->normals[3 * i + 2] = normals[3 * i + 2];
-  }
-  free(normals);
+  glmParallel(model->numvertices, glmStoreNormals, &adj);
+
+  free(adj.start);
+  free(adj.cursor);
+  free(adj.entries);
+  free(adj.averaged);
+  free(adj.average);
+  free(adj.first);
 }
 
 
@@ -1563,6 +1803,26 @@ glmWriteOBJ(GLMmodel* model, char* filename, GLuint mode)
 }
 
 
+/* _GLMremap: the new vertex index of every old one, for glmRemap */
+typedef struct _GLMremap {
+  GLMmodel* model;
+  GLuint*   map;
+} GLMremap;
+
+static GLvoid
+glmRemap(GLvoid* data, GLuint begin, GLuint end)
+{
+  GLMremap* remap = (GLMremap*)data;
+  GLMmodel* model = remap->model;
+  GLuint    i;
+
+  for (i = begin; i < end; i++) {
+    T(i).vindices[0] = remap->map[T(i).vindices[0]];
+    T(i).vindices[1] = remap->map[T(i).vindices[1]];
+    T(i).vindices[2] = remap->map[T(i).vindices[2]];
+  }
+}
+
 /* glmWeld: eliminate (weld) vectors that are within an epsilon of
  * each other.
  *
@@ -1574,39 +1834,25 @@ glmWriteOBJ(GLMmodel* model, char* filename, GLuint mode)
 GLuint
 glmWeld(GLMmodel* model, GLfloat epsilon)
 {
-  GLfloat* vectors;
+  GLMremap remap;
   GLfloat* copies;
   GLuint   numvectors;
-  GLuint   i, welded;
+  GLuint   welded;
 
   /* vertices */
   numvectors = model->numvertices;
-  vectors    = model->vertices;
-  copies = glmWeldVectors(vectors, &numvectors, epsilon);
-  welded = model->numvertices - numvectors - 1;
-
-  for (i = 0; i < model->numtriangles; i++) {
-    T(i).vindices[0] = (GLuint)vectors[3 * T(i).vindices[0] + 0];
-    T(i).vindices[1] = (GLuint)vectors[3 * T(i).vindices[1] + 0];
-    T(i).vindices[2] = (GLuint)vectors[3 * T(i).vindices[2] + 0];
-  }
+  copies = glmWeldMap(model->vertices, &numvectors, epsilon, &remap.map);
+  welded = model->numvertices - numvectors;
 
-  /* free space for old vertices */
-  free(vectors);
+  remap.model = model;
+  glmParallel(model->numtriangles, glmRemap, &remap);
+  free(remap.map);
 
-  /* allocate space for the new vertices */
+  /* free space for old vertices, the copies are the new ones (the
+     space left over at the end is not worth another copy) */
+  free(model->vertices);
   model->numvertices = numvectors;
-  model->vertices = (GLfloat*)malloc(sizeof(GLfloat) * 
-				     3 * (model->numvertices + 1));
-
-  /* copy the optimized vertices into the actual vertex list */
-  for (i = 1; i <= model->numvertices; i++) {
-    model->vertices[3 * i + 0] = copies[3 * i + 0];
-    model->vertices[3 * i + 1] = copies[3 * i + 1];
-    model->vertices[3 * i + 2] = copies[3 * i + 2];
-  }
-
-  free(copies);
+  model->vertices = copies;
 
   return welded;
 }
@@ -13,78 +13,310 @@
 //
 
 #include "image.h"
+#include "ImageWriter.hpp"
 #include "lodepng.h"
+#include "PngReader.hpp"
+#include "Trace.hpp"
+#include "Memory.hpp"
 #include <fstream>
+#include <vector>
+#include <string>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+size_t Image::bytesFor(int width, int height, Format format)
+{
+    size_t tilesX = (width + TILE_SIZE - 1) / TILE_SIZE;
+    size_t tilesY = (height + TILE_SIZE - 1) / TILE_SIZE;
+    size_t channel = format == FLOAT16 ? sizeof(unsigned short) : sizeof(float);
+    return tilesX * tilesY * TILE_SIZE * TILE_SIZE * 3 * channel;
+}
+
+/*
+* Maps a new, already unlinked, temporary file of the given size. NULL if failed.
+*/
+static void *map_temporary_file(size_t bytes)
+{
+    const char *dir = getenv("TMPDIR");
+    std::string name = std::string(dir ? dir : "/tmp") + "/raytracer-framebuffer-XXXXXX";
+    std::vector<char> path(name.begin(), name.end());
+    path.push_back(0);
+
+    int fd = mkstemp(&path[0]);
+    if (fd < 0) return 0;
+    unlink(&path[0]); // the file lives on until it is unmapped
+
+    void *data = 0;
+    if (ftruncate(fd, bytes) == 0) {
+        data = mmap(0, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (data == MAP_FAILED) data = 0;
+    }
+    close(fd);
+    return data;
+}
+
+void Image::free_storage()
+{
+    void *data = _pixel ? (void*)_pixel : (void*)_half;
+    if (data) {
+        if (_outOfCore) munmap(data, _storageBytes);
+        else {
+            free(data);
+            Memory::remove(Memory::FRAMEBUFFER, _storageBytes);
+        }
+    }
+    _pixel = 0;
+    _half = 0;
+    _storageBytes = 0;
+}
 
 /*
 * Create a picture. Answer false if failed.
 */
 bool Image::set_extent(int width, int height)
 {
+    free_storage();
     _width = width;
     _height = height;
-    if (_pixel) delete[] _pixel;
-    _pixel = size() > 0 ? new Color[size()] : 0;
-    return _pixel != 0;
+    _tilesX = (width + TILE_SIZE - 1) / TILE_SIZE;
+    if (size() <= 0) return false;
+
+    size_t bytes = bytesFor(width, height, _format);
+    void *data = 0;
+    if (_outOfCore) {
+        data = map_temporary_file(bytes);
+        if (!data) {
+            cerr << "Warning: unable to map a framebuffer file, keeping the image in memory." << endl;
+            _outOfCore = false;
+        }
+    }
+    if (!data) data = calloc(bytes, 1);
+    if (!data) return false;
+
+    _storageBytes = bytes;
+    if (!_outOfCore) Memory::add(Memory::FRAMEBUFFER, bytes);
+    if (_format == FLOAT16) _half = (unsigned short*)data;
+    else _pixel = (float*)data;
+    return true;
 }
 
+void Image::discard_rows(int y0, int y1)
+{
+    if (_storageBytes == 0) return;
+
+    int firstBand = (y0 + TILE_SIZE - 1) / TILE_SIZE;
+    int endBand = y1 >= _height ? (_height + TILE_SIZE - 1) / TILE_SIZE : y1 / TILE_SIZE;
+    if (endBand <= firstBand) return;
+
+    // punch the whole pages of these bands out of the file, or give them
+    // back to the system for in-core images, so streamed output stays small
+    uintptr_t data = _pixel ? (uintptr_t)_pixel : (uintptr_t)_half;
+    uintptr_t page = sysconf(_SC_PAGESIZE);
+    uintptr_t begin = (data + firstBand * bandBytes() + page - 1) / page * page;
+    uintptr_t end = (data + endBand * bandBytes()) / page * page;
+    if (end <= begin) return;
+    if (!_outOfCore || madvise((void*)begin, end - begin, MADV_REMOVE) != 0)
+        madvise((void*)begin, end - begin, MADV_DONTNEED);
+}
 
-void Image::write_png(const char* filename) const
+/*
+* Copies a row out of the tiles, a tile wide piece at a time.
+*/
+void Image::get_row(int y, float *rgb) const
 {
-    std::vector<unsigned char> image;
-    image.resize(_width * _height * 4);
-    std::vector<unsigned char>::iterator imageIterator = image.begin();
-    Color *currentPixel = _pixel;
-    while (imageIterator != image.end()) {
-        *imageIterator = (unsigned char)(currentPixel->r * 255.0);
-        imageIterator++;
-        *imageIterator = (unsigned char)(currentPixel->g * 255.0);
-        imageIterator++;
-        *imageIterator = (unsigned char)(currentPixel->b * 255.0);
-        imageIterator++;
-        *imageIterator = 255;
-        imageIterator++;
-        currentPixel++;
+    for (int x = 0; x < _width; x += TILE_SIZE) {
+        size_t count = 3 * size_t(std::min<int>(TILE_SIZE, _width - x));
+        size_t i = index(x, y);
+        if (_format == FLOAT16) {
+            for (size_t c = 0; c < count; ++c) rgb[c] = halfToFloat(_half[i + c]);
+        } else {
+            memcpy(rgb, _pixel + i, count * sizeof(float));
+        }
+        rgb += count;
     }
-    LodePNG::encode(filename, image, _width, _height);
 }
 
+bool Image::write(const char* filename) const
+{
+    std::string name(filename);
+    std::string extension = name.size() >= 4 ? name.substr(name.size() - 4) : "";
+    if (extension == ".pfm") return write_pfm(filename);
+    if (extension == ".exr") return write_exr(filename);
+    return write_png(filename);
+}
 
-void Image::read_png(const char* filename)
+bool Image::write_png(const char* filename) const
 {
-    std::vector<unsigned char> buffer, image;
-    //load the image file with given filename
-    LodePNG::loadFile(buffer, filename);
-
-    //decode the png
-    LodePNG::Decoder decoder;
-    decoder.decode(image, buffer.empty() ? 0 : &buffer[0], (unsigned)buffer.size());
-    cout << decoder.getChannels() << endl;
-    cout << decoder.getBpp() << endl;
-
-    if (decoder.getChannels()<3 || decoder.getBpp()<24) {
-        cerr << "Error: only color (RGBA), 8 bit per channel png images are supported." << endl;
-        cerr << "Either convert your image or change the sourcecode." << endl;
-        exit(1);
+    Trace::Scope trace("writePNG", filename);
+    //bands of about 64MB of 8 bit rows, each of them is compressed in parallel
+    int band = std::max<int>(1, (64 << 20) / (3 * std::max(_width, 1)));
+    PngWriter writer(filename);
+    bool ok = writer.begin(_width, _height);
+    for (int y = 0; ok && y < _height; y += band)
+        ok = writer.write_rows(*this, y, std::min(y + band, _height));
+    return ok && writer.finish();
+}
+
+/*
+* Portable float map: little endian (negative scale), rows stored bottom to top.
+*/
+bool Image::write_pfm(const char* filename) const
+{
+    std::ofstream out(filename, std::ios::binary);
+    if (!out) {
+        cerr << "Error: unable to open " << filename << " for writing." << endl;
+        return false;
+    }
+    out << "PF\n" << _width << " " << _height << "\n-1.0\n";
+
+    std::vector<float> row(3 * _width);
+    for (int y = _height - 1; y >= 0; --y) {
+        for (int x = 0; x < _width; ++x) {
+            Color c = get_pixel(x, y);
+            row[3 * x + 0] = c.r;
+            row[3 * x + 1] = c.g;
+            row[3 * x + 2] = c.b;
+        }
+        out.write((const char*)&row[0], row.size() * sizeof(float));
+    }
+    return bool(out);
+}
+
+// Little endian helpers for the EXR header
+static void putInt(std::vector<unsigned char> &out, unsigned int value, int bytes = 4)
+{
+    for (int i = 0; i < bytes; ++i) out.push_back((value >> (8 * i)) & 0xff);
+}
+
+static void putFloat(std::vector<unsigned char> &out, float value)
+{
+    unsigned int bits;
+    memcpy(&bits, &value, sizeof(bits));
+    putInt(out, bits);
+}
+
+static void putAttribute(std::vector<unsigned char> &out, const char *name, const char *type, unsigned int size)
+{
+    out.insert(out.end(), name, name + strlen(name) + 1);
+    out.insert(out.end(), type, type + strlen(type) + 1);
+    putInt(out, size);
+}
+
+/*
+* Scanline OpenEXR file with HALF B, G and R channels and no compression.
+*/
+bool Image::write_exr(const char* filename) const
+{
+    std::ofstream out(filename, std::ios::binary);
+    if (!out) {
+        cerr << "Error: unable to open " << filename << " for writing." << endl;
+        return false;
+    }
+
+    std::vector<unsigned char> header;
+    putInt(header, 20000630);       // magic number
+    putInt(header, 2);              // version 2, scanline file
+
+    // channels are listed (and stored) in alphabetical order
+    putAttribute(header, "channels", "chlist", 3 * 18 + 1);
+    const char *channels[] = {"B", "G", "R"};
+    for (int c = 0; c < 3; ++c) {
+        header.push_back(channels[c][0]);
+        header.push_back(0);
+        putInt(header, 1);          // HALF
+        putInt(header, 0);          // pLinear and reserved
+        putInt(header, 1);          // x sampling
+        putInt(header, 1);          // y sampling
+    }
+    header.push_back(0);
+
+    putAttribute(header, "compression", "compression", 1);
+    header.push_back(0);            // NO_COMPRESSION
+    putAttribute(header, "dataWindow", "box2i", 16);
+    putInt(header, 0); putInt(header, 0); putInt(header, _width - 1); putInt(header, _height - 1);
+    putAttribute(header, "displayWindow", "box2i", 16);
+    putInt(header, 0); putInt(header, 0); putInt(header, _width - 1); putInt(header, _height - 1);
+    putAttribute(header, "lineOrder", "lineOrder", 1);
+    header.push_back(0);            // INCREASING_Y
+    putAttribute(header, "pixelAspectRatio", "float", 4);
+    putFloat(header, 1.0f);
+    putAttribute(header, "screenWindowCenter", "v2f", 8);
+    putFloat(header, 0.0f); putFloat(header, 0.0f);
+    putAttribute(header, "screenWindowWidth", "float", 4);
+    putFloat(header, 1.0f);
+    header.push_back(0);            // end of header
+
+    // offset table, one block per scanline
+    size_t lineBytes = 8 + size_t(_width) * 3 * 2;
+    size_t offset = header.size() + size_t(_height) * 8;
+    for (int y = 0; y < _height; ++y) {
+        unsigned long long position = offset + y * lineBytes;
+        putInt(header, position & 0xffffffff);
+        putInt(header, position >> 32);
+    }
+    out.write((const char*)&header[0], header.size());
+
+    std::vector<unsigned char> line;
+    line.reserve(lineBytes);
+    for (int y = 0; y < _height; ++y) {
+        line.clear();
+        putInt(line, y);
+        putInt(line, _width * 3 * 2);
+        for (int c = 2; c >= 0; --c) {
+            for (int x = 0; x < _width; ++x) {
+                Color color = get_pixel(x, y);
+                putInt(line, floatToHalf(color.data[c]), 2);
+            }
+        }
+        out.write((const char*)&line[0], line.size());
+    }
+    return bool(out);
+}
+
+
+bool Image::read_png(const char* filename)
+{
+    // common formats are decoded row by row, the rest by LodePNG
+    PngReader reader;
+    PngReader::Result result = reader.decode(filename,
+        [this](int w, int h) { set_extent(w, h); },
+        [this](int y, const unsigned char *p) {
+            for (int x = 0; x < _width; ++x, p += 4)
+                put_pixel(x, y, Color(p[0], p[1], p[2]) / 255.0);
+        });
+
+    if (result == PngReader::FAILED) {
+        cerr << "Error: decoding " << filename << " failed (" << reader.error() << ")." << endl;
+        return false;
+    }
+
+    if (result == PngReader::UNSUPPORTED) {
+        std::vector<unsigned char> buffer, image;
+        LodePNG::loadFile(buffer, filename);
+
+        //decode the png, the decoder converts to 8 bit RGBA
+        LodePNG::Decoder decoder;
+        decoder.decode(image, &buffer[0], (unsigned)buffer.size());
+        if (decoder.hasError()) {
+            cerr << "Error: decoding " << filename << " failed (LodePNG error " << decoder.getError() << ")." << endl;
+            return false;
+        }
+
+        int w = decoder.getWidth();
+        int h = decoder.getHeight();
+        set_extent(w,h);
+
+        // now convert the image data, ignoring the alpha channel
+        for (int y = 0; y < h; ++y) {
+            for (int x = 0; x < w; ++x) {
+                const unsigned char *p = &image[4 * (size_t(y) * w + x)];
+                put_pixel(x, y, Color(p[0], p[1], p[2]) / 255.0);
+            }
+        }
     }
-    int w = decoder.getWidth();
-    int h = decoder.getHeight();
-    set_extent(w,h);
-
-    // now convert the image data
-    std::vector<unsigned char>::iterator imageIterator = image.begin();
-    Color *currentPixel = _pixel;
-    while (imageIterator != image.end()) {
-        currentPixel->r = (*imageIterator)/255.0;
-        imageIterator++;
-        currentPixel->g = (*imageIterator)/255.0;
-        imageIterator++;
-        currentPixel->b = (*imageIterator)/255.0;
-        imageIterator++;
-        // Let's just ignore the alpha channel
-        imageIterator++; 
-        currentPixel++;
-    }	
 
     cout << "succesfully read image file from " << filename << endl;
+    return true;
 }
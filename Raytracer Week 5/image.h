@@ -16,111 +16,190 @@
 #define IMAGE_H_IOLFQARK
 
 #include <iostream>
+#include <string.h>
 #include "triple.h"
 
+// Conversion between float and IEEE 754 half precision (used by FLOAT16 images and EXR output)
+inline unsigned short floatToHalf(float f);
+inline float halfToFloat(unsigned short h);
 
+// Render target, stores linear RGB as 32 bit floats (12 bytes per pixel)
+// or, to halve that again, as 16 bit halfs (6 bytes per pixel).
+// Pixels are stored in square tiles, a row of tiles (a band) is contiguous.
+// Out-of-core images keep their pixels in a memory mapped temporary file,
+// so only the bands being worked on have to be resident.
 class Image
 {
+public:
+    enum Format
+    {
+        FLOAT32,
+        FLOAT16
+    };
+
+    enum { TILE_BITS = 5, TILE_SIZE = 1 << TILE_BITS };
+
 protected:
-    Color* _pixel;
+    float* _pixel;              // FLOAT32 storage, 3 per pixel
+    unsigned short* _half;      // FLOAT16 storage, 3 per pixel
     int _width;
     int _height;
+    int _tilesX;
+    Format _format;
+    bool _outOfCore;
+    size_t _storageBytes;
 
 public:
-    Image(int width=0, int height=0)
-        : _pixel(0), _width(0), _height(0)
+    Image(int width=0, int height=0, Format format=FLOAT32, bool outOfCore=false)
+        : _pixel(0), _half(0), _width(0), _height(0), _tilesX(0), _format(format),
+          _outOfCore(outOfCore), _storageBytes(0)
     {
         set_extent(width, height);    //creates array
     }
 
     Image(const char *imageFilename)
-        : _pixel(0), _width(0), _height(0)
+        : _pixel(0), _half(0), _width(0), _height(0), _tilesX(0), _format(FLOAT32),
+          _outOfCore(false), _storageBytes(0)
     {
         read_png(imageFilename);
     }
 
-
-
     ~Image()
     {
-        if (_pixel) delete[] _pixel;
+        free_storage();
     }
 
-    // Normal accessors
-    inline void put_pixel(int x, int y, Color c);
+    // Accessors
+    inline void put_pixel(int x, int y, const Color &c);
     inline Color get_pixel(int x, int y) const;
-
-    // Handier accessors
-    // Usage: color = img(x,y);
-    //        img(x,y) = color;
-    inline const Color& operator()(int x, int y) const;
-    inline Color& operator()(int x, int y);
-
-    // Normalized accessors, interval is (0...1, 0...1)
-    inline const Color& colorAt(float x, float y) const;
-
-    // Normalized accessors for bumpmapping. Uses green component.
-    inline void derivativeAt(float x, float y, float *dx, float *dy) const;
+    void get_row(int y, float *rgb) const;   // 3 * width floats, left to right
 
     // Image parameters
     inline int width() const    { return _width; }
     inline int height() const   { return _height; }
     inline int size() const     { return _width * _height; }
+    inline Format format() const { return _format; }
+    inline size_t bytes() const { return _storageBytes; }
+    inline bool outOfCore() const { return _outOfCore; }
+
+    // Bytes needed for an image of the given size, including tile padding
+    static size_t bytesFor(int width, int height, Format format);
+
+    // Tells an out-of-core image that rows [y0, y1) will not be read again,
+    // the memory and disk space of the bands fully inside are given back.
+    void discard_rows(int y0, int y1);
 
     // File stuff
-    void write_png(const char* filename) const;
-    void read_png(const char* filename);
+    bool write(const char* filename) const; //picks the format from the extension
+    bool write_png(const char* filename) const;
+    bool write_pfm(const char* filename) const; //32 bit float portable float map
+    bool write_exr(const char* filename) const; //uncompressed half float OpenEXR
+    bool read_png(const char* filename); //false if the file could not be decoded
 
 protected:
 
-    inline int index(int x, int y) const            //integer index
-    { return y * _width + x; }
-
-    inline int windex(int x, int y) const           //wrapped integer index
-    { return index(x % _width, y % _height); }
+    inline size_t index(int x, int y) const          //integer index
+    {
+        size_t tile = size_t(y >> TILE_BITS) * _tilesX + (x >> TILE_BITS);
+        size_t inTile = ((y & (TILE_SIZE - 1)) << TILE_BITS) | (x & (TILE_SIZE - 1));
+        return 3 * ((tile << (2 * TILE_BITS)) + inTile);
+    }
 
-    inline int findex(float x, float y) const       //float index
-    { return index(int(x * (_width-1)), int(y * (_height-1))); }
+    inline size_t bandBytes() const
+    { return _storageBytes / ((_height + TILE_SIZE - 1) / TILE_SIZE); }
 
     // Create a picture. Return false if failed.
     bool set_extent(int width, int height);
+    void free_storage();
 
 };
 
 
 //Inline functions
 
-inline void Image::put_pixel(int x, int y, Color c)
+inline void Image::put_pixel(int x, int y, const Color &c)
 {
-    (*this)(x, y) = c;
+    size_t i = index(x, y);
+    if (_format == FLOAT16) {
+        _half[i + 0] = floatToHalf(c.r);
+        _half[i + 1] = floatToHalf(c.g);
+        _half[i + 2] = floatToHalf(c.b);
+    } else {
+        _pixel[i + 0] = c.r;
+        _pixel[i + 1] = c.g;
+        _pixel[i + 2] = c.b;
+    }
 }
 
 inline Color Image::get_pixel(int x, int y) const
 {
-    return (*this)(x, y);
+    size_t i = index(x, y);
+    if (_format == FLOAT16)
+        return Color(halfToFloat(_half[i]), halfToFloat(_half[i + 1]), halfToFloat(_half[i + 2]));
+    return Color(_pixel[i], _pixel[i + 1], _pixel[i + 2]);
 }
 
-inline const Color& Image::operator()(int x, int y) const
+inline unsigned short floatToHalf(float f)
 {
-    return _pixel[index(x, y)];
-}
+    unsigned int bits;
+    memcpy(&bits, &f, sizeof(bits));
 
-inline Color& Image::operator()(int x, int y)
-{
-    return _pixel[index(x, y)];
-}
+    unsigned short sign = (bits >> 16) & 0x8000;
+    unsigned int mantissa = bits & 0x007fffff;
+    int exponent = int((bits >> 23) & 0xff) - 127 + 15;
 
-inline const Color& Image::colorAt(float x, float y) const
-{
-    return _pixel[findex(x, y)];
+    if (exponent >= 31) {
+        // overflow becomes infinity, NaN stays NaN
+        if (((bits >> 23) & 0xff) == 0xff && mantissa) return sign | 0x7e00;
+        return sign | 0x7c00;
+    }
+    if (exponent <= 0) {
+        // subnormal half or zero
+        if (exponent < -10) return sign;
+        mantissa |= 0x00800000;
+        int shift = 14 - exponent;
+        unsigned int half = mantissa >> shift;
+        unsigned int rest = mantissa & ((1u << shift) - 1);
+        unsigned int halfway = 1u << (shift - 1);
+        if (rest > halfway || (rest == halfway && (half & 1))) ++half;
+        return sign | half;
+    }
+
+    // round to nearest even, a carry into the exponent is intended
+    unsigned int half = (exponent << 10) | (mantissa >> 13);
+    unsigned int rest = mantissa & 0x1fff;
+    if (rest > 0x1000 || (rest == 0x1000 && (half & 1))) ++half;
+    return sign | half;
 }
 
-inline void Image::derivativeAt(float x, float y, float *dx, float *dy) const
+inline float halfToFloat(unsigned short h)
 {
-    int ix = (int)(x * (_width - 1));
-    int iy = (int)(y * (_height - 1));
-    *dx = _pixel[windex(ix,iy+1)].g - _pixel[index(ix,iy)].g;
-    *dy = _pixel[windex(ix+1,iy)].g - _pixel[index(ix,iy)].g;
+    unsigned int sign = (h & 0x8000) << 16;
+    unsigned int exponent = (h >> 10) & 0x1f;
+    unsigned int mantissa = h & 0x03ff;
+    unsigned int bits;
+
+    if (exponent == 0) {
+        if (mantissa == 0) {
+            bits = sign;
+        } else {
+            // normalize the subnormal
+            exponent = 127 - 15 + 1;
+            while (!(mantissa & 0x0400)) {
+                mantissa <<= 1;
+                --exponent;
+            }
+            bits = sign | (exponent << 23) | ((mantissa & 0x03ff) << 13);
+        }
+    } else if (exponent == 31) {
+        bits = sign | 0x7f800000 | (mantissa << 13);
+    } else {
+        bits = sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+    }
+
+    float f;
+    memcpy(&f, &bits, sizeof(f));
+    return f;
 }
 
 #endif /* end of include guard: IMAGE_H_IOLFQARK */
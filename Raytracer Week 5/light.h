@@ -19,8 +19,9 @@
 
 #include <iostream>
 #include "triple.h"
+#include "Memory.hpp"
 
-class Light
+class Light : public Memory::Counted<Memory::OBJECTS>
 {
 public:
     Light(Point pos,Color c) : position(pos), color(c)
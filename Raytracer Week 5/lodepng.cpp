@@ -1103,6 +1103,70 @@ static unsigned getHash(const unsigned char* data, size_t size, size_t pos)
   return result % HASH_NUM_VALUES;
 }
 
+/*LZ77-encode the data with zlib style hash chains: head holds the latest position of every hash and prev links every
+position of the window to the previous one with the same hash. Only the maxChainLength most recent candidates are
+compared, which bounds the work per byte. Return value is error code*/
+static unsigned encodeLZ77Chained(uivector* out, const unsigned char* in, size_t size, unsigned windowSize, unsigned maxChainLength)
+{
+  static const unsigned PREV_MASK = 32767; /*the window is at most 32768 bytes*/
+  unsigned* head = (unsigned*)malloc(HASH_NUM_VALUES * sizeof(unsigned)); /*position + 1, 0 when empty*/
+  unsigned* prev = (unsigned*)malloc((PREV_MASK + 1) * sizeof(unsigned));
+  unsigned pos, i, error = 0;
+
+  if(!head || !prev) error = 9917;
+  else
+  {
+    for(i = 0; i < HASH_NUM_VALUES; i++) head[i] = 0;
+
+    for(pos = 0; pos < size; pos++)
+    {
+      unsigned length = 0, offset = 0, chain = 0;
+      unsigned hash = getHash(in, size, pos);
+      unsigned candidate = head[hash];
+
+      /*candidates further back than the window end the chain, their prev entries may have been overwritten already*/
+      while(candidate != 0 && pos - (candidate - 1) <= windowSize && chain++ < maxChainLength)
+      {
+        unsigned backpos = candidate - 1;
+        unsigned current_length = 0;
+        while(pos + current_length < size && in[backpos + current_length] == in[pos + current_length]
+              && current_length < MAX_SUPPORTED_DEFLATE_LENGTH) current_length++;
+        if(current_length > length)
+        {
+          length = current_length;
+          offset = pos - backpos;
+          if(current_length == MAX_SUPPORTED_DEFLATE_LENGTH) break;
+        }
+        candidate = prev[backpos & PREV_MASK];
+      }
+
+      prev[pos & PREV_MASK] = head[hash];
+      head[hash] = pos + 1;
+
+      if(length < 3)
+      {
+        if(!uivector_push_back(out, in[pos])) { error = 9921; break; }
+      }
+      else
+      {
+        unsigned j;
+        addLengthDistance(out, length, offset);
+        for(j = 0; j < length - 1; j++) /*the skipped positions are still added to the chains*/
+        {
+          pos++;
+          hash = getHash(in, size, pos);
+          prev[pos & PREV_MASK] = head[hash];
+          head[hash] = pos + 1;
+        }
+      }
+    }
+  }
+
+  free(head);
+  free(prev);
+  return error;
+}
+
 /*LZ77-encode the data using a hash table technique to let it encode faster. Return value is error code*/
 static unsigned encodeLZ77(uivector* out, const unsigned char* in, size_t size, unsigned windowSize)
 {
@@ -1197,7 +1261,7 @@ static unsigned encodeLZ77(uivector* out, const unsigned char* in, size_t size,
 
 /* /////////////////////////////////////////////////////////////////////////// */
 
-static unsigned deflateNoCompression(ucvector* out, const unsigned char* data, size_t datasize)
+static unsigned deflateNoCompression(ucvector* out, const unsigned char* data, size_t datasize, unsigned final)
 {
   /*non compressed deflate block data: 1 bit BFINAL,2 bits BTYPE,(5 bits): it jumps to start of next byte, 2 bytes LEN, 2 bytes NLEN, LEN bytes literal DATA*/
   
@@ -1208,7 +1272,7 @@ static unsigned deflateNoCompression(ucvector* out, const unsigned char* data, s
     unsigned BFINAL, BTYPE, LEN, NLEN;
     unsigned char firstbyte;
     
-    BFINAL = (i == numdeflateblocks - 1);
+    BFINAL = final && (i == numdeflateblocks - 1);
     BTYPE = 0;
     
     firstbyte = (unsigned char)(BFINAL + ((BTYPE & 1) << 1) + ((BTYPE & 2) << 1));
@@ -1233,6 +1297,16 @@ static unsigned deflateNoCompression(ucvector* out, const unsigned char* data, s
   return 0;
 }
 
+/*ends a non final block with an empty stored block, which aligns the stream to a byte boundary (a zlib "sync flush")*/
+static void addSyncFlush(size_t* bp, ucvector* out)
+{
+  addBitsToStream(bp, out, 0, 3); /*BFINAL 0, BTYPE 00*/
+  ucvector_push_back(out, 0); /*the stored block header jumps to the next byte: LEN 0, NLEN 0xffff*/
+  ucvector_push_back(out, 0);
+  ucvector_push_back(out, 255);
+  ucvector_push_back(out, 255);
+}
+
 /*write the encoded data, using lit/len as well as distance codes*/
 static void writeLZ77data(size_t* bp, ucvector* out, const uivector* lz77_encoded, const HuffmanTree* codes, const HuffmanTree* codesD)
 {
@@ -1260,7 +1334,7 @@ static void writeLZ77data(size_t* bp, ucvector* out, const uivector* lz77_encode
   }
 }
 
-static unsigned deflateDynamic(ucvector* out, const unsigned char* data, size_t datasize, const LodeZlib_DeflateSettings* settings)
+static unsigned deflateDynamic(ucvector* out, const unsigned char* data, size_t datasize, const LodeZlib_DeflateSettings* settings, unsigned final)
 {
   /*
   after the BFINAL and BTYPE, the dynamic block consists out of the following:
@@ -1285,7 +1359,7 @@ static unsigned deflateDynamic(ucvector* out, const unsigned char* data, size_t
   uivector lldll; /*lit/len & dist code lenghts*/
   uivector clcls;
   
-  unsigned BFINAL = 1; /*make only one block... the first and final one*/
+  unsigned BFINAL = final; /*make only one block, the final one unless more parts follow*/
   size_t numcodes, numcodesD, i, bp = 0; /*the bit pointer*/
   unsigned HLIT, HDIST, HCLEN;
   
@@ -1304,7 +1378,8 @@ static unsigned deflateDynamic(ucvector* out, const unsigned char* data, size_t
   {
     if(settings->useLZ77)
     {
-      error = encodeLZ77(&lz77_encoded, data, datasize, settings->windowSize); /*LZ77 encoded*/
+      if(settings->maxChainLength) error = encodeLZ77Chained(&lz77_encoded, data, datasize, settings->windowSize, settings->maxChainLength);
+      else error = encodeLZ77(&lz77_encoded, data, datasize, settings->windowSize); /*LZ77 encoded*/
       if(error) break;
     }
     else
@@ -1416,6 +1491,7 @@ static unsigned deflateDynamic(ucvector* out, const unsigned char* data, size_t
     writeLZ77data(&bp, out, &lz77_encoded, &codes, &codesD);
     if(HuffmanTree_getLength(&codes, 256) == 0) { error = 64; break; } /*the length of the end code 256 must be larger than 0*/
     addHuffmanSymbol(&bp, out, HuffmanTree_getCode(&codes, 256), HuffmanTree_getLength(&codes, 256)); /*end code*/
+    if(!final) addSyncFlush(&bp, out);
     
     break; /*end of error-while*/
   }
@@ -1435,12 +1511,12 @@ static unsigned deflateDynamic(ucvector* out, const unsigned char* data, size_t
   return error;
 }
 
-static unsigned deflateFixed(ucvector* out, const unsigned char* data, size_t datasize, const LodeZlib_DeflateSettings* settings)
+static unsigned deflateFixed(ucvector* out, const unsigned char* data, size_t datasize, const LodeZlib_DeflateSettings* settings, unsigned final)
 {
   HuffmanTree codes; /*tree for literal values and length codes*/
   HuffmanTree codesD; /*tree for distance codes*/
   
-  unsigned BFINAL = 1; /*make only one block... the first and final one*/
+  unsigned BFINAL = final; /*make only one block, the final one unless more parts follow*/
   unsigned error = 0;
   size_t i, bp = 0; /*the bit pointer*/
   
@@ -1458,7 +1534,8 @@ static unsigned deflateFixed(ucvector* out, const unsigned char* data, size_t da
   {
     uivector lz77_encoded;
     uivector_init(&lz77_encoded);
-    error = encodeLZ77(&lz77_encoded, data, datasize, settings->windowSize);
+    if(settings->maxChainLength) error = encodeLZ77Chained(&lz77_encoded, data, datasize, settings->windowSize, settings->maxChainLength);
+    else error = encodeLZ77(&lz77_encoded, data, datasize, settings->windowSize);
     if(!error) writeLZ77data(&bp, out, &lz77_encoded, &codes, &codesD);
     uivector_cleanup(&lz77_encoded);
   }
@@ -1467,6 +1544,7 @@ static unsigned deflateFixed(ucvector* out, const unsigned char* data, size_t da
     for(i = 0; i < datasize; i++) addHuffmanSymbol(&bp, out, HuffmanTree_getCode(&codes, data[i]), HuffmanTree_getLength(&codes, data[i]));
   }
   if(!error) addHuffmanSymbol(&bp, out, HuffmanTree_getCode(&codes, 256), HuffmanTree_getLength(&codes, 256)); /*"end" code*/
+  if(!error && !final) addSyncFlush(&bp, out);
   
   /*cleanup*/
   HuffmanTree_cleanup(&codes);
@@ -1475,16 +1553,21 @@ static unsigned deflateFixed(ucvector* out, const unsigned char* data, size_t da
   return error;
 }
 
-unsigned LodeFlate_deflate(ucvector* out, const unsigned char* data, size_t datasize, const LodeZlib_DeflateSettings* settings)
+static unsigned deflatePart(ucvector* out, const unsigned char* data, size_t datasize, const LodeZlib_DeflateSettings* settings, unsigned final)
 {
   unsigned error = 0;
-  if(settings->btype == 0) error = deflateNoCompression(out, data, datasize);
-  else if(settings->btype == 1) error = deflateFixed(out, data, datasize, settings);
-  else if(settings->btype == 2) error = deflateDynamic(out, data, datasize, settings);
+  if(settings->btype == 0) error = deflateNoCompression(out, data, datasize, final);
+  else if(settings->btype == 1) error = deflateFixed(out, data, datasize, settings, final);
+  else if(settings->btype == 2) error = deflateDynamic(out, data, datasize, settings, final);
   else error = 61;
   return error;
 }
 
+unsigned LodeFlate_deflate(ucvector* out, const unsigned char* data, size_t datasize, const LodeZlib_DeflateSettings* settings)
+{
+  return deflatePart(out, data, datasize, settings, 1);
+}
+
 #endif /*LODEPNG_COMPILE_DECODER*/
 
 /* ////////////////////////////////////////////////////////////////////////// */
@@ -1514,6 +1597,33 @@ static unsigned update_adler32(unsigned adler, const unsigned char* data, unsign
   return (s2 << 16) | s1;
 }
 
+unsigned LodeZlib_adler32(unsigned adler, const unsigned char* data, size_t len)
+{
+  while(len > 0) /*update_adler32 takes an unsigned length*/
+  {
+    unsigned amount = len > 0x40000000 ? 0x40000000 : (unsigned)len;
+    adler = update_adler32(adler, data, amount);
+    data += amount;
+    len -= amount;
+  }
+  return adler;
+}
+
+unsigned LodeZlib_adler32Combine(unsigned adler1, unsigned adler2, size_t len2)
+{
+  /*same as continuing adler1 over the len2 bytes that produced adler2, see zlib's adler32_combine*/
+  unsigned rem = (unsigned)(len2 % 65521);
+  unsigned s1 = adler1 & 0xffff;
+  unsigned s2 = (unsigned)(((unsigned long long)rem * s1) % 65521);
+  s1 += (adler2 & 0xffff) + 65521 - 1;
+  s2 += ((adler1 >> 16) & 0xffff) + ((adler2 >> 16) & 0xffff) + 65521 - rem;
+  if(s1 >= 65521) s1 -= 65521;
+  if(s1 >= 65521) s1 -= 65521;
+  if(s2 >= 2 * 65521) s2 -= 2 * 65521;
+  if(s2 >= 65521) s2 -= 65521;
+  return (s2 << 16) | s1;
+}
+
 /*Return the adler32 of the bytes data[0..len-1]*/
 static unsigned adler32(const unsigned char* data, unsigned len)
 {
@@ -1622,6 +1732,17 @@ unsigned LodeZlib_compress(unsigned char** out, size_t* outsize, const unsigned
   return error;
 }
 
+unsigned LodeZlib_compressPart(unsigned char** out, size_t* outsize, const unsigned char* in, size_t insize, const LodeZlib_DeflateSettings* settings, unsigned final)
+{
+  ucvector outv;
+  unsigned error;
+  ucvector_init_buffer(&outv, *out, *outsize);
+  error = deflatePart(&outv, in, insize, settings, final);
+  *out = outv.data;
+  *outsize = outv.size;
+  return error;
+}
+
 #endif /*LODEPNG_COMPILE_ENCODER*/
 
 #endif /*LODEPNG_COMPILE_ZLIB*/
@@ -1635,9 +1756,10 @@ void LodeZlib_DeflateSettings_init(LodeZlib_DeflateSettings* settings)
   settings->btype = 2; /*compress with dynamic huffman tree (not in the mathematical sense, just not the predefined one)*/
   settings->useLZ77 = 1;
   settings->windowSize = 2048; /*this is a good tradeoff between speed and compression ratio*/
+  settings->maxChainLength = 0;
 }
 
-const LodeZlib_DeflateSettings LodeZlib_defaultDeflateSettings = {2, 1, 2048};
+const LodeZlib_DeflateSettings LodeZlib_defaultDeflateSettings = {2, 1, 2048, 0};
 
 #endif /*LODEPNG_COMPILE_ENCODER*/
 
@@ -3518,6 +3640,62 @@ static void filterScanline(unsigned char* out, const unsigned char* scanline, co
   }
 }
 
+/*adaptive filtering of h scanlines: independently for each row, the filter with the smallest sum is used.
+prevline is the (unfiltered) scanline above the first one, or 0 at the top of the image*/
+static unsigned filterAdaptive(unsigned char* out, const unsigned char* in, const unsigned char* prevline, size_t linebytes, size_t bytewidth, unsigned h)
+{
+  size_t sum[5];
+  ucvector attempt[5]; /*five filtering attempts, one for each filter type*/
+  size_t smallest = 0;
+  unsigned type, bestType = 0;
+  size_t x;
+  unsigned y;
+  unsigned error = 0;
+  
+  for(type = 0; type < 5; type++) ucvector_init(&attempt[type]);
+  for(type = 0; type < 5; type++)
+  {
+    if(!ucvector_resize(&attempt[type], linebytes)) { error = 9949; break; }
+  }
+  
+  if(!error)
+  {
+    for(y = 0; y < h; y++)
+    {
+      /*try the 5 filter types*/
+      for(type = 0; type < 5; type++)
+      {
+        filterScanline(attempt[type].data, &in[y * linebytes], prevline, linebytes, bytewidth, type);
+        
+        /*calculate the sum of the result*/
+        sum[type] = 0;
+        for(x = 0; x < attempt[type].size; x+=3) sum[type] += attempt[type].data[x]; /*note that not all pixels are checked to speed this up while still having probably the best choice*/
+      
+        /*check if this is smallest sum (or if type == 0 it's the first case so always store the values)*/
+        if(type == 0 || sum[type] < smallest)
+        {
+          bestType = type;
+          smallest = sum[type];
+        }
+      }
+      
+      prevline = &in[y * linebytes];
+  
+      /*now fill the out values*/
+      out[y * (linebytes + 1)] = bestType; /*the first byte of a scanline will be the filter type*/
+      for(x = 0; x < linebytes; x++) out[y * (linebytes + 1) + 1 + x] = attempt[bestType].data[x];
+    }
+  }
+  
+  for(type = 0; type < 5; type++) ucvector_cleanup(&attempt[type]);
+  return error;
+}
+
+unsigned LodePNG_filterScanlines(unsigned char* out, const unsigned char* in, const unsigned char* prevline, size_t linebytes, size_t bytewidth, unsigned h)
+{
+  return filterAdaptive(out, in, prevline, linebytes, bytewidth, h);
+}
+
 static unsigned filter(unsigned char* out, const unsigned char* in, unsigned w, unsigned h, const LodePNG_InfoColor* info)
 {
   /*
@@ -3535,7 +3713,7 @@ static unsigned filter(unsigned char* out, const unsigned char* in, unsigned w,
   size_t linebytes = (w * bpp + 7) / 8; /*the width of a scanline in bytes, not including the filter type*/
   size_t bytewidth = (bpp + 7) / 8; /*bytewidth is used for filtering, is 1 when bpp < 8, number of bytes per pixel otherwise*/
   const unsigned char* prevline = 0;
-  unsigned x, y;
+  unsigned y;
   unsigned heuristic;
   unsigned error = 0;
   
@@ -3559,47 +3737,7 @@ static unsigned filter(unsigned char* out, const unsigned char* in, unsigned w,
   }
   else if(heuristic == 1) /*adaptive filtering*/
   {
-    size_t sum[5];
-    ucvector attempt[5]; /*five filtering attempts, one for each filter type*/
-    size_t smallest = 0;
-    unsigned type, bestType = 0;
-    
-    for(type = 0; type < 5; type++) ucvector_init(&attempt[type]);
-    for(type = 0; type < 5; type++)
-    {
-      if(!ucvector_resize(&attempt[type], linebytes)) { error = 9949; break; }
-    }
-    
-    if(!error)
-    {
-      for(y = 0; y < h; y++)
-      {
-        /*try the 5 filter types*/
-        for(type = 0; type < 5; type++)
-        {
-          filterScanline(attempt[type].data, &in[y * linebytes], prevline, linebytes, bytewidth, type);
-          
-          /*calculate the sum of the result*/
-          sum[type] = 0;
-          for(x = 0; x < attempt[type].size; x+=3) sum[type] += attempt[type].data[x]; /*note that not all pixels are checked to speed this up while still having probably the best choice*/
-        
-          /*check if this is smallest sum (or if type == 0 it's the first case so always store the values)*/
-          if(type == 0 || sum[type] < smallest)
-          {
-            bestType = type;
-            smallest = sum[type];
-          }
-        }
-        
-        prevline = &in[y * linebytes];
-    
-        /*now fill the out values*/
-        out[y * (linebytes + 1)] = bestType; /*the first byte of a scanline will be the filter type*/
-        for(x = 0; x < linebytes; x++) out[y * (linebytes + 1) + 1 + x] = attempt[bestType].data[x];
-      }
-    }
-    
-    for(type = 0; type < 5; type++) ucvector_cleanup(&attempt[type]);
+    error = filterAdaptive(out, in, prevline, linebytes, bytewidth, h);
   }
   #if 0 /*deflate the scanline with a fixed tree after every filter attempt to see which one deflates best. This is slow, and _does not work as expected_: the heuristic gives smaller result!*/
   else if(heuristic == 2) /*adaptive filtering by using deflate*/
@@ -65,6 +65,7 @@ typedef struct LodeZlib_DeflateSettings /*deflate = compress*/
   unsigned btype; /*the block type for LZ*/
   unsigned useLZ77; /*whether or not to use LZ77*/
   unsigned windowSize; /*the maximum is 32768*/
+  unsigned maxChainLength; /*if not 0, LZ77 uses hash chains and compares only this many earlier positions*/
 } LodeZlib_DeflateSettings;
 
 extern const LodeZlib_DeflateSettings LodeZlib_defaultDeflateSettings;
@@ -86,7 +87,15 @@ unsigned LodeZlib_decompress(unsigned char** out, size_t* outsize, const unsigne
 /*This function reallocates the out buffer and appends the data.
 Either, *out must be NULL and *outsize must be 0, or, *out must be a valid buffer and *outsize its size in bytes.*/
 unsigned LodeZlib_compress(unsigned char** out, size_t* outsize, const unsigned char* in, size_t insize, const LodeZlib_DeflateSettings* settings);
+/*Compresses one part of a longer zlib stream, without the zlib header and Adler32 checksum. Unless final is set the
+part ends with an empty stored block, so it stops on a byte boundary and parts compressed separately (for example
+strip by strip, or on different threads) can simply be concatenated. Appends to the out buffer like the above.*/
+unsigned LodeZlib_compressPart(unsigned char** out, size_t* outsize, const unsigned char* in, size_t insize, const LodeZlib_DeflateSettings* settings, unsigned final);
 #endif /*LODEPNG_COMPILE_ENCODER*/
+/*running Adler32 checksum of a zlib stream, start with adler = 1*/
+unsigned LodeZlib_adler32(unsigned adler, const unsigned char* data, size_t len);
+/*Adler32 of two concatenated parts from the checksums of the parts, len2 is the length of the second part*/
+unsigned LodeZlib_adler32Combine(unsigned adler1, unsigned adler2, size_t len2);
 #endif /*LODEPNG_COMPILE_ZLIB*/
 
 #ifdef LODEPNG_COMPILE_PNG
@@ -95,6 +104,13 @@ unsigned LodeZlib_compress(unsigned char** out, size_t* outsize, const unsigned
 /* LodePNG                                                                    */
 /* ////////////////////////////////////////////////////////////////////////// */
 
+#ifdef LODEPNG_COMPILE_ENCODER
+/*Filters h scanlines of linebytes bytes each with the adaptive heuristic of the encoder, for writing a PNG a few rows at
+a time. out needs h * (linebytes + 1) bytes, every row gets its filter type byte. prevline is the unfiltered scanline
+above the first one, or 0 for the top of the image. bytewidth is the number of bytes per pixel.*/
+unsigned LodePNG_filterScanlines(unsigned char* out, const unsigned char* in, const unsigned char* prevline, size_t linebytes, size_t bytewidth, unsigned h);
+#endif /*LODEPNG_COMPILE_ENCODER*/
+
 /*LodePNG_chunk functions: These functions need as input a large enough amount of allocated memory.*/
 
 unsigned LodePNG_chunk_length(const unsigned char* chunk); /*get the length of the data of the chunk. Total chunk length has 12 bytes more.*/
@@ -957,6 +973,7 @@ channel, resulting in a smaller PNG image.
 *) btype: the block type for LZ77. 0 = uncompressed, 1 = fixed huffman tree, 2 = dynamic huffman tree (best compression)
 *) useLZ77: whether or not to use LZ77 for compressed block types
 *) windowSize: the window size used by the LZ77 encoder (1 - 32768)
+*) maxChainLength: how many earlier positions with the same hash LZ77 compares, 0 = no limit
 *) force_palette: if colorType is 2 or 6, you can make the encoder write a PLTE
    chunk if force_palette is true. This can used as suggested palette to convert
    to by viewers that don't support more than 256 colors (if those still exist)
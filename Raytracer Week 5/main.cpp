@@ -15,21 +15,126 @@
 //
 
 #include "raytracer.h"
+#include "Trace.hpp"
+#include "Memory.hpp"
+#include "PerfCounters.hpp"
+#include "Autotuner.hpp"
+#include "PartialImage.hpp"
+#include <cstdlib>
 
 int main(int argc, char *argv[])
 {
+    // options come before the files
+    const char *program = argv[0];
+    bool compile = false;
+    bool merge = false;
+    double tuneSeconds = 0;
+    int part = 0, parts = 0;
+    std::string traceFilename;
+    std::string memoryFilename;
+    std::string countersFilename;
+    while (argc > 1 && std::string(argv[1]).compare(0, 2, "--") == 0) {
+        std::string option = argv[1];
+        if (option == "--compile") compile = true;
+        else if (option == "--merge") merge = true;
+        else if (option == "--tiles" && argc > 2 && PartialImage::parsePart(argv[2], part, parts)) {
+            --argc;
+            ++argv;
+        }
+        else if (option == "--tune" && argc > 2 && atof(argv[2]) > 0) {
+            tuneSeconds = atof(argv[2]);
+            --argc;
+            ++argv;
+        }
+        else if (option == "--trace" && argc > 2) {
+            traceFilename = argv[2];
+            --argc;
+            ++argv;
+        }
+        else if (option == "--memory" && argc > 2) {
+            memoryFilename = argv[2];
+            --argc;
+            ++argv;
+        }
+        else if (option == "--counters" && argc > 2) {
+            countersFilename = argv[2];
+            --argc;
+            ++argv;
+        }
+        else break;
+        --argc;
+        ++argv;
+    }
+
+    // the image goes to standard output, keep it clean of messages
+    if (argc == 3 && !compile && !merge && ImageWriter::toStandardOutput(argv[2])) cout.rdbuf(cerr.rdbuf());
+    if (merge && argc > 1 && ImageWriter::toStandardOutput(argv[1])) cout.rdbuf(cerr.rdbuf());
+
     cout << "Introduction to Computer Graphics - Raytracer" << endl << endl;
-    if (argc < 2 || argc > 3) {
-        cerr << "Usage: " << argv[0] << " in-file [out-file.png]" << endl;
+    if (argc < 2 || (argc > 3 && !merge) || (argc < 3 && merge)) {
+        cerr << "Usage: " << program << " [--trace trace.json] [--memory memory.json] [--counters counters.json] in-file [out-file.png|.ppm|.pfm|.raw|.exr]" << endl;
+        cerr << "       " << program << " [--trace trace.json] [--memory memory.json] [--counters counters.json] in-file png|ppm|pfm|raw:out-file (out-file - is standard output)" << endl;
+        cerr << "       " << program << " --compile in-file.yaml [out-file.rtscene] (in-file can be rendered from out-file)" << endl;
+        cerr << "       " << program << " --tune seconds in-file (finds the fastest settings, renders of in-file use them)" << endl;
+        cerr << "       " << program << " --tiles k/N in-file [out-file.part] (renders the k-th of N bands of rows into a partial image)" << endl;
+        cerr << "       " << program << " --merge out-file part-file... (puts the partial images of all N bands together)" << endl;
+        cerr << "       --trace writes a timeline of the run, for chrome://tracing or Perfetto" << endl;
+        cerr << "       --memory writes the current and peak bytes of every kind of data" << endl;
+        cerr << "       --counters writes the hardware performance counters of the parse, render and encode phases" << endl;
         return 1;
     }
+    if (!traceFilename.empty()) Trace::start(traceFilename);
+    if (!countersFilename.empty()) PerfCounters::start(countersFilename);
 
     Raytracer raytracer;
 
+    if (merge) {
+        bool written = raytracer.mergeParts(std::vector<std::string>(argv + 2, argv + argc), argv[1]);
+        if (written) cout << "Done." << endl;
+        written = PerfCounters::finish() && written;
+        return Trace::finish() && written ? 0 : 1;
+    }
+
     if (!raytracer.readScene(argv[1])) {
         cerr << "Error: reading scene from " << argv[1] << " failed - no output generated."<< endl;
+        PerfCounters::finish();
+        Trace::finish();
         return 1;
     }
+    if (tuneSeconds > 0) {
+        bool written = Autotuner::tune(raytracer, tuneSeconds, Autotuner::sidecar(argv[1]));
+        written = PerfCounters::finish() && written;
+        return Trace::finish() && written ? 0 : 1;
+    }
+    if (compile) {
+        std::string pkgname = argc >= 3 ? argv[2] : argv[1];
+        if (argc < 3) {
+            if (pkgname.size()>=5 && pkgname.substr(pkgname.size()-5)==".yaml") {
+                pkgname = pkgname.substr(0,pkgname.size()-5);
+            }
+            pkgname += ".rtscene";
+        }
+        bool written = raytracer.writePackage(pkgname);
+        if (written) cout << "Scene written to " << pkgname << "." << endl;
+        written = PerfCounters::finish() && written;
+        return Trace::finish() && written ? 0 : 1;
+    }
+    if (parts > 0) {
+        std::string partname;
+        if (argc >= 3) {
+            partname = argv[2];
+        } else {
+            partname = argv[1];
+            if (partname.size()>=5 && partname.substr(partname.size()-5)==".yaml") {
+                partname = partname.substr(0,partname.size()-5);
+            }
+            partname += "-" + std::to_string(part) + "of" + std::to_string(parts) + ".part";
+        }
+        bool written = raytracer.renderPart(partname, part, parts, argv[1]);
+        written = (memoryFilename.empty() || Memory::writeJson(memoryFilename)) && written;
+        written = PerfCounters::finish() && written;
+        return Trace::finish() && written ? 0 : 1;
+    }
     std::string ofname;
     if (argc>=3) {
         ofname = argv[2];
@@ -40,7 +145,8 @@ int main(int argc, char *argv[])
         }
         ofname += ".png";
     }
-    raytracer.renderToFile(ofname);
-    
-    return 0;
+    bool written = raytracer.renderToFile(ofname);
+    written = (memoryFilename.empty() || Memory::writeJson(memoryFilename)) && written;
+    written = PerfCounters::finish() && written;
+    return Trace::finish() && written ? 0 : 1;
 }
@@ -13,3 +13,28 @@
 //
 
 #include "material.h"
+#include "TextureCache.hpp"
+
+Material::Material(const Material &other)
+: color(other.color), ka(other.ka), kd(other.kd), ks(other.ks), n(other.n), texture(other.texture)
+{
+    TextureCache::retain(texture);
+}
+
+Material &Material::operator=(const Material &other)
+{
+    TextureCache::retain(other.texture); //first, other may be this
+    TextureCache::release(texture);
+    color = other.color;
+    ka = other.ka;
+    kd = other.kd;
+    ks = other.ks;
+    n = other.n;
+    texture = other.texture;
+    return *this;
+}
+
+Material::~Material()
+{
+    TextureCache::release(texture);
+}
@@ -17,9 +17,10 @@
 
 #include <iostream>
 #include "triple.h"
-#include "image.h"
+#include "Texture.hpp"
+#include "Memory.hpp"
 
-class Material
+class Material : public Memory::Counted<Memory::OBJECTS>
 {
 public:
     Color color;        // base color
@@ -28,10 +29,15 @@ public:
     double ks;          // specular intensity 
     double n;           // exponent for specular highlight size
 
-    Image *texture;
+    Texture *texture;     // shared through the TextureCache, NULL if untextured
 
     Material()
     : color(Color()), ka(0), kd(0), ks(0), n(0), texture(NULL) { }
+
+    //a copy shares the texture and holds its own reference to it
+    Material(const Material &other);
+    Material &operator=(const Material &other);
+    ~Material();
 };
 
 #endif /* end of include guard: MATERIAL_H_TWMNT2EJ */
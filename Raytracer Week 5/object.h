@@ -21,16 +21,18 @@
 #include "triple.h"
 #include "hit.h"
 #include "ray.h"
+#include "Memory.hpp"
 
 //class Material;
 
-class Object {
+class Object : public Memory::Counted<Memory::OBJECTS> {
 public:
     Material *material;
 
     virtual ~Object() { }
 
-    virtual Color colorAt(const Point &hit) = 0; //returns color at specific point.
+    //returns color at specific point, footprint is the width of the ray cone there.
+    virtual Color colorAt(const Point &hit, double footprint) = 0;
     virtual Hit intersect(const Ray &ray) = 0;
     //virtual Point mappingTexture(const Ray &ray, const double &min_hit);
 };
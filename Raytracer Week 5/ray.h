@@ -25,14 +25,19 @@ class Ray
 public:
     Point O;
     Vector D;
+    double width;  // width of the ray cone at the origin
+    double spread; // growth of the cone width per unit of distance
 
-    Ray(const Point &from, const Vector &dir)
-        : O(from), D(dir)
+    Ray(const Point &from, const Vector &dir, double width = 0, double spread = 0)
+        : O(from), D(dir), width(width), spread(spread)
     { }
 
     Point at(double t) const
     { return O + t*D; }
 
+    double footprint(double t) const
+    { return width + t * spread; }
+
 };
 
 #endif /* end of include guard: RAY_H_ */
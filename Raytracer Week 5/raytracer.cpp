@@ -27,6 +27,17 @@
 #include "Mesh.hpp"
 #include "Triangle.hpp"
 #include "Cylinder.h"
+#include "TextureCache.hpp"
+#include "ScenePackage.hpp"
+#include "AssetLoader.hpp"
+#include "Trace.hpp"
+#include "PerfCounters.hpp"
+#include "Autotuner.hpp"
+#include "ImageWriter.hpp"
+#include "PartialImage.hpp"
+
+// Framebuffers at least this large are kept out of core unless the scene says otherwise
+static const size_t OUT_OF_CORE_THRESHOLD = size_t(1) << 30;
 
 // Functions to ease reading from YAML input
 void operator >> (const YAML::Node& node, Triple& t);
@@ -49,17 +60,17 @@ Triple parseTriple(const YAML::Node& node)
     return t;
 }
 
-Material* Raytracer::parseMaterial(const YAML::Node& node)
+Material* Raytracer::parseMaterial(const YAML::Node& node, std::string *texture)
 {
     Material *m = new Material();
 
     if (node.FindValue("texture")) {
-        std::string text;
-        node["texture"] >> text;
-        const char *c = text.c_str();
-
-        m->texture = new Image(c);
-    }else m->texture = NULL;
+        std::string file;
+        node["texture"] >> file;
+        if (texture) *texture = file;
+        else if (assets) assets->texture(m, file, node["texture"].GetMark().line + 1);
+        else m->texture = TextureCache::acquire(file);
+    }
 
     node["color"] >> m->color;
     node["ka"] >> m->ka;
@@ -129,7 +140,24 @@ Object* Raytracer::parseObject(const YAML::Node& node)
         float scale;
         node["scale"] >> scale;
         
-        Mesh *mesh = new Mesh(file, pos, scale, parseMaterial(node["material"]));
+        if (!assets) {
+            Mesh *mesh = new Mesh(parseMaterial(node["material"]));
+            std::string error;
+            if (!mesh->load(file, pos, scale, cout, error)) {
+                // the mesh does not own its material, the scene does once the mesh is added
+                delete mesh->material;
+                delete mesh;
+                throw YAML::ParserException(node["file"].GetMark(), "reading mesh " + file + " failed (" + error + ")");
+            }
+            return mesh;
+        }
+
+        // the mesh is loaded after its texture, its groups share it
+        std::string texture;
+        Mesh *mesh = new Mesh(parseMaterial(node["material"], &texture));
+        int line = node["file"].GetMark().line + 1;
+        if (texture.empty()) assets->mesh(mesh, file, pos, scale, line);
+        else assets->mesh(mesh, file, pos, scale, line, texture, node["material"]["texture"].GetMark().line + 1);
         return mesh;
     }
 
@@ -178,12 +206,164 @@ void Raytracer::parseGoochParameters(const YAML::Node &node) {
     scene->setGoochParameters(b, y, alpha, beta);
 }
 
+void Raytracer::parseFramebufferFormat(const YAML::Node &node)
+{
+    std::string name;
+    node >> name;
+    if (name == "float32") format = Image::FLOAT32;
+    else if (name == "float16") format = Image::FLOAT16;
+    else cerr << "Warning: unknown framebuffer format \"" << name << "\", using float32." << endl;
+}
+
+void Raytracer::parseToneMapping(const YAML::Node &node)
+{
+    std::string name;
+    if (node.FindValue("exposure")) node["exposure"] >> toneMapper.exposure;
+    if (node.FindValue("operator")) {
+        node["operator"] >> name;
+        if (!ToneMapper::parseOperator(name, toneMapper.op))
+            cerr << "Warning: unknown tone mapping operator \"" << name << "\", using clamp." << endl;
+    }
+    if (node.FindValue("transfer")) {
+        node["transfer"] >> name;
+        if (!ToneMapper::parseTransfer(name, toneMapper.transfer))
+            cerr << "Warning: unknown transfer function \"" << name << "\", using linear." << endl;
+    }
+    if (node.FindValue("dither")) node["dither"] >> toneMapper.dither;
+    if (node.FindValue("bits")) {
+        node["bits"] >> toneMapper.bits;
+        if (toneMapper.bits != 8 && toneMapper.bits != 16) {
+            cerr << "Warning: " << toneMapper.bits << " bit output is not supported, using 8 bits." << endl;
+            toneMapper.bits = 8;
+        }
+    }
+}
+
+class Raytracer::SceneHandler : public YAML::StreamHandler
+{
+public:
+    SceneHandler(Raytracer &raytracer)
+        : raytracer(raytracer), scene(raytracer.scene), hasCamera(false), hasEye(false), hasObjects(false), hasLights(false), failed(false) { }
+
+    // objects and lights are built as they are parsed, the rest is small
+    bool IsStreamed(const std::string& key)
+    {
+        return key == "Objects" || key == "Lights";
+    }
+
+    void OnValue(const std::string& key, const YAML::Node& node)
+    {
+        if (key == "RenderMode") scene->setRenderMode(node);
+        else if (key == "CostMetric") scene->setCostMetric(node);
+        else if (key == "Shadows") scene->setShadows(node);
+        else if (key == "MaxRecursionDepth") scene->setReflectionDepth(node);
+        else if (key == "SuperSampling") scene->setSupersampingFactor(node["factor"]);
+        else if (key == "FramebufferFormat") raytracer.parseFramebufferFormat(node);
+        else if (key == "OutOfCore") {
+            bool b;
+            node >> b;
+            raytracer.outOfCore = b ? 1 : 0;
+        }
+        else if (key == "Threads") scene->setThreads(node);
+        else if (key == "Sampling") scene->setSampling(node);
+        else if (key == "PngCompression") {
+            std::string name;
+            node >> name;
+            if (!PngWriter::parseLevel(name, raytracer.pngLevel))
+                cerr << "Warning: unknown PNG compression \"" << name << "\", using default." << endl;
+        }
+        else if (key == "ToneMapping") raytracer.parseToneMapping(node);
+        else if (key == "GoochParameters") raytracer.parseGoochParameters(node);
+        else if (key == "Camera") {
+            raytracer.parseCamera(node);
+            hasCamera = true;
+        }
+        else if (key == "Eye") {
+            eye = parseTriple(node);
+            hasEye = true;
+        }
+        else if (key == "Objects" || key == "Lights") {
+            // a sequence the parser could not stream, because of a tag or an anchor
+            if (node.GetType() != YAML::CT_SEQUENCE) {
+                cerr << "Error: expected a sequence of " << (key == "Objects" ? "objects." : "lights.") << endl;
+                failed = true;
+                return;
+            }
+            for (YAML::Iterator it = node.begin(); it != node.end(); ++it)
+                OnItem(key, *it);
+        }
+    }
+
+    void OnItem(const std::string& key, const YAML::Node& node)
+    {
+        if (key == "Objects") {
+            hasObjects = true;
+            Object *obj = raytracer.parseObject(node);
+            // Only add object if it is recognized
+            if (obj) {
+                scene->addObject(obj);
+            } else {
+                cerr << "Warning: found object of unknown type, ignored." << endl;
+            }
+        } else {
+            hasLights = true;
+            scene->addLight(raytracer.parseLight(node));
+        }
+    }
+
+    // the keys the scene cannot do without
+    bool finish()
+    {
+        if (!raytracer.assets->wait()) return false;
+        if (!hasCamera) {
+            if (!hasEye) {
+                cerr << "Error: expected a Camera or an Eye." << endl;
+                return false;
+            }
+            scene->setEye(eye);
+        }
+        if (!hasObjects && !failed) {
+            cerr << "Error: expected a sequence of objects." << endl;
+            return false;
+        }
+        if (!hasLights && !failed) {
+            cerr << "Error: expected a sequence of lights." << endl;
+            return false;
+        }
+        return !failed;
+    }
+
+private:
+    Raytracer &raytracer;
+    Scene *scene;
+    Triple eye;
+    bool hasCamera, hasEye, hasObjects, hasLights, failed;
+};
+
 /*
 * Read a scene from file
 */
 
 bool Raytracer::readScene(const std::string& inputFilename)
 {
+    Trace::Scope trace("readScene", inputFilename);
+    PerfCounters::Scope counters(PerfCounters::PARSE);
+
+    // A compiled scene is restored as it is, without parsing
+    if (ScenePackage::isPackage(inputFilename)) {
+        Trace::Scope trace("restorePackage");
+        package = new ScenePackage();
+        if (!package->open(inputFilename)) {
+            cerr << "Error: reading " << inputFilename << " failed (" << package->error() << ")." << endl;
+            return false;
+        }
+        package->restore(*this);
+        cout << "Scene package: " << scene->getNumObjects() << " objects read." << endl;
+        TextureCache::printStatistics();
+        Autotuner::apply(*this, Autotuner::sidecar(inputFilename));
+        return true;
+    }
+
     // Initialize a new scene
     scene = new Scene();
 
@@ -193,80 +373,217 @@ bool Raytracer::readScene(const std::string& inputFilename)
         cerr << "Error: unable to open " << inputFilename << " for reading." << endl;;
         return false;
     }
+
+    // Settings that are not in the scene keep these values
+    scene->setRenderMode("phong");
+    scene->setShadows(false);
+    scene->setReflectionDepth(0);
+    scene->setSupersampingFactor(1);
+
     try {
+        // The objects and lights are created while the file is parsed,
+        // the document as a whole is never held in memory
+        // meshes and textures are loaded meanwhile, see AssetLoader
         YAML::Parser parser(fin);
         if (parser) {
-            YAML::Node doc;
-            parser.GetNextDocument(doc);
-
-            // Find the rendermode parameter if its available
-            doc.FindValue("RenderMode") ? scene->setRenderMode(doc["RenderMode"]) : scene->setRenderMode("phong");
-            doc.FindValue("Shadows") ? scene->setShadows(doc["Shadows"]) : scene->setShadows(false);
-            doc.FindValue("MaxRecursionDepth") ? scene->setReflectionDepth(doc["MaxRecursionDepth"]) : scene->setReflectionDepth(0);
-            doc.FindValue("SuperSampling") ? scene->setSupersampingFactor(doc["SuperSampling"]["factor"]) : scene->setSupersampingFactor(1);
-
-            if (doc.FindValue("GoochParameters")) {
-                parseGoochParameters(doc["GoochParameters"]);
-            }
-
-
-            // Read scene configuration options
-            if(doc.FindValue("Camera"))
+            AssetLoader loader;
+            assets = &loader;
+            SceneHandler handler(*this);
             {
-                parseCamera(doc["Camera"]);
+                Trace::Scope trace("parseYAML");
+                parser.StreamNextDocument(handler);
             }
-            else
-            {
-                scene->setEye(parseTriple(doc["Eye"]));
-            }
-
-            // Read and parse the scene objects
-            const YAML::Node& sceneObjects = doc["Objects"];
-            if (sceneObjects.GetType() != YAML::CT_SEQUENCE) {
-                cerr << "Error: expected a sequence of objects." << endl;
+            bool finished = handler.finish();
+            assets = NULL;
+            if (!finished)
                 return false;
-            }
-            for(YAML::Iterator it=sceneObjects.begin();it!=sceneObjects.end();++it) {
-                Object *obj = parseObject(*it);
-                // Only add object if it is recognized
-                if (obj) {
-                    scene->addObject(obj);
-                } else {
-                    cerr << "Warning: found object of unknown type, ignored." << endl;
-                }
-            }
-
-            // Read and parse light definitions
-            const YAML::Node& sceneLights = doc["Lights"];
-            if (sceneObjects.GetType() != YAML::CT_SEQUENCE) {
-                cerr << "Error: expected a sequence of lights." << endl;
-                return false;
-            }
-            for(YAML::Iterator it=sceneLights.begin();it!=sceneLights.end();++it) {
-                scene->addLight(parseLight(*it));
-            }
         }
         if (parser) {
             cerr << "Warning: unexpected YAML document, ignored." << endl;
         }
     } catch(YAML::ParserException& e) {
+        assets = NULL;
         std::cerr << "Error at line " << e.mark.line + 1 << ", col " << e.mark.column + 1 << ": " << e.msg << std::endl;
         return false;
     }
 
     cout << "YAML parsing results: " << scene->getNumObjects() << " objects read." << endl;
+    TextureCache::printStatistics();
+    // settings found by ray --tune, if the scene was tuned
+    Autotuner::apply(*this, Autotuner::sidecar(inputFilename));
     return true;
 }
 
-void Raytracer::renderToFile(const std::string& outputFilename)
+bool Raytracer::renderToFile(const std::string& outputFilename)
 {
-    Image img(width, height);
+    Trace::Scope trace("renderToFile", outputFilename);
+    bool mapped = outOfCore == 1
+        || (outOfCore == -1 && Image::bytesFor(width, height, format) >= OUT_OF_CORE_THRESHOLD);
+    Image img(width, height, format, mapped);
+    if (img.outOfCore()) cout << "Keeping the " << img.bytes() << " byte framebuffer in a mapped file." << endl;
+
+    // most formats are written band by band while rendering, EXR afterwards
+    ImageWriter *writer = ImageWriter::create(outputFilename, pngLevel, toneMapper);
+
     cout << "Tracing... ";
     scene->printSettings();
-    scene->render(img);
-    cout << "Writing image to " << outputFilename << "..." << endl;
-    img.write_png(outputFilename.c_str());
-    cout << "Done." << endl;
+    bool written;
+    if (writer) {
+        cout << "Writing image to " << outputFilename << " while rendering..." << endl;
+        written = writer->begin(width, height);
+        if (written) {
+            written = scene->render(img, writer);
+            if (!written) cerr << "Error: writing " << outputFilename << " failed, render stopped." << endl;
+            written = writer->finish() && written;
+        }
+        delete writer;
+    } else {
+        scene->render(img);
+        cout << "Writing image to " << outputFilename << "..." << endl;
+        Trace::Scope trace("writeImage", outputFilename);
+        PerfCounters::Scope counters(PerfCounters::ENCODE);
+        written = img.write(outputFilename.c_str());
+    }
+
+    // the cost of every pixel goes next to the heatmap, as name-cost.raw
+    if (scene->hasCostBuffer()) {
+        if (ImageWriter::toStandardOutput(outputFilename)) {
+            cerr << "Warning: the image goes to standard output, the cost of the pixels is not written." << endl;
+        } else {
+            size_t colon = outputFilename.find(':');
+            std::string costFilename = colon != std::string::npos && colon > 1 ? outputFilename.substr(colon + 1) : outputFilename;
+            costFilename = costFilename.substr(0, costFilename.rfind('.')) + "-cost.raw";
+            written = scene->writeCostBuffer(costFilename) && written;
+        }
+    }
+    if (written) cout << "Done." << endl;
+    // while the scene and the image are still there
+    Memory::printReport(cout);
+
+    delete scene;
+    delete package;
+    scene = NULL;
+    package = NULL;
+    return written;
+}
+
+bool Raytracer::renderPart(const std::string& partFilename, int part, int parts, const std::string& sceneName)
+{
+    Trace::Scope trace("renderPart", partFilename);
+    PartialImage::Header header = PartialImage::header(width, height, part, parts, sceneName);
+    header.format = format;
+    header.outOfCore = outOfCore;
+    header.pngLevel = pngLevel;
+    header.toneOperator = toneMapper.op;
+    header.toneTransfer = toneMapper.transfer;
+    header.dither = toneMapper.dither;
+    header.bits = toneMapper.bits;
+    header.exposure = toneMapper.exposure;
+
+    // a part is a band of whole rows, small enough to keep in memory
+    Image img(width, header.y1 - header.y0, format, false);
+    cout << "Tracing rows " << header.y0 << " to " << header.y1 << ", part " << part << " of " << parts << "... ";
+    scene->printSettings();
+    bool written = header.y1 == header.y0 || scene->renderRows(img, header.y0, height);
+    if (!written) cerr << "Error: depth and cost renders are normalized over the whole image, they cannot be rendered in parts." << endl;
+
+    std::string error;
+    if (written && !PartialImage::write(partFilename, header, img, error)) {
+        cerr << "Error: writing " << partFilename << " failed (" << error << ")." << endl;
+        written = false;
+    }
+    if (written) cout << "Part written to " << partFilename << "." << endl;
 
     delete scene;
+    delete package;
+    scene = NULL;
+    package = NULL;
+    return written;
+}
+
+bool Raytracer::mergeParts(const std::vector<std::string>& partFilenames, const std::string& outputFilename)
+{
+    Trace::Scope trace("mergeParts", outputFilename);
+    std::string error;
+    std::vector<PartialImage::Header> headers(partFilenames.size());
+    for (size_t i = 0; i < partFilenames.size(); ++i) {
+        if (!PartialImage::readHeader(partFilenames[i], headers[i], error)) {
+            cerr << "Error: reading " << partFilenames[i] << " failed (" << error << ")." << endl;
+            return false;
+        }
+    }
+
+    // every part of the image exactly once
+    const PartialImage::Header &first = headers[0];
+    std::vector<int> source(first.parts, -1);
+    for (size_t i = 0; i < headers.size(); ++i) {
+        if (!PartialImage::sameImage(first, headers[i])) {
+            cerr << "Error: " << partFilenames[i] << " is a part of another image than " << partFilenames[0] << "." << endl;
+            return false;
+        }
+        int &part = source[headers[i].part - 1];
+        if (part >= 0) {
+            cerr << "Error: " << partFilenames[part] << " and " << partFilenames[i] << " are both part "
+                 << headers[i].part << " of " << first.parts << "." << endl;
+            return false;
+        }
+        part = i;
+    }
+    bool complete = true;
+    for (uint32_t p = 0; p < first.parts; ++p) {
+        if (source[p] >= 0) continue;
+        PartialImage::Header missing = PartialImage::header(first.width, first.height, p + 1, first.parts, first.scene);
+        if (missing.y0 == missing.y1) continue; // more parts than rows
+        cerr << "Error: part " << p + 1 << " of " << first.parts << " (rows " << missing.y0 << " to " << missing.y1 << ") is missing." << endl;
+        complete = false;
+    }
+    if (!complete) return false;
+
+    width = first.width;
+    height = first.height;
+    format = Image::Format(first.format);
+    outOfCore = first.outOfCore;
+    pngLevel = PngWriter::Level(first.pngLevel);
+    toneMapper.op = ToneMapper::Operator(first.toneOperator);
+    toneMapper.transfer = ToneMapper::Transfer(first.toneTransfer);
+    toneMapper.dither = first.dither;
+    toneMapper.bits = first.bits;
+    toneMapper.exposure = first.exposure;
+
+    bool mapped = outOfCore == 1
+        || (outOfCore == -1 && Image::bytesFor(width, height, format) >= OUT_OF_CORE_THRESHOLD);
+    Image img(width, height, format, mapped);
+    cout << "Merging " << partFilenames.size() << " parts of " << first.scene << "..." << endl;
+    for (size_t i = 0; i < partFilenames.size(); ++i) {
+        if (!PartialImage::readRows(partFilenames[i], headers[i], img, error)) {
+            cerr << "Error: reading " << partFilenames[i] << " failed (" << error << ")." << endl;
+            return false;
+        }
+    }
+
+    // as renderToFile writes it, band by band
+    cout << "Writing image to " << outputFilename << "..." << endl;
+    PerfCounters::Scope counters(PerfCounters::ENCODE);
+    ImageWriter *writer = ImageWriter::create(outputFilename, pngLevel, toneMapper);
+    if (!writer) return img.write(outputFilename.c_str());
+    bool written = writer->begin(width, height);
+    int bands = (height + Image::TILE_SIZE - 1) / Image::TILE_SIZE;
+    for (int band = 0; band < bands && written; ++band) {
+        int y0 = (writer->bottomUp() ? bands - 1 - band : band) * Image::TILE_SIZE;
+        written = writer->write_rows(img, y0, std::min(y0 + int(Image::TILE_SIZE), height));
+    }
+    if (!written) cerr << "Error: writing " << outputFilename << " failed." << endl;
+    written = writer->finish() && written;
+    delete writer;
+    return written;
+}
+
+bool Raytracer::writePackage(const std::string& packageFilename)
+{
+    std::string error;
+    if (!ScenePackage::write(packageFilename, *this, error)) {
+        cerr << "Error: writing " << packageFilename << " failed (" << error << ")." << endl;
+        return false;
+    }
+    return true;
 }
@@ -17,30 +17,57 @@
 
 #include <iostream>
 #include <string>
+#include <vector>
 #include "triple.h"
 #include "light.h"
 #include "scene.h"
+#include "image.h"
 #include "yaml/yaml.h"
 
+class ScenePackage;
+class AssetLoader;
+
 class Raytracer {
 private:
+    friend class ScenePackage; //reads and restores the settings
+    friend class Autotuner; //tries settings on the scene
     int width;
     int height;
+    Image::Format format; //precision of the render target
+    int outOfCore; //keep the render target in a mapped file: 1 yes, 0 no, -1 when it is large
+    PngWriter::Level pngLevel; //compression of PNG output
+    ToneMapper toneMapper; //conversion to 8 or 16 bit output
     Scene *scene;
+    ScenePackage *package; //the scene was restored from it, it holds the textures
+    AssetLoader *assets; //loads meshes and textures while a scene is read, NULL otherwise
 
     // Couple of private functions for parsing YAML nodes
-    Material* parseMaterial(const YAML::Node& node);
+    // texture, if given, receives the texture file instead of it being loaded
+    Material* parseMaterial(const YAML::Node& node, std::string *texture = NULL);
     Object* parseObject(const YAML::Node& node);
     Light* parseLight(const YAML::Node& node);
     void parseCamera(const YAML::Node &node);
     void parseSize(const YAML::Node &node);
     void parseGoochParameters(const YAML::Node &node);
+    void parseFramebufferFormat(const YAML::Node &node);
+    void parseToneMapping(const YAML::Node &node);
+
+    // Receives the scene from the YAML parser one value or object at a time
+    class SceneHandler;
 
 public:
-    Raytracer() : width(400), height(400), scene(NULL) { }
+    Raytracer() : width(400), height(400), format(Image::FLOAT32), outOfCore(-1), pngLevel(PngWriter::DEFAULT), scene(NULL), package(NULL), assets(NULL) { }
 
     bool readScene(const std::string& inputFilename);
-    void renderToFile(const std::string& outputFilename);
+    //renders the scene read and writes the image, false if writing it failed
+    bool renderToFile(const std::string& outputFilename);
+    //renders part of parts of the image into a partial image, see PartialImage.
+    //sceneName goes into it, the parts of an image have to come from the same scene.
+    bool renderPart(const std::string& partFilename, int part, int parts, const std::string& sceneName);
+    //puts partial images together and writes the image, no scene has to be read
+    bool mergeParts(const std::vector<std::string>& partFilenames, const std::string& outputFilename);
+    //writes the scene read into a scene package, see ScenePackage
+    bool writePackage(const std::string& packageFilename);
 };
 
 #endif /* end of include guard: RAYTRACER_H_6GQO67WK */
@@ -16,7 +16,17 @@
 
 #include "scene.h"
 #include "material.h"
+#include "TraceCounters.hpp"
+#include "Trace.hpp"
+#include "PerfCounters.hpp"
+#include "Sampler.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <iostream>
+#include <stdio.h>
+
+thread_local TraceCounters TraceCounters::current;
 
 void Scene::finalizeDepthRender(Image &img)
 {
@@ -24,7 +34,7 @@ void Scene::finalizeDepthRender(Image &img)
     {
         for(int x = 0; x < img.width(); ++x)
         {
-            double distance = img(x, y).r;
+            double distance = depthBuffer[y * img.width() + x];
             if(distance == 0) continue;
 
             double diff = distMax - distMin;
@@ -37,13 +47,83 @@ void Scene::finalizeDepthRender(Image &img)
     }
 }
 
+void Scene::costPixel(int width, int x, int y)
+{
+    TraceCounters before = TraceCounters::current;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    renderPixel(x, y);
+    double nanoseconds = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+    float *cost = &costBuffer[4 * (size_t(y) * width + x)];
+    cost[TESTS] = TraceCounters::current.tests - before.tests;
+    cost[STEPS] = TraceCounters::current.steps - before.steps;
+    cost[RAYS] = TraceCounters::current.rays - before.rays;
+    cost[TIME] = nanoseconds;
+}
+
+void Scene::finalizeCostRender(Image &img)
+{
+    //the scale ends at the 99th percentile, a few outliers would leave the rest dark
+    size_t pixels = costBuffer.size() / 4;
+    std::vector<float> values(pixels);
+    double total[4] = {0, 0, 0, 0};
+    for(size_t i = 0; i < pixels; ++i)
+    {
+        values[i] = costBuffer[4 * i + costMetric];
+        for(int m = 0; m < 4; ++m) total[m] += costBuffer[4 * i + m];
+    }
+    size_t rank = std::min(pixels - 1, pixels * 99 / 100);
+    std::nth_element(values.begin(), values.begin() + rank, values.end());
+    double scale = values[rank] > 0 ? values[rank] : 1;
+
+    for(int y = 0; y < img.height(); ++y)
+        for(int x = 0; x < img.width(); ++x)
+            img.put_pixel(x, y, heatColor(costBuffer[4 * (size_t(y) * img.width() + x) + costMetric] / scale));
+
+    const char *names[4] = {"intersection tests", "traversal steps", "rays", "ns"};
+    std::cout << "Cost per pixel (mean):";
+    for(int m = 0; m < 4; ++m) std::cout << " " << total[m] / pixels << " " << names[m] << (m < 3 ? "," : ".\n");
+    std::cout << "Heatmap of " << names[costMetric] << ", white at " << scale << " (99th percentile)." << std::endl;
+}
+
+Color Scene::heatColor(double value)
+{
+    static const Color stops[5] = {Color(0, 0, 0), Color(0.1, 0.1, 0.8), Color(0.9, 0.1, 0.1), Color(1, 0.9, 0), Color(1, 1, 1)};
+    value = std::max(0.0, std::min(1.0, value)) * 4;
+    int stop = std::min(3, int(value));
+    double f = value - stop;
+    return stops[stop] * (1 - f) + stops[stop + 1] * f;
+}
+
+bool Scene::writeCostBuffer(const std::string &filename)
+{
+    FILE *file = fopen(filename.c_str(), "wb");
+    if(!file)
+    {
+        std::cerr << "Error: unable to open " << filename << " for writing." << std::endl;
+        return false;
+    }
+    bool written = fwrite(&costBuffer[0], sizeof(float), costBuffer.size(), file) == costBuffer.size();
+    written = fclose(file) == 0 && written;
+    if(!written) std::cerr << "Error: writing " << filename << " failed." << std::endl;
+    else std::cout << "Writing cost of every pixel (tests, steps, rays, ns as floats) to " << filename << "..." << std::endl;
+    FloatBuffer().swap(costBuffer);
+    return written;
+}
+
+void Scene::putPixel(Image &img, int x, int y, const Color &color)
+{
+    if(renderMode == ZBUFFER) depthBuffer[y * img.width() + x] = color.r;
+    else img.put_pixel(x, y, color);
+}
+
 Color Scene::depthColor(double distance)
 {
     //store distance in Color.r,
     //the color will be finalized to a greyscale when the depthrender is finalized.
-    this->distMin = std::min(distance, distMin);
-    this->distMax = std::max(distance, distMax);
-
+    double low = distMin, high = distMax;
+    while(distance < low && !distMin.compare_exchange_weak(low, distance)) { }
+    while(distance > high && !distMax.compare_exchange_weak(high, distance)) { }
     return Color(distance);
 }
 
@@ -56,12 +136,13 @@ Color Scene::normalColor(const Vector &N)
     return (N + 1).normalized();
 }
 
-Color Scene::phongColor(Material *material, const Point &hit, const Vector &N, const Vector &V, Object *obj, size_t reflects)
+Color Scene::phongColor(Material *material, const Point &hit, const Vector &N, const Vector &V, Object *obj, size_t reflects, double footprint, double spread)
 {
     Color color;
+    Color base = obj->colorAt(hit, footprint);
 
     //ambient part
-    color += obj->colorAt(hit) * material->ka;
+    color += base * material->ka;
 
     //for all lights.
     for(size_t i = 0; i < lights.size(); ++i)
@@ -72,14 +153,15 @@ Color Scene::phongColor(Material *material, const Point &hit, const Vector &N, c
         if(shadows && collide(Ray(lights[i]->position, -L)).object != obj) continue;
 
         //diffuse part
-        color += max(0.0, L.dot(N)) * obj->colorAt(hit) * lights[i]->color * material->kd;
+        color += max(0.0, L.dot(N)) * base * lights[i]->color * material->kd;
 
         //specular part
         color += pow(max(0.0, R.dot(V)), material->n) * lights[i]->color * material->ks;
     }
 
     Vector R = (-V - 2 * -V.dot(N) * N);
-    if(reflects != 0) color += trace(Ray(hit, R), reflects - 1) * material->ks;
+    //the reflected cone starts as wide as the footprint (flat mirror approximation)
+    if(reflects != 0) color += trace(Ray(hit, R, footprint, spread), reflects - 1) * material->ks;
 
     color.clamp();
     return color;
@@ -120,16 +202,22 @@ Color Scene::goochColor(Material *material, const Point &hit, const Vector &N, c
 Scene::Scene()
 {
     renderMode = PHONG;
+    costMetric = TIME;
 
     camera = false;
     shadows = false;
     depthOfField = false;
 
     supersampling = 0;
+    sampling = GRID;
     reflectionDepth = 0;
     width = height = 400;
     apertureRadius = 0;
     apertureSamples = 0;
+    threads = ThreadPool::defaultThreads();
+    tileWidth = Image::TILE_SIZE;
+    viewScale = 1;
+    deadline = std::chrono::steady_clock::time_point::max();
 }
 
 Scene::~Scene()
@@ -148,6 +236,8 @@ Scene::~Scene()
 
 Hit Scene::collide(const Ray &ray)
 {
+    TraceCounters::current.rays += 1;
+    TraceCounters::current.tests += objects.size();
     Hit min_hit = Hit(std::numeric_limits<double>::infinity(),Vector(), NULL);
     for (unsigned int i = 0; i < objects.size(); ++i) {
         Hit hit(objects[i]->intersect(ray));
@@ -175,7 +265,8 @@ Color Scene::trace(const Ray &ray, size_t reflects)
     switch(renderMode)
     {
         case PHONG:
-            color = phongColor(material, hit, N, V, min_hit.object, reflects);
+        case COST:
+            color = phongColor(material, hit, N, V, min_hit.object, reflects, ray.footprint(min_hit.t), ray.spread);
             break;
         case ZBUFFER:
             color = depthColor(min_hit.t);
@@ -191,97 +282,193 @@ Color Scene::trace(const Ray &ray, size_t reflects)
     return color;
 }
 
-void Scene::render(Image &img)
+void Scene::setupView(int w, int h)
 {
-    this->distMin = std::numeric_limits<double>::infinity();
-    this->distMax = 0;
-
     //setup View
-    Vector G, A, B, H(1, 0, 0), V(0, 1, 0);
-    Point origin(0, 0, 0);
-
-    int w = img.width();
-    int h = img.height();
-    double pixelSize = 1;
-
+    Vector G, B;
+    viewA = Vector();
+    viewH = Vector(viewScale, 0, 0);
+    viewV = Vector(0, viewScale, 0);
+    viewOrigin = Point(0, 0, 0);
+    viewHeight = h;
+    pixelSize = 1;
 
     if (camera) {
         pixelSize = up.length();
         G = (center - eye).normalized();
-        A = (G.cross(up)).normalized();
-        B = (A.cross(G)).normalized();
+        viewA = (G.cross(up)).normalized();
+        B = (viewA.cross(G)).normalized();
 
         //new basic unit vector
-        H = pixelSize * A;
-        V = pixelSize * B;
+        viewH = pixelSize * viewScale * viewA;
+        viewV = pixelSize * viewScale * B;
 
-        origin = center - (w/2)*(H) - (h/2)*(V);
+        viewOrigin = center - (w/2)*(viewH) - (h/2)*(viewV);
     }
+}
 
-    for (int y = 0; y < h; y++) {
-        //uncomment line below for progress indication for long renders.
-        //std::cout << "working on line " << y << "/" << h << std::endl;
-        for (int x = 0; x < w; x++) {
+Point Scene::subpixel(const Point &corner, const Vector &offsetH, const Vector &offsetV, int x, int y, size_t sample)
+{
+    if(sampling == GRID) return corner + offsetH / 2 + offsetV / 2;
+    //the camera ray is bounce 0
+    return corner + Sampler::uniform(x, y, sample, 0, 0) * offsetH + Sampler::uniform(x, y, sample, 0, 1) * offsetV;
+}
 
-            //anti - aliasing
-            Vector offsetH = H / supersampling;
-            Vector offsetV = V / supersampling;
-            Color averageColor(0.0, 0.0, 0.0);
-            Point pixel = origin + x * H + (h - pixelSize - y) * V;
+Color Scene::renderPixel(int x, int y)
+{
+    //anti - aliasing
+    Vector offsetH = viewH / supersampling;
+    Vector offsetV = viewV / supersampling;
+    Color averageColor(0.0, 0.0, 0.0);
+    Point pixel = viewOrigin + x * viewH + (viewHeight - pixelSize - y) * viewV;
 
-            if(depthOfField)
-            {
-                double c = apertureRadius / (up.length() * sqrt(apertureSamples));
-
-                for(size_t dof = 0; dof < apertureSamples; ++dof)
-                {
-                    double r = c * sqrt(dof);
-                    double theta = dof * GOLDEN_ANGLE;
-                    Vector dofeye = eye;
-
-                    dofeye = dofeye + (r * A * cos(theta)); //y displacement
-                    dofeye = dofeye + (r * up * sin(theta)); //x displacement
-
-                    //loop through points in one pixel
-                    for(size_t i = 0; i < supersampling; i++) {
-                        for(size_t j = 0; j < supersampling; j++) {
-                            Point des = pixel + i * offsetH + j * offsetV;
-                            des = des + offsetH / 2 + offsetV / 2;
-                            Ray ray(dofeye, (des-dofeye).normalized());
-                            Color col = trace(ray, reflectionDepth);
-                            averageColor += col;
-                        }
-                    }
-                }
+    //angle subtended by one (sub)sample, used to filter textures.
+    double spread = offsetH.length() / (pixel - eye).length();
 
-                //get average color
-                averageColor /= (supersampling * supersampling) * apertureSamples;
-                img(x,y) = averageColor;
-            }
-            else
+    if(depthOfField)
+    {
+        double c = apertureRadius / (up.length() * sqrt(apertureSamples));
+
+        for(size_t dof = 0; dof < apertureSamples; ++dof)
+        {
+            double r = c * sqrt(dof);
+            double theta = dof * GOLDEN_ANGLE;
+            if(sampling == JITTERED)
             {
-                //loop through points in one pixel
-                for(size_t i = 0; i < supersampling; i++) {
-                    for(size_t j = 0; j < supersampling; j++) {
-                        Point des = pixel + i * offsetH + j * offsetV;
-                        des = des + offsetH / 2 + offsetV / 2;
-                        Ray ray(eye, (des-eye).normalized());
-                        Color col = trace(ray, reflectionDepth);
-                        averageColor += col;
-                    }
+                //the spiral turned and its points moved out by a random amount per pixel
+                r = c * sqrt(dof + Sampler::uniform(x, y, dof, 0, 2));
+                theta += 2 * M_PI * Sampler::uniform(x, y, dof, 0, 3);
+            }
+            Vector dofeye = eye;
+
+            dofeye = dofeye + (r * viewA * cos(theta)); //y displacement
+            dofeye = dofeye + (r * up * sin(theta)); //x displacement
+
+            //loop through points in one pixel
+            for(size_t i = 0; i < supersampling; i++) {
+                for(size_t j = 0; j < supersampling; j++) {
+                    Point des = pixel + i * offsetH + j * offsetV;
+                    des = subpixel(des, offsetH, offsetV, x, y, (dof * supersampling + i) * supersampling + j);
+                    Ray ray(dofeye, (des-dofeye).normalized(), 0, spread);
+                    Color col = trace(ray, reflectionDepth);
+                    averageColor += col;
                 }
+            }
+        }
 
-                //get average color
-                averageColor /= (supersampling * supersampling);
-                img(x,y) = averageColor;
+        //get average color
+        averageColor /= (supersampling * supersampling) * apertureSamples;
+    }
+    else
+    {
+        //loop through points in one pixel
+        for(size_t i = 0; i < supersampling; i++) {
+            for(size_t j = 0; j < supersampling; j++) {
+                Point des = pixel + i * offsetH + j * offsetV;
+                des = subpixel(des, offsetH, offsetV, x, y, i * supersampling + j);
+                Ray ray(eye, (des-eye).normalized(), 0, spread);
+                Color col = trace(ray, reflectionDepth);
+                averageColor += col;
             }
         }
+
+        //get average color
+        averageColor /= (supersampling * supersampling);
+    }
+    return averageColor;
+}
+
+void Scene::renderTile(Image &img, int x0, int y0, int x1, int y1, int firstRow)
+{
+    Trace::Scope trace("tile", x0, y0);
+    PerfCounters::Scope counters(PerfCounters::RENDER);
+    for (int y = y0; y < y1; y++) {
+        for (int x = x0; x < x1; x++) {
+            if (renderMode == COST) costPixel(img.width(), x, y);
+            else putPixel(img, x, y - firstRow, renderPixel(x, y));
+        }
+    }
+}
+
+bool Scene::render(Image &img, ImageWriter *writer)
+{
+    Trace::Scope trace("render");
+    int w = img.width();
+    int h = img.height();
+    int tile = Image::TILE_SIZE;
+
+    if(renderMode == ZBUFFER)
+    {
+        depthBuffer.assign(w * h, 0.0f);
+        distMin = std::numeric_limits<double>::infinity();
+        distMax = 0;
+    }
+    if(renderMode == COST) costBuffer.assign(4 * size_t(w) * h, 0.0f);
+    //these are normalized at the end, they cannot be written band by band
+    bool normalized = renderMode == ZBUFFER || renderMode == COST;
+    setupView(w, h);
+    ThreadPool pool(threads > 1 ? threads : 0);
+    std::atomic<bool> skipped(false); //a tile started after the deadline
+
+    //render band by band (a row of tiles), finished bands can be written
+    //out right away except for depth and cost renders.
+    //writers that store the image bottom to top get the bottom band first.
+    bool bottomUp = writer && writer->bottomUp();
+    int bands = (h + tile - 1) / tile;
+    for (int band = 0; band < bands; ++band) {
+        int y0 = (bottomUp ? bands - 1 - band : band) * tile;
+        int y1 = std::min(y0 + tile, h);
+        //uncomment line below for progress indication for long renders.
+        //std::cout << "working on line " << y0 << "/" << h << std::endl;
+        for (int x0 = 0; x0 < w; x0 += tileWidth) {
+            int x1 = std::min(x0 + int(tileWidth), w);
+            pool.add([this, &img, &skipped, x0, y0, x1, y1]() {
+                if(std::chrono::steady_clock::now() < deadline) renderTile(img, x0, y0, x1, y1);
+                else skipped = true;
+            });
+        }
+        pool.wait();
+        if(skipped) return false;
+
+        if(writer && !normalized)
+        {
+            //stop when the output is gone, a closed pipe for example
+            Trace::Scope trace("writeRows", 0, y0);
+            PerfCounters::Scope counters(PerfCounters::ENCODE);
+            if(!writer->write_rows(img, y0, y1)) return false;
+            img.discard_rows(y0, y1);
+        }
     }
 
     if(renderMode == ZBUFFER)
     {
         finalizeDepthRender(img);
+        FloatBuffer().swap(depthBuffer);
+    }
+    if(renderMode == COST) finalizeCostRender(img); //the buffer is kept for writeCostBuffer
+    if(writer && normalized) return writer->write_rows(img, 0, h);
+    return true;
+}
+
+bool Scene::renderRows(Image &img, int firstRow, int h)
+{
+    Trace::Scope trace("renderRows", 0, firstRow);
+    //these are normalized over the whole image
+    if(renderMode == ZBUFFER || renderMode == COST) return false;
+    int w = img.width();
+    int endRow = firstRow + img.height();
+    setupView(w, h);
+    ThreadPool pool(threads > 1 ? threads : 0);
+
+    for (int y0 = firstRow; y0 < endRow; y0 += Image::TILE_SIZE) {
+        int y1 = std::min(y0 + int(Image::TILE_SIZE), endRow);
+        for (int x0 = 0; x0 < w; x0 += tileWidth) {
+            int x1 = std::min(x0 + int(tileWidth), w);
+            pool.add([this, &img, x0, y0, x1, y1, firstRow]() { renderTile(img, x0, y0, x1, y1, firstRow); });
+        }
     }
+    pool.wait();
+    return true;
 }
 
 void Scene::addObject(Object *o)
@@ -336,6 +523,16 @@ void Scene::setViewsize(int x, int y)
     height = y;
 }
 
+void Scene::setThreads(int n)
+{
+    threads = n < 1 ? 1 : n;
+}
+
+void Scene::setTileWidth(int w)
+{
+    tileWidth = w < 1 ? 1 : w;
+}
+
 void Scene::setGoochParameters(double b, double y, double alpha, double beta) {
     bGooch = b;
     yGooch = y;
@@ -349,12 +546,16 @@ void Scene::printSettings()
     std::cout << "    Lights: " << lights.size() << ".\n";
     std::cout << "    Shadows: " << (shadows ? "true" : "false") << ".\n";
     std::cout << "    Supersampling: " << supersampling << ".\n";
+    std::cout << "    Sampling: " << (sampling == JITTERED ? "jittered" : "grid") << ".\n";
     std::cout << "    Reflection depth: " << reflectionDepth << ".\n";
+    std::cout << "    Threads: " << threads << ".\n";
+    std::cout << "    Tile width: " << tileWidth << ".\n";
     std::cout << "    Image dimensions: [" << width << ", " << height << "].\n";
     std::cout << "    Rendermode: ";
     if(renderMode == PHONG) std::cout << "Phong shading.\n";
     else if(renderMode == ZBUFFER) std::cout << "Depth render.\n";
     else if(renderMode == NORMAL) std::cout << "Normals.\n";
+    else if(renderMode == COST) std::cout << "Cost heatmap.\n";
     else std::cout << "Unknown.\n";
 
     std::cout << "    Looking model: ";
@@ -384,9 +585,34 @@ void Scene::setRenderMode(std::string name)
     else if(name == "zbuffer") renderMode = ZBUFFER;
     else if(name == "normal") renderMode = NORMAL;
     else if(name == "gooch") renderMode = GOOCH;
+    else if(name == "cost") renderMode = COST;
     else
     {
         std::cout << "Did not recognize rendermode \"" << name << "\", defaulting to phong" << std::endl;
         renderMode = PHONG;
     }
 }
+
+void Scene::setSampling(std::string name)
+{
+    if(name == "grid") sampling = GRID;
+    else if(name == "jittered") sampling = JITTERED;
+    else
+    {
+        std::cout << "Did not recognize sampling \"" << name << "\", defaulting to grid" << std::endl;
+        sampling = GRID;
+    }
+}
+
+void Scene::setCostMetric(std::string name)
+{
+    if(name == "tests") costMetric = TESTS;
+    else if(name == "steps") costMetric = STEPS;
+    else if(name == "rays") costMetric = RAYS;
+    else if(name == "time") costMetric = TIME;
+    else
+    {
+        std::cout << "Did not recognize cost metric \"" << name << "\", defaulting to time" << std::endl;
+        costMetric = TIME;
+    }
+}
@@ -18,6 +18,8 @@
 #define SCENE_H_KNBLQLP6
 
 #include "scene.h"
+#include <atomic>
+#include <chrono>
 #include <vector>
 #include <limits>
 #include <string>
@@ -26,20 +28,44 @@
 #include "light.h"
 #include "object.h"
 #include "image.h"
+#include "ImageWriter.hpp"
+#include "ThreadPool.hpp"
 #include "material.h"
+#include "Memory.hpp"
 
 #define GOLDEN_ANGLE (180*(3-sqrt(5)))
 
 class Scene
 {
 private:
+    friend class ScenePackage; //reads and restores the settings
+    friend class KernelBenchmark; //benchmarks/kernels times phongColor
+    friend class Autotuner; //renders trial passes and tries settings
 
     enum RenderMode
     {
         PHONG,
         ZBUFFER,
         NORMAL,
-        GOOCH
+        GOOCH,
+        COST    //phong shading, but an image of the work each pixel took
+    };
+
+    //where the samples of a pixel go: the centers of a grid of sub pixels and
+    //a fixed spiral on the lens, or random points in them (see Sampler)
+    enum Sampling
+    {
+        GRID,
+        JITTERED
+    };
+
+    //what a cost render shows, the order of the values in costBuffer
+    enum CostMetric
+    {
+        TESTS,
+        STEPS,
+        RAYS,
+        TIME
     };
 
     std::vector<Object*> objects;
@@ -51,8 +77,13 @@ private:
     size_t height;
 
 
-    double distMin;
-    double distMax;
+    //the range of the distances traced, updated by every thread of a depth render
+    std::atomic<double> distMin;
+    std::atomic<double> distMax;
+    typedef std::vector<float, Memory::Allocator<float, Memory::FRAMEBUFFER> > FloatBuffer;
+    FloatBuffer depthBuffer; //raw distances, the image may be too coarse to hold them.
+    FloatBuffer costBuffer; //tests, steps, rays and nanoseconds of every pixel
+    CostMetric costMetric;
 
     double bGooch;
     double yGooch;
@@ -64,18 +95,45 @@ private:
     bool depthOfField;
     RenderMode renderMode;
     size_t supersampling;
+    Sampling sampling;
     size_t reflectionDepth;
     size_t apertureRadius;
     size_t apertureSamples;
+    size_t threads; //tiles of a band are rendered in parallel
+    size_t tileWidth; //pixels, the tiles are a band high
+
+    //view setup of the current render, see setupView
+    Point viewOrigin;
+    Vector viewH;   //one pixel to the right
+    Vector viewV;   //one pixel up
+    Vector viewA;   //camera right axis
+    double pixelSize;
+    int viewHeight;
+    double viewScale; //pixels of the scene per pixel of the image, more than 1 for trial renders
+    std::chrono::steady_clock::time_point deadline; //renders stop at it, trial renders have one
+
+    void setupView(int w, int h);
+    Color renderPixel(int x, int y);
+    //the point of the sample-th sub pixel whose corner is corner
+    Point subpixel(const Point &corner, const Vector &offsetH, const Vector &offsetV, int x, int y, size_t sample);
+    //img holds the rows from firstRow on
+    void renderTile(Image &img, int x0, int y0, int x1, int y1, int firstRow = 0);
 
     //colors according to the distance from camera.
     void finalizeDepthRender(Image &img); //finalizes rendering (depth needs min and max).
     Color depthColor(double distance); //
+    void putPixel(Image &img, int x, int y, const Color &color);
+
+    //renders a pixel and records what it cost. finalizes by coloring
+    //the pixels by their cost relative to the most expensive ones.
+    void costPixel(int width, int x, int y);
+    void finalizeCostRender(Image &img);
+    Color heatColor(double value); //0 black, 1 white, through blue, red and yellow
 
     //colors the colors based on vector-normal
     Color normalColor(const Vector &N);
     //colors using the phong lighting model
-    Color phongColor(Material *material, const Point &hit, const Vector &N, const Vector &V, Object *obj, size_t reflects);
+    Color phongColor(Material *material, const Point &hit, const Vector &N, const Vector &V, Object *obj, size_t reflects, double footprint, double spread);
     Color goochColor(Material *material, const Point &hit, const Vector &N, const Vector &V, Object *obj, size_t reflects);
 
 public:
@@ -85,7 +143,12 @@ public:
 
     Hit collide(const Ray &ray);
     Color trace(const Ray &ray, size_t reflects = 0);
-    void render(Image &img);
+    //renders into img, bands of rows are handed to the writer as soon as they are done.
+    //false if the writer failed or tiles were skipped at the deadline.
+    bool render(Image &img, ImageWriter *writer = NULL);
+    //renders rows firstRow to firstRow + img.height() of an image h rows high into img,
+    //for a part of an image (see PartialImage). false for depth and cost renders.
+    bool renderRows(Image &img, int firstRow, int h);
 
     void addObject(Object *o);
     void addLight(Light *l);
@@ -96,12 +159,21 @@ public:
     void setShadows(bool s);
     void setReflectionDepth(int d);
     void setSupersampingFactor(int f);
+    void setSampling(std::string name);
     void setDepthOfField(int radius, int samples);
     void setGoochParameters(double b, double y, double alpha, double beta);
+    void setThreads(int n);
+    void setTileWidth(int w);
+    void setCostMetric(std::string name);
     unsigned int getNumObjects() { return objects.size(); }
     unsigned int getNumLights() { return lights.size(); }
 
     void printSettings(); //outputs scene settings.
+
+    //after a cost render: writes the cost of every pixel as 4 floats (tests,
+    //steps, rays, nanoseconds), rows top to bottom, without a header.
+    bool hasCostBuffer() const { return !costBuffer.empty(); }
+    bool writeCostBuffer(const std::string &filename);
 };
 
 #endif /* end of include guard: SCENE_H_KNBLQLP6 */
@@ -84,7 +84,7 @@ Hit Sphere::intersect(const Ray &ray)
     return Hit(t,N, this);
 }
 
-Color Sphere::colorAt(const Point &hit)
+Color Sphere::colorAt(const Point &hit, double footprint)
 {
     if(material->texture == NULL) return material->color;
 
@@ -107,5 +107,7 @@ Color Sphere::colorAt(const Point &hit)
     double uu = phi / (2 * PI);
     double vv = theta / PI;
 
-    return material->texture->colorAt(uu, vv);
+    //the texture spans the circumference horizontally and half of it vertically.
+    double du = footprint / (2 * PI * r);
+    return material->texture->sample(uu, vv, du, 2 * du);
 }
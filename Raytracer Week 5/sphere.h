@@ -30,7 +30,7 @@ public:
         { }
 
     virtual Hit intersect(const Ray &ray);
-    virtual Color colorAt(const Point &point);
+    virtual Color colorAt(const Point &point, double footprint);
 
     const Point position;
     const double r;
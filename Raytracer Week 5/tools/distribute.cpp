@@ -0,0 +1,178 @@
+/*
+    Tool created for the course Computer graphics (2016 - 2017).
+    Renders a scene with several ray processes on this machine: the image
+    is cut into bands of rows (parts), a number of worker processes are
+    started and every worker that is done gets the next part, so fast
+    and slow parts even out. The partial images are put together with
+    ray --merge into the same image a render in one process gives.
+
+    The scene is compiled into a scene package first, so the workers map
+    it instead of each parsing the YAML file and loading its meshes and
+    textures. A part whose worker fails is handed out once more.
+
+    usage: distribute [options] scene.yaml out-file
+        --workers N         worker processes (the number of cores)
+        --tiles T           parts (4 per worker)
+        --ray program       the raytracer (./ray)
+        --keep              keep the package and the parts in out-file.parts
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <fcntl.h>
+#include <iostream>
+#include <map>
+#include <string>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+#include "../ScenePackage.hpp"
+#include "../ThreadPool.hpp"
+
+//starts program with the arguments, its standard output goes nowhere
+static pid_t launch(const std::vector<std::string> &args)
+{
+    pid_t pid = fork();
+    if(pid == 0)
+    {
+        int null = open("/dev/null", O_WRONLY);
+        if(null >= 0) dup2(null, STDOUT_FILENO);
+        std::vector<char*> argv;
+        for(size_t i = 0; i < args.size(); ++i) argv.push_back(const_cast<char*>(args[i].c_str()));
+        argv.push_back(NULL);
+        execv(argv[0], &argv[0]);
+        std::cerr << "Error: unable to run " << args[0] << "." << std::endl;
+        _exit(127);
+    }
+    return pid;
+}
+
+static bool succeeded(int status)
+{
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+static bool run(const std::vector<std::string> &args)
+{
+    int status = 0;
+    pid_t pid = launch(args);
+    return pid > 0 && waitpid(pid, &status, 0) == pid && succeeded(status);
+}
+
+int main(int argc, char *argv[])
+{
+    int workers = ThreadPool::defaultThreads(), tiles = 0;
+    bool keep = false;
+    std::string ray = "./ray";
+    std::vector<std::string> files;
+    for(int i = 1; i < argc; ++i)
+    {
+        std::string option = argv[i];
+        bool value = i + 1 < argc;
+        if(option == "--keep") keep = true;
+        else if(option == "--workers" && value) workers = std::max(1, atoi(argv[++i]));
+        else if(option == "--tiles" && value) tiles = std::max(1, atoi(argv[++i]));
+        else if(option == "--ray" && value) ray = argv[++i];
+        else if(option.compare(0, 2, "--") == 0)
+        {
+            std::cerr << "Error: unknown option " << option << "." << std::endl;
+            return 1;
+        }
+        else files.push_back(option);
+    }
+    if(files.size() != 2)
+    {
+        std::cerr << "usage: " << argv[0] << " [--workers N] [--tiles T] [--ray program] [--keep] scene.yaml out-file" << std::endl;
+        return 1;
+    }
+    if(tiles == 0) tiles = 4 * workers;
+    std::string scene = files[0], output = files[1], directory = output + ".parts";
+    mkdir(directory.c_str(), 0777);
+    auto start = std::chrono::steady_clock::now();
+
+    std::string package = scene;
+    if(!ScenePackage::isPackage(scene))
+    {
+        package = directory + "/scene.rtscene";
+        std::vector<std::string> compile = {ray, "--compile", scene, package};
+        if(!run(compile))
+        {
+            std::cerr << "Error: compiling " << scene << " failed." << std::endl;
+            return 1;
+        }
+    }
+
+    std::vector<std::string> parts;
+    std::deque<int> queue;
+    for(int t = 1; t <= tiles; ++t)
+    {
+        parts.push_back(directory + "/" + std::to_string(t) + ".part");
+        queue.push_back(t);
+    }
+
+    //hand out the parts as the workers finish
+    std::map<pid_t, int> running;
+    std::vector<int> attempts(tiles + 1, 0);
+    bool failed = false;
+    while(!running.empty() || (!queue.empty() && !failed))
+    {
+        while(int(running.size()) < workers && !queue.empty() && !failed)
+        {
+            int t = queue.front();
+            queue.pop_front();
+            ++attempts[t];
+            std::vector<std::string> args = {ray, "--tiles", std::to_string(t) + "/" + std::to_string(tiles), package, parts[t - 1]};
+            pid_t pid = launch(args);
+            if(pid < 0)
+            {
+                std::cerr << "Error: unable to start a worker." << std::endl;
+                failed = true;
+            }
+            else running[pid] = t;
+        }
+        if(running.empty()) break;
+
+        int status = 0;
+        pid_t pid = wait(&status);
+        if(pid < 0) break;
+        std::map<pid_t, int>::iterator done = running.find(pid);
+        if(done == running.end()) continue;
+        int t = done->second;
+        running.erase(done);
+        if(succeeded(status)) continue;
+        if(attempts[t] < 2)
+        {
+            std::cerr << "Warning: the worker of part " << t << " failed, trying again." << std::endl;
+            queue.push_back(t);
+        }
+        else
+        {
+            std::cerr << "Error: part " << t << " failed twice." << std::endl;
+            failed = true;
+        }
+    }
+    double rendered = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::vector<std::string> merge = {ray, "--merge", output};
+    merge.insert(merge.end(), parts.begin(), parts.end());
+    if(failed || !run(merge))
+    {
+        std::cerr << "Error: " << (failed ? "rendering" : "merging") << " the parts failed, they are in " << directory << "." << std::endl;
+        return 1;
+    }
+    double total = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if(!keep)
+    {
+        for(size_t i = 0; i < parts.size(); ++i) remove(parts[i].c_str());
+        if(package != scene) remove(package.c_str());
+        rmdir(directory.c_str());
+    }
+    std::cout << "Rendered " << tiles << " parts on " << workers << " workers in " << rendered
+              << " s, merged into " << output << " in " << total - rendered << " s." << std::endl;
+    return 0;
+}
@@ -0,0 +1,55 @@
+/*
+    Tool created for the course Computer graphics (2016 - 2017).
+    Compiles an OBJ model (and its MTL files) into a binary mesh file:
+    welded, unitized, with smooth normals, interleaved vertices and
+    triangle clusters, which the raytracer (a mesh object with the
+    compiled file) and the OpenGL viewer map into memory as it is.
+
+    usage: meshc model.obj [model.mesh] [triangles per cluster]
+*/
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include "../Mesh.hpp"
+#include "../MeshFile.hpp"
+#include "../ObjReader.hpp"
+
+int main(int argc, char *argv[])
+{
+    if(argc < 2)
+    {
+        std::cerr << "usage: " << argv[0] << " model.obj [model.mesh] [triangles per cluster]" << std::endl;
+        return 1;
+    }
+    std::string input = argv[1];
+    std::string output = input.substr(0, input.rfind('.')) + ".mesh";
+    if(argc > 2) output = argv[2];
+    int clusterSize = argc > 3 ? atoi(argv[3]) : Mesh::CLUSTER_SIZE;
+    if(clusterSize < 1)
+    {
+        std::cerr << "Error: a cluster has at least one triangle." << std::endl;
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    ObjReader reader;
+    GLMmodel *model = reader.read(input);
+    if(!model)
+    {
+        std::cerr << "Error: reading " << input << " failed (" << reader.error() << ")." << std::endl;
+        return 1;
+    }
+    Mesh::prepare(model);
+
+    std::string error;
+    bool written = MeshFile::write(output, model, clusterSize, error);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if(!written) std::cerr << "Error: writing " << output << " failed (" << error << ")." << std::endl;
+    else std::cout << input << " -> " << output << ": " << model->numtriangles << " triangles, "
+                   << model->numvertices << " vertices, " << model->numnormals << " normals in "
+                   << seconds << " s" << std::endl;
+    glmDelete(model);
+    return written ? 0 : 1;
+}
@@ -0,0 +1,324 @@
+/*
+    Tool created for the course Computer graphics (2016 - 2017).
+    A regression gate: renders every scene and checks the image against a
+    golden image, the render time against a time budget and the peak
+    memory (ray --memory) against a memory budget. Fails, with a report of
+    what went wrong, when any scene is off.
+
+    Images may differ by rounding: they match while the 99.9th percentile
+    of the per pixel CIELAB difference (delta E 1976) stays within the
+    tolerance, 2.3 being about the smallest difference people notice.
+    Times are the median of several renders. A budget holds the median and
+    the spread of the renders it was recorded from, and a render may be
+    slower by the time tolerance or three times the larger of the two
+    spreads, whichever is more, plus a floor of a few milliseconds that
+    keeps scenes of well under 100 ms from failing on scheduling noise.
+    Times are in seconds on the machine that recorded them, so record the
+    budgets on the machine that runs the gate.
+
+    Record the golden images and budgets on a tree that is known to be
+    right with --record, then run without it after every change.
+
+    usage: regress [options] [scene.yaml ...]   (all scenes in scenefiles without any)
+        --record                    store the images and budgets instead of checking
+        --ray program               the raytracer (./ray)
+        --golden directory          golden images (scenefiles/golden)
+        --budgets file              budgets (scenefiles/budgets.txt)
+        --tolerance dE              image tolerance (2.3)
+        --time-tolerance fraction   allowed slowdown (0.25)
+        --time-floor seconds        allowed slowdown of any scene (0.05)
+        --memory-tolerance fraction allowed memory growth (0.05)
+        --runs N                    renders per scene, the median counts (5 with --record, 3 without)
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <glob.h>
+#include <sys/stat.h>
+#include "../lodepng.h"
+
+static const char *OUTPUT = "generated/regress";
+
+struct Budget
+{
+    double time;        //seconds, the median of the renders
+    double spread;      //(slowest - fastest) / median of the renders
+    double peak;        //bytes
+};
+
+static double seconds(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+//the median and the relative spread of the times of the runs of a scene
+static void summarize(std::vector<double> times, double &median, double &spread)
+{
+    std::sort(times.begin(), times.end());
+    size_t n = times.size();
+    median = n % 2 ? times[n / 2] : (times[n / 2 - 1] + times[n / 2]) / 2;
+    spread = median > 0 ? (times.back() - times.front()) / median : 0;
+}
+
+//CIELAB of an sRGB color with a D65 white
+static void lab(const unsigned char *rgb, double out[3])
+{
+    double linear[3];
+    for(int i = 0; i < 3; ++i)
+    {
+        double c = rgb[i] / 255.0;
+        linear[i] = c <= 0.04045 ? c / 12.92 : pow((c + 0.055) / 1.055, 2.4);
+    }
+    double xyz[3] = {
+        (0.4124 * linear[0] + 0.3576 * linear[1] + 0.1805 * linear[2]) / 0.95047,
+        0.2126 * linear[0] + 0.7152 * linear[1] + 0.0722 * linear[2],
+        (0.0193 * linear[0] + 0.1192 * linear[1] + 0.9505 * linear[2]) / 1.08883
+    };
+    for(int i = 0; i < 3; ++i)
+        xyz[i] = xyz[i] > 216.0 / 24389 ? cbrt(xyz[i]) : (24389.0 / 27 * xyz[i] + 16) / 116;
+    out[0] = 116 * xyz[1] - 16;
+    out[1] = 500 * (xyz[0] - xyz[1]);
+    out[2] = 200 * (xyz[1] - xyz[2]);
+}
+
+//the 99.9th percentile delta E of two PNG files, false and a reason in error if they cannot be compared
+static bool compare(const std::string &file, const std::string &golden, double &difference, std::string &error)
+{
+    std::vector<unsigned char> a, b;
+    unsigned aw, ah, bw, bh;
+    if(LodePNG::decode(a, aw, ah, file)) { error = "unable to read " + file; return false; }
+    if(LodePNG::decode(b, bw, bh, golden)) { error = "no golden image " + golden + ", record it with --record"; return false; }
+    if(aw != bw || ah != bh)
+    {
+        std::ostringstream message;
+        message << "the image is " << aw << "x" << ah << ", the golden image " << bw << "x" << bh;
+        error = message.str();
+        return false;
+    }
+
+    std::vector<double> differences(size_t(aw) * ah);
+    for(size_t i = 0; i < differences.size(); ++i)
+    {
+        double p[3], q[3];
+        lab(&a[4 * i], p);
+        lab(&b[4 * i], q);
+        differences[i] = sqrt((p[0] - q[0]) * (p[0] - q[0]) + (p[1] - q[1]) * (p[1] - q[1]) + (p[2] - q[2]) * (p[2] - q[2]));
+    }
+    size_t index = std::min(differences.size() - 1, size_t(0.999 * differences.size()));
+    std::nth_element(differences.begin(), differences.begin() + index, differences.end());
+    difference = differences.empty() ? 0 : differences[index];
+    return true;
+}
+
+//the total peak of a ray --memory report
+static bool peakMemory(const std::string &file, double &peak)
+{
+    std::ifstream in(file.c_str());
+    std::stringstream text;
+    text << in.rdbuf();
+    std::string json = text.str();
+    size_t total = json.find("\"total\"");
+    size_t key = total == std::string::npos ? total : json.find("\"peak\":", total);
+    if(key == std::string::npos) return false;
+    peak = atof(json.c_str() + key + 7);
+    return true;
+}
+
+static bool readBudgets(const std::string &file, std::map<std::string, Budget> &budgets)
+{
+    std::ifstream in(file.c_str());
+    if(!in) return false;
+    std::string line;
+    while(std::getline(in, line))
+    {
+        if(line.empty() || line[0] == '#') continue;
+        std::istringstream fields(line);
+        std::string name;
+        Budget budget;
+        if(fields >> name >> budget.time >> budget.spread >> budget.peak) budgets[name] = budget;
+    }
+    return !budgets.empty();
+}
+
+static bool copyFile(const std::string &from, const std::string &to)
+{
+    std::ifstream in(from.c_str(), std::ios::binary);
+    std::ofstream out(to.c_str(), std::ios::binary);
+    out << in.rdbuf();
+    return in && out;
+}
+
+static std::string shellQuoted(const std::string &s)
+{
+    std::string result = "'";
+    for(size_t i = 0; i < s.size(); ++i)
+        result += s[i] == '\'' ? std::string("'\\''") : std::string(1, s[i]);
+    return result + "'";
+}
+
+static std::string sceneName(const std::string &file)
+{
+    size_t slash = file.rfind('/');
+    std::string name = slash == std::string::npos ? file : file.substr(slash + 1);
+    return name.substr(0, name.rfind('.'));
+}
+
+int main(int argc, char *argv[])
+{
+    bool record = false;
+    std::string ray = "./ray", goldenDirectory = "scenefiles/golden", budgetFile = "scenefiles/budgets.txt";
+    double tolerance = 2.3, timeTolerance = 0.25, timeFloor = 0.05, memoryTolerance = 0.05;
+    int runs = 0;
+    std::vector<std::string> scenes;
+    for(int i = 1; i < argc; ++i)
+    {
+        std::string option = argv[i];
+        bool value = i + 1 < argc;
+        if(option == "--record") record = true;
+        else if(option == "--ray" && value) ray = argv[++i];
+        else if(option == "--golden" && value) goldenDirectory = argv[++i];
+        else if(option == "--budgets" && value) budgetFile = argv[++i];
+        else if(option == "--tolerance" && value) tolerance = atof(argv[++i]);
+        else if(option == "--time-tolerance" && value) timeTolerance = atof(argv[++i]);
+        else if(option == "--time-floor" && value) timeFloor = atof(argv[++i]);
+        else if(option == "--memory-tolerance" && value) memoryTolerance = atof(argv[++i]);
+        else if(option == "--runs" && value) runs = std::max(1, atoi(argv[++i]));
+        else if(option.compare(0, 2, "--") == 0)
+        {
+            std::cerr << "Error: unknown option " << option << "." << std::endl;
+            return 1;
+        }
+        else scenes.push_back(option);
+    }
+    if(runs == 0) runs = record ? 5 : 3;
+    if(scenes.empty())
+    {
+        glob_t found;
+        if(glob("scenefiles/*.yaml", 0, NULL, &found) == 0)
+            scenes.assign(found.gl_pathv, found.gl_pathv + found.gl_pathc);
+        globfree(&found);
+    }
+    if(scenes.empty())
+    {
+        std::cerr << "Error: no scenes to render." << std::endl;
+        return 1;
+    }
+
+    mkdir("generated", 0777);
+    mkdir(OUTPUT, 0777);
+    if(record) mkdir(goldenDirectory.c_str(), 0777);
+
+    std::map<std::string, Budget> budgets;
+    if(!record && !readBudgets(budgetFile, budgets))
+        std::cerr << "Warning: no budgets in " << budgetFile << ", only the images are checked." << std::endl;
+    std::cout << std::fixed << std::setprecision(3);
+
+    std::ofstream budgetOut;
+    if(record)
+    {
+        budgetOut.open(budgetFile.c_str());
+        budgetOut << std::fixed << std::setprecision(6) << "# budgets recorded by tools/regress --record, " << runs << " renders per scene\n"
+                  << "# scene, median render time in seconds, (slowest - fastest) / median, peak bytes\n";
+    }
+
+    std::vector<std::string> failures;
+    for(size_t s = 0; s < scenes.size(); ++s)
+    {
+        std::string name = sceneName(scenes[s]);
+        std::string image = std::string(OUTPUT) + "/" + name + ".png";
+        std::string memory = std::string(OUTPUT) + "/" + name + ".json";
+        std::string log = std::string(OUTPUT) + "/" + name + ".log";
+        std::string golden = goldenDirectory + "/" + name + ".png";
+        std::string command = shellQuoted(ray) + " --memory " + shellQuoted(memory) + " " + shellQuoted(scenes[s]) + " "
+                            + shellQuoted(image) + " > " + shellQuoted(log) + " 2>&1";
+
+        std::vector<double> times;
+        bool rendered = true;
+        for(int r = 0; r < runs && rendered; ++r)
+        {
+            auto start = std::chrono::steady_clock::now();
+            rendered = system(command.c_str()) == 0;
+            times.push_back(seconds(start));
+        }
+        double time, spread;
+        summarize(times, time, spread);
+        double peak = 0;
+        if(rendered) rendered = peakMemory(memory, peak);
+
+        std::cout << name << ": ";
+        if(!rendered)
+        {
+            std::cout << "FAILED, the render failed, see " << log << ".\n";
+            failures.push_back(name + " (render)");
+            continue;
+        }
+
+        if(record)
+        {
+            bool stored = copyFile(image, golden);
+            budgetOut << name << " " << time << " " << spread << " " << (unsigned long long)peak << "\n";
+            std::cout << (stored ? "recorded" : "FAILED to store the golden image") << ", "
+                      << time << " s (spread " << 100 * spread << "%), " << (unsigned long long)peak << " bytes.\n";
+            if(!stored) failures.push_back(name + " (golden image)");
+            continue;
+        }
+
+        std::vector<std::string> problems;
+        double difference;
+        std::string error;
+        if(!compare(image, golden, difference, error)) problems.push_back(error);
+        else
+        {
+            std::cout << "image dE " << difference << " of " << tolerance;
+            if(difference > tolerance) problems.push_back("the image differs from " + golden);
+        }
+
+        std::map<std::string, Budget>::const_iterator budget = budgets.find(name);
+        if(budget == budgets.end()) std::cout << ", no budget";
+        else
+        {
+            //the tolerance, or the noise the renders showed if that is more
+            double noise = 3 * std::max(spread, budget->second.spread);
+            double allowedTime = budget->second.time * (1 + std::max(timeTolerance, noise)) + timeFloor;
+            double allowedPeak = budget->second.peak * (1 + memoryTolerance);
+            std::cout << ", time " << time << " s of " << allowedTime << " s, memory " << (unsigned long long)peak << " of " << (unsigned long long)allowedPeak << " bytes";
+            if(time > allowedTime) problems.push_back("the render is too slow");
+            if(peak > allowedPeak) problems.push_back("the render uses too much memory");
+        }
+
+        if(problems.empty()) std::cout << ", ok.\n";
+        else
+        {
+            std::cout << ", FAILED:\n";
+            for(size_t p = 0; p < problems.size(); ++p) std::cout << "    " << problems[p] << "\n";
+            failures.push_back(name);
+        }
+    }
+
+    if(record)
+    {
+        budgetOut.close();
+        if(!budgetOut)
+        {
+            std::cerr << "Error: writing " << budgetFile << " failed." << std::endl;
+            return 1;
+        }
+        std::cout << "Golden images stored in " << goldenDirectory << ", budgets in " << budgetFile << ".\n";
+    }
+
+    std::cout << scenes.size() << " scenes, " << failures.size() << " failed";
+    for(size_t f = 0; f < failures.size(); ++f) std::cout << (f ? ", " : ": ") << failures[f];
+    std::cout << "." << std::endl;
+    return failures.empty() ? 0 : 1;
+}
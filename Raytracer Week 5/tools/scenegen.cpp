@@ -0,0 +1,228 @@
+/*
+    Tool created for the course Computer graphics (2016 - 2017).
+    Writes scene files of any size for scalability tests: random spheres,
+    cylinders and disks in a box in front of the camera, a grid of mesh
+    instances facing the camera, lights on a ring above the scene, and the
+    requested size, supersampling, depth of field and reflection depth.
+    The same options and seed always give the same file.
+
+    usage: scenegen [options] [scene.yaml]   (standard output without a file)
+        --spheres N  --cylinders N  --disks N   random objects (default 100 spheres)
+        --meshes N   --mesh file.obj            N instances of the mesh (objects/cat.obj)
+        --lights L                              lights (1)
+        --size WxH                              image size (400x400)
+        --supersampling F                       samples per pixel side (1)
+        --sampling grid|jittered                sample positions in a pixel and on the lens (grid)
+        --dof radius samples                    depth of field (off)
+        --reflections D                         reflection depth (0)
+        --shadows                               cast shadows
+        --mode phong|normal|zbuffer|gooch       render mode (phong)
+        --threads T                             render threads (all cores)
+        --seed S                                random seed (1)
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include "../Random.hpp"
+
+
+struct Options
+{
+    int spheres, cylinders, disks, meshes, lights;
+    std::string mesh;
+    int width, height;
+    int supersampling;
+    std::string sampling;
+    int apertureRadius, apertureSamples;
+    int reflections;
+    bool shadows;
+    std::string mode;
+    int threads;
+    unsigned long long seed;
+    std::string output;
+
+    Options() : spheres(-1), cylinders(0), disks(0), meshes(0), lights(1), mesh("objects/cat.obj"),
+        width(400), height(400), supersampling(1), sampling("grid"), apertureRadius(0), apertureSamples(0),
+        reflections(0), shadows(false), mode("phong"), threads(0), seed(1) { }
+};
+
+static void usage(const char *program)
+{
+    std::cerr << "usage: " << program << " [--spheres N] [--cylinders N] [--disks N] [--meshes N] [--mesh file.obj]\n"
+              << "       [--lights L] [--size WxH] [--supersampling F] [--sampling grid|jittered]\n"
+              << "       [--dof radius samples] [--reflections D] [--shadows] [--mode phong|normal|zbuffer|gooch]\n"
+              << "       [--threads T] [--seed S] [scene.yaml]" << std::endl;
+}
+
+//false if the arguments are not understood
+static bool parseOptions(int argc, char *argv[], Options &o)
+{
+    for(int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if(arg == "--shadows") o.shadows = true;
+        else if(arg == "--spheres" && hasValue) o.spheres = atoi(argv[++i]);
+        else if(arg == "--cylinders" && hasValue) o.cylinders = atoi(argv[++i]);
+        else if(arg == "--disks" && hasValue) o.disks = atoi(argv[++i]);
+        else if(arg == "--meshes" && hasValue) o.meshes = atoi(argv[++i]);
+        else if(arg == "--mesh" && hasValue) o.mesh = argv[++i];
+        else if(arg == "--lights" && hasValue) o.lights = atoi(argv[++i]);
+        else if(arg == "--size" && hasValue)
+        {
+            if(sscanf(argv[++i], "%dx%d", &o.width, &o.height) != 2) return false;
+        }
+        else if(arg == "--supersampling" && hasValue) o.supersampling = atoi(argv[++i]);
+        else if(arg == "--sampling" && hasValue) o.sampling = argv[++i];
+        else if(arg == "--dof" && i + 2 < argc)
+        {
+            o.apertureRadius = atoi(argv[++i]);
+            o.apertureSamples = atoi(argv[++i]);
+        }
+        else if(arg == "--reflections" && hasValue) o.reflections = atoi(argv[++i]);
+        else if(arg == "--mode" && hasValue) o.mode = argv[++i];
+        else if(arg == "--threads" && hasValue) o.threads = atoi(argv[++i]);
+        else if(arg == "--seed" && hasValue) o.seed = strtoull(argv[++i], NULL, 10);
+        else if(arg.size() > 2 && arg.compare(0, 2, "--") == 0) return false;
+        else if(o.output.empty()) o.output = arg;
+        else return false;
+    }
+    if(o.spheres < 0) o.spheres = o.cylinders + o.disks + o.meshes > 0 ? 0 : 100;
+    return o.spheres >= 0 && o.cylinders >= 0 && o.disks >= 0 && o.meshes >= 0 && o.lights >= 1
+        && o.width > 0 && o.height > 0 && o.supersampling >= 1 && o.reflections >= 0
+        && (o.sampling == "grid" || o.sampling == "jittered");
+}
+
+//draws count numbers in order, function arguments are evaluated in any order
+static void draw(Random &random, double *values, int count)
+{
+    for(int i = 0; i < count; ++i)
+        values[i] = random.uniform();
+}
+
+static void material(std::ostream &out, Random &random)
+{
+    double r[6];
+    draw(random, r, 6);
+    char line[256];
+    snprintf(line, sizeof(line), "  material:\n    color: [%.3f,%.3f,%.3f]\n    ka: 0.2\n    kd: %.2f\n    ks: %.2f\n    n: %d\n",
+             0.1 + 0.9 * r[0], 0.1 + 0.9 * r[1], 0.1 + 0.9 * r[2], 0.4 + 0.4 * r[3], 0.2 + 0.6 * r[4], 4 << int(6 * r[5]));
+    out << line;
+}
+
+//objects fill a box of SIZE in front of the camera, smaller as there are more
+static const double SIZE = 400;
+
+static void writeScene(std::ostream &out, const Options &o)
+{
+    Random random(o.seed);
+    char line[512];
+
+    out << "---\n# generated by tools/scenegen (seed " << o.seed << ")\n\n";
+    out << "RenderMode: \"" << o.mode << "\"\n";
+    out << "Shadows: " << (o.shadows ? "true" : "false") << "\n";
+    out << "MaxRecursionDepth: " << o.reflections << "\n";
+    out << "SuperSampling:\n  factor: " << o.supersampling << "\n";
+    if(o.sampling != "grid") out << "Sampling: \"" << o.sampling << "\"\n";
+    if(o.threads > 0) out << "Threads: " << o.threads << "\n";
+
+    //the length of up is the size of a pixel, the box fills the view at any resolution
+    snprintf(line, sizeof(line), "\nCamera:\n    eye: [200,200,1000]\n    center: [200,200,0]\n    up: [0,%g,0]\n"
+             "    viewSize: [%d,%d]\n", SIZE / std::min(o.width, o.height), o.width, o.height);
+    out << line;
+    if(o.apertureSamples > 0)
+        out << "    apertureRadius: " << o.apertureRadius << "\n    apertureSamples: " << o.apertureSamples << "\n";
+
+    //a ring above and in front of the scene, the light split between them
+    out << "\nLights:\n";
+    for(int i = 0; i < o.lights; ++i)
+    {
+        double angle = 2 * M_PI * i / o.lights;
+        double intensity = std::min(1.0, 1.5 / o.lights);
+        snprintf(line, sizeof(line), "- position: [%.1f,%.1f,%.1f]\n  color: [%.3f,%.3f,%.3f]\n",
+                 200 + 800 * cos(angle), 600 + 200 * sin(angle), 1500.0, intensity, intensity, intensity);
+        out << line;
+    }
+
+    //the objects take about the same share of the box whatever their number
+    int count = o.spheres + o.cylinders + o.disks;
+    double scale = count > 0 ? SIZE / (4 * cbrt(double(count))) : 0;
+
+    out << "\nObjects:\n";
+    double r[9];
+    for(int i = 0; i < o.spheres; ++i)
+    {
+        draw(random, r, 4);
+        snprintf(line, sizeof(line), "- type: sphere\n  position: [%.3f,%.3f,%.3f]\n  radius: %.3f\n",
+                 SIZE * r[0], SIZE * r[1], -SIZE * r[2], scale * (0.5 + r[3]));
+        out << line;
+        material(out, random);
+    }
+    for(int i = 0; i < o.cylinders; ++i)
+    {
+        draw(random, r, 8);
+        snprintf(line, sizeof(line), "- type: cylinder\n  position: [%.3f,%.3f,%.3f]\n  direction: [%.3f,%.3f,%.3f]\n"
+                 "  radius: %.3f\n  length: %.3f\n",
+                 SIZE * r[0], SIZE * r[1], -SIZE * r[2], 2 * r[3] - 1, 2 * r[4] - 1, 2 * r[5] - 1,
+                 scale * (0.2 + 0.4 * r[6]), scale * (1 + 2 * r[7]));
+        out << line;
+        material(out, random);
+    }
+    for(int i = 0; i < o.disks; ++i)
+    {
+        draw(random, r, 6);
+        snprintf(line, sizeof(line), "- type: disk\n  position: [%.3f,%.3f,%.3f]\n  normal: [%.3f,%.3f,%.3f]\n  radius: %.3f\n",
+                 SIZE * r[0], SIZE * r[1], -SIZE * r[2], r[3] - 0.5, r[4] - 0.5, 1.0, scale * (0.5 + r[5]));
+        out << line;
+        material(out, random);
+    }
+
+    //a square grid facing the camera in the middle of the box
+    int columns = int(ceil(sqrt(double(o.meshes))));
+    double spacing = columns > 0 ? SIZE / columns : 0;
+    for(int i = 0; i < o.meshes; ++i)
+    {
+        snprintf(line, sizeof(line), "- type: mesh\n  file: \"%s\"\n  position: [%.3f,%.3f,%.3f]\n  scale: %.3f\n",
+                 o.mesh.c_str(), (i % columns + 0.5) * spacing, SIZE - (i / columns + 0.5) * spacing, -SIZE / 2, spacing * 0.45);
+        out << line;
+        material(out, random);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    Options options;
+    if(!parseOptions(argc, argv, options))
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    if(options.output.empty() || options.output == "-")
+    {
+        writeScene(std::cout, options);
+        return std::cout ? 0 : 1;
+    }
+
+    std::ofstream file(options.output.c_str());
+    if(!file)
+    {
+        std::cerr << "Error: unable to create " << options.output << "." << std::endl;
+        return 1;
+    }
+    writeScene(file, options);
+    file.close();
+    if(!file)
+    {
+        std::cerr << "Error: writing " << options.output << " failed." << std::endl;
+        return 1;
+    }
+    std::cerr << options.output << ": " << options.spheres << " spheres, " << options.cylinders << " cylinders, "
+              << options.disks << " disks, " << options.meshes << " meshes, " << options.lights << " lights" << std::endl;
+    return 0;
+}
@@ -9,6 +9,7 @@
 #include "parserstate.h"
 #include "exceptions.h"
 #include "ltnode.h"
+#include "../Memory.hpp"
 
 namespace YAML
 {
@@ -20,7 +21,7 @@ namespace YAML
 	class Map;
 	class Emitter;
 
-	class Content
+	class Content: public ::Memory::Counted< ::Memory::YAML>
 	{
 	public:
 		Content();
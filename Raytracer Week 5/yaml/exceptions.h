@@ -58,6 +58,7 @@ namespace YAML
 		const std::string INVALID_ANCHOR         = "invalid anchor";
 		const std::string INVALID_ALIAS          = "invalid alias";
 		const std::string EXPECTED_KEY_TOKEN     = "expected key token";
+		const std::string STREAM_ROOT            = "only a map can be streamed";
 		const std::string EXPECTED_VALUE_TOKEN   = "expected value token";
 		const std::string UNEXPECTED_KEY_TOKEN   = "unexpected key token";
 		const std::string UNEXPECTED_VALUE_TOKEN = "unexpected value token";
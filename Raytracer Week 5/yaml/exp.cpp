@@ -7,6 +7,50 @@ namespace YAML
 {
 	namespace Exp
 	{
+		// CharClassTable
+		// . Fills the character class table once, before anything is scanned.
+		struct CharClassTable
+		{
+			unsigned char classes[256];
+
+			CharClassTable() {
+				const std::string indicators = ",[]{}#&*!|>\'\"%@`";
+				for(int i=0;i<256;i++) {
+					char ch = static_cast<char>(i);
+					unsigned char& c = classes[i];
+					c = 0;
+					if(ch == ' ' || ch == '\t')
+						c |= BLANK;
+					if(ch == '\n' || ch == '\r')
+						c |= BREAK;
+					if(indicators.find(ch) != std::string::npos)
+						c |= INDICATOR;
+					if(c & (BLANK | BREAK) || ch == Stream::eof())
+						continue;
+					c |= COMMENT_TEXT;
+
+					// scalar text: printable characters and UTF-8 sequences, but never
+					// what could end the scalar (for plain ones ':' and, after a blank, '#')
+					// or start an escape
+					bool printable = (i >= 0x21 && i < 0x7F) || i >= 0x80;
+					if(!printable)
+						continue;
+					if(ch != ':' && ch != '#') {
+						c |= PLAIN_SCALAR_TEXT;
+						if(std::string(",?[]{}").find(ch) == std::string::npos)
+							c |= PLAIN_SCALAR_IN_FLOW_TEXT;
+					}
+					if(ch != '\'')
+						c |= SINGLE_QUOTED_TEXT;
+					if(ch != '\"' && ch != '\\')
+						c |= DOUBLE_QUOTED_TEXT;
+				}
+			}
+		};
+
+		static const CharClassTable s_charClassTable;
+		const unsigned char * const CharClasses = s_charClassTable.classes;
+
 		unsigned ParseHex(const std::string& str, const Mark& mark)
 		{
 			unsigned value = 0;
@@ -55,6 +55,9 @@ namespace YAML
 		            PlainScalarInFlow = !(BlankOrBreak || RegEx("?,[]{}#&*!|>\'\"%@`", REGEX_OR) || (RegEx("-:", REGEX_OR) + Blank));
 		const RegEx EndScalar = RegEx(':') + (BlankOrBreak || RegEx()),
 		            EndScalarInFlow = (RegEx(':') + (BlankOrBreak || RegEx(",]}", REGEX_OR))) || RegEx(",?[]{}", REGEX_OR);
+		const RegEx ScanScalarEnd = EndScalar || (BlankOrBreak + Comment),
+		            ScanScalarEndInFlow = EndScalarInFlow || (BlankOrBreak + Comment);
+		const RegEx Empty = RegEx();
 
 		const RegEx EscSingleQuote = RegEx("\'\'");
 		const RegEx EscBreak = RegEx('\\') + Break;
@@ -64,6 +67,91 @@ namespace YAML
 
 		// and some functions
 		std::string Escape(Stream& in);
+
+		////////////////////////////////////////////////////////////////////////////////
+		// Character classes
+		// . The scanner's hot paths look characters up in this table instead of
+		//   evaluating the expressions above; the tests below match exactly what the
+		//   expressions of the same name match.
+		// . The scalar classes hold the characters that can neither end nor need any
+		//   care inside such a scalar (after its first character), so a run of them
+		//   is added at once. None of them holds blanks, breaks or eof.
+		enum CHAR_CLASS {
+			BLANK = 0x01,                  // ' ' '\t'
+			BREAK = 0x02,                  // '\n' '\r' (a break if followed by '\n')
+			INDICATOR = 0x04,              // can never start a plain scalar: , [ ] { } # & * ! | > ' " % @ `
+			COMMENT_TEXT = 0x08,           // anything but a break or eof
+			PLAIN_SCALAR_TEXT = 0x10,
+			PLAIN_SCALAR_IN_FLOW_TEXT = 0x20,
+			SINGLE_QUOTED_TEXT = 0x40,
+			DOUBLE_QUOTED_TEXT = 0x80
+		};
+
+		extern const unsigned char * const CharClasses;  // indexed by unsigned char
+
+		inline bool IsClass(char ch, unsigned char mask) {
+			return (CharClasses[static_cast<unsigned char>(ch)] & mask) != 0;
+		}
+
+		inline bool IsBlank(char ch) { return ch == ' ' || ch == '\t'; }
+
+		// Break
+		inline int MatchBreak(const Stream& in, std::size_t i = 0) {
+			char ch = in.peek(i);
+			if(ch == '\n')
+				return 1;
+			return ch == '\r' && in.peek(i + 1) == '\n' ? 2 : -1;
+		}
+
+		inline bool IsBreak(const Stream& in, std::size_t i = 0) {
+			return IsClass(in.peek(i), BREAK) && MatchBreak(in, i) >= 0;
+		}
+
+		inline bool IsBlankOrBreak(const Stream& in, std::size_t i = 0) {
+			return IsBlank(in.peek(i)) || IsBreak(in, i);
+		}
+
+		// BlankOrBreak || RegEx(), after an indicator
+		inline bool IsBlankOrBreakOrEnd(const Stream& in, std::size_t i) {
+			return IsBlankOrBreak(in, i) || in.peek(i) == Stream::eof();
+		}
+
+		// DocStart, DocEnd and DocIndicator
+		inline bool IsDocMarker(const Stream& in, char ch) {
+			return in.peek() == ch && in.peek(1) == ch && in.peek(2) == ch && IsBlankOrBreakOrEnd(in, 3);
+		}
+
+		inline bool IsDocStart(const Stream& in) { return IsDocMarker(in, '-'); }
+		inline bool IsDocEnd(const Stream& in) { return IsDocMarker(in, '.'); }
+		inline bool IsDocIndicator(const Stream& in) { return IsDocStart(in) || IsDocEnd(in); }
+
+		// BlockEntry
+		inline bool IsBlockEntry(const Stream& in) {
+			return in.peek() == '-' && IsBlankOrBreakOrEnd(in, 1);
+		}
+
+		// Key and KeyInFlow
+		inline bool IsKey(const Stream& in, bool inFlow) {
+			return in.peek() == '?' && (!inFlow || IsBlankOrBreak(in, 1));
+		}
+
+		// Value and ValueInFlow
+		inline bool IsValue(const Stream& in, bool inFlow) {
+			if(in.peek() != ':')
+				return false;
+			if(inFlow && (in.peek(1) == ',' || in.peek(1) == '}'))
+				return true;
+			return inFlow ? IsBlankOrBreak(in, 1) : IsBlankOrBreakOrEnd(in, 1);
+		}
+
+		// PlainScalar and PlainScalarInFlow
+		inline bool IsPlainScalarStart(const Stream& in, bool inFlow) {
+			char ch = in.peek();
+			if(IsBlankOrBreak(in) || IsClass(ch, INDICATOR) || (inFlow && ch == '?'))
+				return false;
+			bool indicator = (ch == '-' || ch == ':' || (!inFlow && ch == '?'));
+			return !(indicator && IsBlank(in.peek(1)));
+		}
 	}
 
 	namespace Keys
@@ -79,6 +167,7 @@ namespace YAML
 		const char Tag = '!';
 		const char LiteralScalar = '|';
 		const char FoldedScalar = '>';
+		const char Comment = '#';
 	}
 }
 
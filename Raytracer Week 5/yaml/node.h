@@ -10,6 +10,7 @@
 #include "mark.h"
 #include "noncopyable.h"
 #include "parserstate.h"
+#include "../Memory.hpp"
 #include <iostream>
 #include <string>
 #include <vector>
@@ -24,7 +25,7 @@ namespace YAML
 
 	enum CONTENT_TYPE { CT_NONE, CT_SCALAR, CT_SEQUENCE, CT_MAP };
 
-	class Node: private noncopyable
+	class Node: private noncopyable, public ::Memory::Counted< ::Memory::YAML>
 	{
 	public:
 		Node();
@@ -37,12 +37,53 @@ namespace YAML
 	// . Throws a ParserException on error.
 	bool Parser::GetNextDocument(Node& document)
 	{
-		if(!m_pScanner.get())
-			return false;
-		
 		// clear node
 		document.Clear();
 
+		if(!BeginDocument())
+			return false;
+
+		// now parse our root node
+		document.Parse(m_pScanner.get(), m_state);
+
+		EndDocument();
+		return true;
+	}
+
+	// StreamNextDocument
+	// . Reads the next document in the queue, which must be a map, and
+	//   hands it to the handler one value (or sequence item) at a time.
+	// . Nodes that define anchors are kept until the end of the document,
+	//   since aliases further on may refer to them.
+	// . Throws a ParserException on error.
+	bool Parser::StreamNextDocument(StreamHandler& handler)
+	{
+		if(!BeginDocument())
+			return false;
+
+		std::vector<Node *> saved;
+		try {
+			StreamMap(handler, saved);
+		} catch(...) {
+			for(std::size_t i=0;i<saved.size();i++)
+				delete saved[i];
+			throw;
+		}
+
+		EndDocument();
+		for(std::size_t i=0;i<saved.size();i++)
+			delete saved[i];
+		return true;
+	}
+
+	// BeginDocument
+	// . Reads the directives and the document start, false if there is
+	//   no document.
+	bool Parser::BeginDocument()
+	{
+		if(!m_pScanner.get())
+			return false;
+		
 		// first read directives
 		ParseDirectives();
 
@@ -54,17 +95,167 @@ namespace YAML
 		if(m_pScanner->peek().type == Token::DOC_START)
 			m_pScanner->pop();
 
-		// now parse our root node
-		document.Parse(m_pScanner.get(), m_state);
+		return true;
+	}
 
+	// EndDocument
+	void Parser::EndDocument()
+	{
 		// and finally eat any doc ends we see
 		while(!m_pScanner->empty() && m_pScanner->peek().type == Token::DOC_END)
 			m_pScanner->pop();
 
 		// clear anchors from the scanner, which are no longer relevant
 		m_pScanner->ClearAnchors();
-		
-		return true;
+	}
+
+	// StreamMap
+	// . The root map, as Map::ParseBlock and Map::ParseFlow read it, with
+	//   the keys as strings.
+	void Parser::StreamMap(StreamHandler& handler, std::vector<Node *>& saved)
+	{
+		// an empty document has nothing to hand over
+		if(m_pScanner->empty())
+			return;
+
+		Token::TYPE type = m_pScanner->peek().type;
+		if(type != Token::BLOCK_MAP_START && type != Token::FLOW_MAP_START)
+			throw ParserException(m_pScanner->peek().mark, ErrorMsg::STREAM_ROOT);
+		bool flow = type == Token::FLOW_MAP_START;
+		Token::TYPE endType = flow ? Token::FLOW_MAP_END : Token::BLOCK_MAP_END;
+		const std::string& endMsg = flow ? ErrorMsg::END_OF_MAP_FLOW : ErrorMsg::END_OF_MAP;
+
+		// eat start token
+		m_pScanner->pop();
+
+		while(1) {
+			if(m_pScanner->empty())
+				throw ParserException(Mark::null(), endMsg);
+
+			Token token = m_pScanner->peek();
+			if(!flow && token.type != Token::KEY && token.type != Token::VALUE && token.type != endType)
+				throw ParserException(token.mark, endMsg);
+
+			if(token.type == endType) {
+				m_pScanner->pop();
+				break;
+			}
+
+			// grab key (if non-null)
+			std::string key;
+			if(token.type == Token::KEY) {
+				m_pScanner->pop();
+				std::size_t numSaved = m_pScanner->NumSaved();
+				std::auto_ptr <Node> pKey(new Node);
+				pKey->Parse(m_pScanner.get(), m_state);
+				pKey->GetScalar(key);
+				if(m_pScanner->NumSaved() != numSaved)
+					saved.push_back(pKey.release());
+			}
+
+			// now grab value (optional)
+			if(!m_pScanner->empty() && m_pScanner->peek().type == Token::VALUE) {
+				m_pScanner->pop();
+				StreamValue(handler, key, saved);
+			}
+
+			// now eat the separator (or could be a map end, which we ignore - but if it's neither, then it's a bad node)
+			if(flow) {
+				Token& nextToken = m_pScanner->peek();
+				if(nextToken.type == Token::FLOW_ENTRY)
+					m_pScanner->pop();
+				else if(nextToken.type != Token::FLOW_MAP_END)
+					throw ParserException(nextToken.mark, ErrorMsg::END_OF_MAP_FLOW);
+			}
+		}
+	}
+
+	// StreamValue
+	// . Sequences the handler streams go item by item, anything else
+	//   (including sequences with a tag or anchor) as one node.
+	void Parser::StreamValue(StreamHandler& handler, const std::string& key, std::vector<Node *>& saved)
+	{
+		if(!m_pScanner->empty() && handler.IsStreamed(key)) {
+			Token::TYPE type = m_pScanner->peek().type;
+			if(type == Token::BLOCK_SEQ_START || type == Token::FLOW_SEQ_START) {
+				StreamSequence(handler, key, saved);
+				return;
+			}
+		}
+		StreamNode(handler, key, false, saved);
+	}
+
+	// StreamSequence
+	// . As Sequence::ParseBlock and Sequence::ParseFlow, handing over
+	//   every item instead of keeping it.
+	void Parser::StreamSequence(StreamHandler& handler, const std::string& key, std::vector<Node *>& saved)
+	{
+		bool flow = m_pScanner->peek().type == Token::FLOW_SEQ_START;
+
+		// eat start token
+		m_pScanner->pop();
+
+		while(1) {
+			if(m_pScanner->empty())
+				throw ParserException(Mark::null(), flow ? ErrorMsg::END_OF_SEQ_FLOW : ErrorMsg::END_OF_SEQ);
+
+			if(flow) {
+				// first check for end
+				if(m_pScanner->peek().type == Token::FLOW_SEQ_END) {
+					m_pScanner->pop();
+					break;
+				}
+
+				// then read the node
+				StreamNode(handler, key, true, saved);
+
+				// now eat the separator
+				Token& token = m_pScanner->peek();
+				if(token.type == Token::FLOW_ENTRY)
+					m_pScanner->pop();
+				else if(token.type != Token::FLOW_SEQ_END)
+					throw ParserException(token.mark, ErrorMsg::END_OF_SEQ_FLOW);
+				continue;
+			}
+
+			Token token = m_pScanner->peek();
+			if(token.type != Token::BLOCK_ENTRY && token.type != Token::BLOCK_SEQ_END)
+				throw ParserException(token.mark, ErrorMsg::END_OF_SEQ);
+
+			m_pScanner->pop();
+			if(token.type == Token::BLOCK_SEQ_END)
+				break;
+
+			// check for null
+			if(!m_pScanner->empty()) {
+				const Token& token = m_pScanner->peek();
+				if(token.type == Token::BLOCK_ENTRY || token.type == Token::BLOCK_SEQ_END) {
+					Node null;
+					handler.OnItem(key, null);
+					continue;
+				}
+			}
+
+			StreamNode(handler, key, true, saved);
+		}
+	}
+
+	// StreamNode
+	// . Parses one node and hands it over, then drops it unless it
+	//   defined an anchor.
+	void Parser::StreamNode(StreamHandler& handler, const std::string& key, bool item, std::vector<Node *>& saved)
+	{
+		std::size_t numSaved = m_pScanner->NumSaved();
+		std::auto_ptr <Node> pNode(new Node);
+		pNode->Parse(m_pScanner.get(), m_state);
+
+		if(item)
+			handler.OnItem(key, *pNode);
+		else
+			handler.OnValue(key, *pNode);
+
+		if(m_pScanner->NumSaved() != numSaved)
+			saved.push_back(pNode.release());
 	}
 
 	// ParseDirectives
@@ -18,6 +18,21 @@ namespace YAML
 	class Scanner;
 	struct Token;
 
+	// StreamHandler
+	// . Receives a document from Parser::StreamNextDocument piece by piece:
+	//   the value of every key of the root map, or, for the keys it wants
+	//   streamed, every item of the sequence. Each node is only valid
+	//   during the call, the document is never held as a whole.
+	class StreamHandler
+	{
+	public:
+		virtual ~StreamHandler() {}
+
+		virtual bool IsStreamed(const std::string& key) = 0;
+		virtual void OnValue(const std::string& key, const Node& value) = 0;
+		virtual void OnItem(const std::string& key, const Node& item) = 0;
+	};
+
 	class Parser: private noncopyable
 	{
 	public:
@@ -29,9 +44,17 @@ namespace YAML
 
 		void Load(std::istream& in);
 		bool GetNextDocument(Node& document);
+		bool StreamNextDocument(StreamHandler& handler);
 		void PrintTokens(std::ostream& out);
 
 	private:
+		bool BeginDocument();
+		void EndDocument();
+		void StreamMap(StreamHandler& handler, std::vector<Node *>& saved);
+		void StreamValue(StreamHandler& handler, const std::string& key, std::vector<Node *>& saved);
+		void StreamSequence(StreamHandler& handler, const std::string& key, std::vector<Node *>& saved);
+		void StreamNode(StreamHandler& handler, const std::string& key, bool item, std::vector<Node *>& saved);
+
 		void ParseDirectives();
 		void HandleDirective(Token *pToken);
 		void HandleYamlDirective(Token *pToken);
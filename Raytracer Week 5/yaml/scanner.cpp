@@ -8,7 +8,7 @@
 namespace YAML
 {
 	Scanner::Scanner(std::istream& in)
-		: INPUT(in), m_startedStream(false), m_endedStream(false), m_simpleKeyAllowed(false)
+		: INPUT(in), m_startedStream(false), m_endedStream(false), m_simpleKeyAllowed(false), m_numSaved(0)
 	{
 	}
 
@@ -116,10 +116,10 @@ namespace YAML
 			return ScanDirective();
 
 		// document token
-		if(INPUT.column() == 0 && Exp::DocStart.Matches(INPUT))
+		if(INPUT.column() == 0 && Exp::IsDocStart(INPUT))
 			return ScanDocStart();
 
-		if(INPUT.column() == 0 && Exp::DocEnd.Matches(INPUT))
+		if(INPUT.column() == 0 && Exp::IsDocEnd(INPUT))
 			return ScanDocEnd();
 
 		// flow start/end/entry
@@ -133,13 +133,13 @@ namespace YAML
 			return ScanFlowEntry();
 
 		// block/map stuff
-		if(Exp::BlockEntry.Matches(INPUT))
+		if(Exp::IsBlockEntry(INPUT))
 			return ScanBlockEntry();
 
-		if((InBlockContext() ? Exp::Key : Exp::KeyInFlow).Matches(INPUT))
+		if(Exp::IsKey(INPUT, InFlowContext()))
 			return ScanKey();
 
-		if((InBlockContext() ? Exp::Value : Exp::ValueInFlow).Matches(INPUT))
+		if(Exp::IsValue(INPUT, InFlowContext()))
 			return ScanValue();
 
 		// alias/anchor
@@ -158,7 +158,7 @@ namespace YAML
 			return ScanQuotedScalar();
 
 		// plain scalars
-		if((InBlockContext() ? Exp::PlainScalar : Exp::PlainScalarInFlow).Matches(INPUT))
+		if(Exp::IsPlainScalarStart(INPUT, InFlowContext()))
 			return ScanPlainScalar();
 
 		// don't know what it is!
@@ -172,24 +172,25 @@ namespace YAML
 		while(1) {
 			// first eat whitespace
 			while(INPUT && IsWhitespaceToBeEaten(INPUT.peek())) {
-				if(InBlockContext() && Exp::Tab.Matches(INPUT))
+				if(InBlockContext() && INPUT.peek() == '\t')
 					m_simpleKeyAllowed = false;
 				INPUT.eat(1);
 			}
 
 			// then eat a comment
-			if(Exp::Comment.Matches(INPUT)) {
+			if(INPUT.peek() == Keys::Comment) {
 				// eat until line break
-				while(INPUT && !Exp::Break.Matches(INPUT))
+				INPUT.EatRun(Exp::CharClasses, Exp::COMMENT_TEXT);
+				while(INPUT && !Exp::IsBreak(INPUT))
 					INPUT.eat(1);
 			}
 
 			// if it's NOT a line break, then we're done!
-			if(!Exp::Break.Matches(INPUT))
+			if(!Exp::IsBreak(INPUT))
 				break;
 
 			// otherwise, let's eat the line break and keep going
-			int n = Exp::Break.Match(INPUT);
+			int n = Exp::MatchBreak(INPUT);
 			INPUT.eat(n);
 
 			// oh yeah, and let's get rid of that simple key
@@ -295,7 +296,7 @@ namespace YAML
 			const IndentMarker& indent = m_indents.top();
 			if(indent.column < INPUT.column())
 				break;
-			if(indent.column == INPUT.column() && !(indent.type == IndentMarker::SEQ && !Exp::BlockEntry.Matches(INPUT)))
+			if(indent.column == INPUT.column() && !(indent.type == IndentMarker::SEQ && !Exp::IsBlockEntry(INPUT)))
 				break;
 				
 			PopIndent();
@@ -350,9 +351,12 @@ namespace YAML
 	// Save
 	// . Saves a pointer to the Node object referenced by a particular anchor
 	//   name.
+	// . NumSaved() counts the calls, so a parser can tell whether a node
+	//   it is about to delete may still be referenced.
 	void Scanner::Save(const std::string& anchor, Node* value)
 	{
 		m_anchors[anchor] = value;
+		m_numSaved++;
 	}
 
 	// Retrieve
@@ -32,6 +32,7 @@ namespace YAML
 		void Save(const std::string& anchor, Node* value);
 		const Node *Retrieve(const std::string& anchor) const;
 		void ClearAnchors();
+		std::size_t NumSaved() const { return m_numSaved; }
 
 	private:
 		struct IndentMarker {
@@ -121,6 +122,7 @@ namespace YAML
 		std::stack <IndentMarker> m_indents;
 		std::stack <FLOW_MARKER> m_flows;
 		std::map <std::string, const Node *> m_anchors;
+		std::size_t m_numSaved;
 	};
 }
 
@@ -26,18 +26,29 @@ namespace YAML
 		bool foldedNewlineStartedMoreIndented = false;
 		std::string scalar;
 		params.leadingSpaces = false;
+		const RegEx& end = (params.end ? *params.end : Exp::Empty);
 
 		while(INPUT) {
 			// ********************************
 			// Phase #1: scan until line ending
 			
 			std::size_t lastNonWhitespaceChar = scalar.size();
-			while(!params.end.Matches(INPUT) && !Exp::Break.Matches(INPUT)) {
+			while(1) {
+				// a run of characters that can't end the scalar goes in at once
+				// (not at the start of a line, where it might be a document indicator)
+				if(params.run && INPUT.column() > 0 && INPUT.EatRun(Exp::CharClasses, params.run, &scalar) > 0) {
+					foundNonEmptyLine = true;
+					pastOpeningBreak = true;
+					lastNonWhitespaceChar = scalar.size();
+				}
+
+				if(end.Matches(INPUT) || Exp::IsBreak(INPUT))
+					break;
 				if(!INPUT)
 					break;
 
 				// document indicator?
-				if(INPUT.column() == 0 && Exp::DocIndicator.Matches(INPUT)) {
+				if(INPUT.column() == 0 && Exp::IsDocIndicator(INPUT)) {
 					if(params.onDocIndicator == BREAK)
 						break;
 					else if(params.onDocIndicator == THROW)
@@ -48,9 +59,8 @@ namespace YAML
 				pastOpeningBreak = true;
 
 				// escaped newline? (only if we're escaping on slash)
-				if(params.escape == '\\' && Exp::EscBreak.Matches(INPUT)) {
-					int n = Exp::EscBreak.Match(INPUT);
-					INPUT.eat(n);
+				if(params.escape == '\\' && INPUT.peek() == '\\' && Exp::IsBreak(INPUT, 1)) {
+					INPUT.eat(1 + Exp::MatchBreak(INPUT, 1));
 					lastNonWhitespaceChar = scalar.size();
 					continue;
 				}
@@ -77,11 +87,11 @@ namespace YAML
 			}
 
 			// doc indicator?
-			if(params.onDocIndicator == BREAK && INPUT.column() == 0 && Exp::DocIndicator.Matches(INPUT))
+			if(params.onDocIndicator == BREAK && INPUT.column() == 0 && Exp::IsDocIndicator(INPUT))
 				break;
 
 			// are we done via character match?
-			int n = params.end.Match(INPUT);
+			int n = end.Match(INPUT);
 			if(n >= 0) {
 				if(params.eatEnd)
 					INPUT.eat(n);
@@ -94,7 +104,7 @@ namespace YAML
 			
 			// ********************************
 			// Phase #2: eat line ending
-			n = Exp::Break.Match(INPUT);
+			n = Exp::MatchBreak(INPUT);
 			INPUT.eat(n);
 
 			// ********************************
@@ -109,7 +119,7 @@ namespace YAML
 				params.indent = std::max(params.indent, INPUT.column());
 
 			// and then the rest of the whitespace
-			while(Exp::Blank.Matches(INPUT)) {
+			while(Exp::IsBlank(INPUT.peek())) {
 				// we check for tabs that masquerade as indentation
 				if(INPUT.peek() == '\t'&& INPUT.column() < params.indent && params.onTabInIndentation == THROW)
 					throw ParserException(INPUT.mark(), ErrorMsg::TAB_IN_INDENTATION);
@@ -121,8 +131,8 @@ namespace YAML
 			}
 
 			// was this an empty line?
-			bool nextEmptyLine = Exp::Break.Matches(INPUT);
-			bool nextMoreIndented = Exp::Blank.Matches(INPUT);
+			bool nextEmptyLine = Exp::IsBreak(INPUT);
+			bool nextMoreIndented = Exp::IsBlank(INPUT.peek());
 			if(params.fold == FOLD_BLOCK && foldedNewlineCount == 0 && nextEmptyLine)
 				foldedNewlineStartedMoreIndented = moreIndented;
 
@@ -15,11 +15,12 @@ namespace YAML
 	enum FOLD { DONT_FOLD, FOLD_BLOCK, FOLD_FLOW };
 
 	struct ScanScalarParams {
-		ScanScalarParams(): eatEnd(false), indent(0), detectIndent(false), eatLeadingWhitespace(0), escape(0), fold(DONT_FOLD),
+		ScanScalarParams(): end(0), run(0), eatEnd(false), indent(0), detectIndent(false), eatLeadingWhitespace(0), escape(0), fold(DONT_FOLD),
 			trimTrailingSpaces(0), chomp(CLIP), onDocIndicator(NONE), onTabInIndentation(NONE), leadingSpaces(false) {}
 
 		// input:
-		RegEx end;                      // what condition ends this scalar?
+		const RegEx *end;               // what condition ends this scalar? (0 for the end of the stream)
+		unsigned char run;              // which class of Exp::CharClasses can be added in bulk (0 for none)?
 		bool eatEnd;                    // should we eat that condition when we see it?
 		int indent;                     // what level of indentation should be eaten and ignored?
 		bool detectIndent;              // should we try to autodetect the indent?
@@ -284,7 +284,8 @@ namespace YAML
 
 		// set up the scanning parameters
 		ScanScalarParams params;
-		params.end = (InFlowContext() ? Exp::EndScalarInFlow : Exp::EndScalar) || (Exp::BlankOrBreak + Exp::Comment);
+		params.end = (InFlowContext() ? &Exp::ScanScalarEndInFlow : &Exp::ScanScalarEnd);
+		params.run = (InFlowContext() ? Exp::PLAIN_SCALAR_IN_FLOW_TEXT : Exp::PLAIN_SCALAR_TEXT);
 		params.eatEnd = false;
 		params.indent = (InFlowContext() ? 0 : GetTopIndent() + 1);
 		params.fold = FOLD_FLOW;
@@ -323,7 +324,9 @@ namespace YAML
 
 		// setup the scanning parameters
 		ScanScalarParams params;
-		params.end = (single ? RegEx(quote) && !Exp::EscSingleQuote : RegEx(quote));
+		RegEx end = (single ? RegEx(quote) && !Exp::EscSingleQuote : RegEx(quote));
+		params.end = &end;
+		params.run = (single ? Exp::SINGLE_QUOTED_TEXT : Exp::DOUBLE_QUOTED_TEXT);
 		params.eatEnd = true;
 		params.escape = (single ? '\'' : '\\');
 		params.indent = 0;
@@ -386,16 +389,16 @@ namespace YAML
 		}
 
 		// now eat whitespace
-		while(Exp::Blank.Matches(INPUT))
+		while(Exp::IsBlank(INPUT.peek()))
 			INPUT.eat(1);
 
 		// and comments to the end of the line
-		if(Exp::Comment.Matches(INPUT))
-			while(INPUT && !Exp::Break.Matches(INPUT))
+		if(INPUT.peek() == Keys::Comment)
+			while(INPUT && !Exp::IsBreak(INPUT))
 				INPUT.eat(1);
 
 		// if it's not a line break, then we ran into a bad character inline
-		if(INPUT && !Exp::Break.Matches(INPUT))
+		if(INPUT && !Exp::IsBreak(INPUT))
 			throw ParserException(INPUT.mark(), ErrorMsg::CHAR_IN_BLOCK);
 
 		// set the initial indentation
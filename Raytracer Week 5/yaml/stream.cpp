@@ -277,6 +277,28 @@ namespace YAML
 			get();
 	}
 
+	// EatRun
+	// . Eats the characters from the current position on whose class in 'classes'
+	//   has a bit of 'mask' set, appending them to 'str' if it is given.
+	// . Returns the number of characters eaten.
+	// . The class may not hold line breaks or eof(), since only the column is updated.
+	std::size_t Stream::EatRun(const unsigned char *classes, unsigned char mask, std::string *str)
+	{
+		std::size_t n = 0;
+		while(ReadAheadTo(n) && (classes[static_cast<unsigned char>(m_readahead[n])] & mask))
+			n++;
+		if(n == 0)
+			return 0;
+
+		if(str)
+			str->append(m_readahead.begin(), m_readahead.begin() + n);
+		m_readahead.erase(m_readahead.begin(), m_readahead.begin() + n);
+		m_mark.pos += n;
+		m_mark.column += n;
+		ReadAheadTo(0);
+		return n;
+	}
+
 	void Stream::AdvanceCurrent()
 	{
 		if (!m_readahead.empty())
@@ -315,6 +337,13 @@ namespace YAML
 		if (m_input.good())
 		{
 			m_readahead.push_back(b);
+
+			// and the rest of the prefetched bytes with it, rather than one at a time
+			if (!m_nPushedBack)
+			{
+				m_readahead.insert(m_readahead.end(), m_pPrefetched + m_nPrefetchedUsed, m_pPrefetched + m_nPrefetchedAvailable);
+				m_nPrefetchedUsed = m_nPrefetchedAvailable;
+			}
 		}
 	}
 
@@ -28,9 +28,11 @@ namespace YAML
 		bool operator !() const { return !static_cast <bool>(*this); }
 
 		char peek() const;
+		char peek(std::size_t i) const;
 		char get();
 		std::string get(int n);
 		void eat(int n = 1);
+		std::size_t EatRun(const unsigned char *classes, unsigned char mask, std::string *str = 0);
 
 		static char eof() { return 0x04; }
 		
@@ -75,6 +77,12 @@ namespace YAML
 			return true;
 		return _ReadAheadTo(i);
 	}	
+
+	// peek
+	// . Looks 'i' characters ahead, past the end of the stream that is eof()
+	inline char Stream::peek(size_t i) const {
+		return ReadAheadTo(i) ? CharAt(i) : eof();
+	}
 }
 
 #endif // STREAM_H_62B23520_7C8E_11DE_8A39_0800200C9A66